@@ -0,0 +1,645 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "columnar_dataset.hpp"
+#include "csv_loader.hpp"
+#include "dataset_index.hpp"
+#include "dataset_snapshot.hpp"
+#include "detection_types.hpp"
+#include "dnn_detector.hpp"
+#include "frame_cache.hpp"
+#include "metrics.hpp"
+#include "versioned_ptr.hpp"
+
+// Which engine answers AquaticDetector::detect(): CSV replay, or real
+// inference on the captured frame.
+enum class DetectorBackend { Dataset, Dnn };
+
+// A dataset with its secondary indexes, immutable once loaded.
+template <typename Columns>
+struct IndexedDataset {
+    Columns columns;
+    DatasetIndex index;
+    CsvLoadStats loadStats;
+    std::string sourcePath;
+};
+
+// Outcome of appending CSV lines to a loaded dataset.
+struct AppendStats {
+    size_t rows = 0;
+    size_t badRows = 0;
+    double seconds = 0.0; // parsing, copying, indexing and publishing
+};
+
+class AquaticDetector {
+private:
+    // Rows replay cycles through: all of them, or the matches of a filter.
+    struct ReplaySubset {
+        bool filtered = false;
+        DatasetFilter filter; // kept to re-select when rows are appended
+        Column<uint32_t> rows; // shared with the versions before an append
+
+        size_t size(size_t datasetRows) const { return filtered ? rows.size() : datasetRows; }
+        size_t row(size_t cursor) const { return filtered ? rows[cursor] : cursor; }
+    };
+
+    // Everything dataset replay reads. Published through `replay` and never
+    // modified afterwards: a filter change or reload publishes a new
+    // ReplayData sharing the unchanged datasets, while readers finish on
+    // the version they pinned. Each dataset interns its category values
+    // (e.g. "River", "Plastic") in its own string pool so that it can be
+    // snapshotted on its own.
+    struct ReplayData {
+        std::shared_ptr<const IndexedDataset<WasteColumns>> waste;
+        std::shared_ptr<const IndexedDataset<MarineColumns>> marine;
+        ReplaySubset wasteReplay;
+        ReplaySubset marineReplay;
+
+        size_t wasteRows() const { return wasteReplay.size(waste->columns.rowCount()); }
+        size_t marineRows() const { return marineReplay.size(marine->columns.rowCount()); }
+        size_t wasteRow(uint64_t cursor) const { return wasteReplay.row(cursor % wasteRows()); }
+        size_t marineRow(uint64_t cursor) const { return marineReplay.row(cursor % marineRows()); }
+
+        // The dataset and replay subset of one kind, for code written once
+        // for both.
+        template <typename Columns>
+        std::shared_ptr<const IndexedDataset<Columns>>& dataset() {
+            if constexpr (std::is_same<Columns, MarineColumns>::value) {
+                return marine;
+            } else {
+                return waste;
+            }
+        }
+
+        template <typename Columns>
+        const std::shared_ptr<const IndexedDataset<Columns>>& dataset() const {
+            return const_cast<ReplayData*>(this)->dataset<Columns>();
+        }
+
+        template <typename Columns>
+        ReplaySubset& subset() {
+            if constexpr (std::is_same<Columns, MarineColumns>::value) {
+                return marineReplay;
+            } else {
+                return wasteReplay;
+            }
+        }
+    };
+
+    VersionedPtr<ReplayData> replay;
+    // Replay positions, shared by every caller of detect(); a row is
+    // cursor % replay size. Consumers wanting their own position use
+    // ReplayCursor instead.
+    std::atomic<uint64_t> wasteCursor{0};
+    std::atomic<uint64_t> marineCursor{0};
+    // Serialises the writers (reload, filter changes); readers never take it.
+    InstrumentedMutex updateMutex;
+    LatencyHistogram* frameLoadLatency = nullptr; // set by instrument()
+
+    DnnDetector dnnDetector;
+    cv::Size baseInputSize; // set by useDnnBackend
+    FrameCache frameCache;
+
+    std::atomic<DetectorBackend> backend{DetectorBackend::Dataset};
+    // Dataset backend counters, kept as atomics so replay takes no lock.
+    std::atomic<uint64_t> datasetFrames{0};
+    std::atomic<uint64_t> datasetBatches{0};
+    std::atomic<uint64_t> datasetNanoseconds{0};
+
+    // Images the cursors will reach over the next few detections, both
+    // datasets interleaved. Overwrites `paths` in place, so strings kept
+    // from the previous call are reused rather than reallocated.
+    void upcomingImages(const ReplayData& data, uint64_t marine, uint64_t waste, std::vector<std::string>& paths) const {
+        size_t depth = frameCache.getPrefetchDepth();
+        size_t count = 0;
+        auto add = [&paths, &count](std::string_view path) {
+            if (count == paths.size()) paths.emplace_back();
+            paths[count++].assign(path);
+        };
+        for (size_t step = 1; step <= depth; ++step) {
+            if (data.marineRows() > 0) {
+                const MarineColumns& columns = data.marine->columns;
+                add(columns.strings.get(columns.imageFileName[data.marineRow(marine + step)]));
+            }
+            if (data.wasteRows() > 0) {
+                const WasteColumns& columns = data.waste->columns;
+                add(columns.strings.get(columns.imageFileName[data.wasteRow(waste + step)]));
+            }
+        }
+        paths.resize(count);
+    }
+
+    // A dataset row as a detection, written over `marine` so its strings'
+    // storage is reused.
+    static void assignMarineRow(const MarineColumns& marineDataset, size_t row, DetectionResult& marine) {
+        marine.label.assign(marineDataset.strings.get(marineDataset.animalSpecies[row]));
+        marine.confidence = marineDataset.confidence[row];
+        marine.size = marineDataset.size[row];
+        marine.activity.assign(marineDataset.strings.get(marineDataset.activity[row]));
+        marine.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        marine.box = cv::Rect();
+        marine.trackId = 0;
+    }
+
+    static void assignWasteRow(const WasteColumns& wasteDataset, size_t row, DetectionResult& waste) {
+        waste.label.assign(wasteDataset.strings.get(wasteDataset.label[row]));
+        waste.confidence = wasteDataset.confidence[row];
+        waste.size = wasteDataset.size[row];
+        waste.activity.clear();
+        waste.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        waste.box = cv::Rect();
+        waste.trackId = 0;
+    }
+
+    static DetectionResult marineRowResult(const MarineColumns& marineDataset, size_t row) {
+        DetectionResult marine;
+        assignMarineRow(marineDataset, row, marine);
+        return marine;
+    }
+
+    static DetectionResult wasteRowResult(const WasteColumns& wasteDataset, size_t row) {
+        DetectionResult waste;
+        assignWasteRow(wasteDataset, row, waste);
+        return waste;
+    }
+
+    // Dataset backend: the rows at the given cursors stand in for a
+    // detection. Replaces `result`'s contents, reusing its storage.
+    static void replayFrame(const ReplayData& data, uint64_t marine, uint64_t waste, DetectionPair& result) {
+        result.first.resize(data.marineRows() > 0 ? 1 : 0);
+        result.second.resize(data.wasteRows() > 0 ? 1 : 0);
+        if (!result.first.empty()) assignMarineRow(data.marine->columns, data.marineRow(marine), result.first[0]);
+        if (!result.second.empty()) assignWasteRow(data.waste->columns, data.wasteRow(waste), result.second[0]);
+    }
+
+    void recordReplay(size_t frameCount, std::chrono::steady_clock::time_point started) {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        datasetFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        datasetBatches.fetch_add(1, std::memory_order_relaxed);
+        datasetNanoseconds.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+            std::memory_order_relaxed);
+    }
+
+    // Dataset backend: the next row of each CSV (or of its replay filter's
+    // matches) stands in for a detection. Claims frameCount rows of each
+    // kind with one atomic add, so concurrent callers get distinct rows.
+    void replayDataset(size_t frameCount, std::vector<DetectionPair>& results) {
+        results.resize(frameCount);
+        auto started = std::chrono::steady_clock::now();
+        auto data = replay.pin();
+        uint64_t marine = marineCursor.fetch_add(frameCount, std::memory_order_relaxed);
+        uint64_t waste = wasteCursor.fetch_add(frameCount, std::memory_order_relaxed);
+        for (size_t i = 0; i < frameCount; ++i) replayFrame(*data, marine + i, waste + i, results[i]);
+        recordReplay(frameCount, started);
+    }
+
+    static void reportLoad(const std::string& name, const std::string& csvPath, const CsvLoadStats& stats,
+                           size_t heapBytes) {
+        if (!stats.opened) {
+            std::cerr << "Failed to open " << name << " dataset file: " << csvPath << std::endl;
+            return;
+        }
+        std::cout << "[LOADER] " << name << " dataset: " << stats.rows << " rows, " << stats.badRows
+             << " bad rows, " << std::fixed << std::setprecision(1) << stats.seconds * 1000.0 << " ms ("
+             << static_cast<size_t>(stats.rowsPerSecond()) << " rows/sec on " << stats.threads
+             << " threads), " << heapBytes / 1024.0 << " KiB resident" << std::defaultfloat << std::endl;
+    }
+
+    // Map a fresh snapshot if there is one; otherwise parse the CSV and
+    // leave a snapshot behind for the next boot.
+    template <typename Columns, typename Chunk>
+    static std::shared_ptr<IndexedDataset<Columns>> loadDataset(const std::string& name, const std::string& csvPath,
+                                                                 SnapshotKind kind) {
+        auto started = std::chrono::steady_clock::now();
+        auto dataset = std::make_shared<IndexedDataset<Columns>>();
+        Columns& columns = dataset->columns;
+        CsvLoadStats& stats = dataset->loadStats;
+        std::string reason;
+
+        dataset->sourcePath = csvPath;
+        if (loadSnapshot(csvPath, kind, columns, reason)) {
+            stats.opened = true;
+            stats.rows = columns.rowCount();
+            stats.bytes = snapshotSourceSize(*columns.backing);
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            std::cout << "[LOADER] " << name << " dataset: " << stats.rows << " rows from snapshot in " << std::fixed
+                 << std::setprecision(1) << stats.seconds * 1000.0 << " ms" << std::defaultfloat << std::endl;
+        } else {
+            stats = loadCsvParallel<Chunk::FieldCount, Chunk>(
+                csvPath, [&columns](const Chunk& chunk) { chunk.mergeInto(columns); });
+            columns.shrinkToFit();
+            reportLoad(name, csvPath, stats, columns.memoryUsage());
+
+            if (stats.opened) {
+                if (writeSnapshot(csvPath, kind, columns)) {
+                    std::cout << "[LOADER] " << name << " snapshot rebuilt (" << reason << ")" << std::endl;
+                } else {
+                    std::cerr << "Warning: could not write snapshot " << snapshotPathFor(csvPath) << std::endl;
+                }
+            }
+        }
+
+        buildIndex(name, *dataset);
+        return dataset;
+    }
+
+    template <typename Columns>
+    static void buildIndex(const std::string& name, IndexedDataset<Columns>& dataset) {
+        if (dataset.columns.empty()) return;
+        dataset.index.build(dataset.columns);
+        std::cout << "[LOADER] " << name << " indexes built in " << std::fixed << std::setprecision(1)
+             << dataset.index.getBuildSeconds() * 1000.0 << " ms, " << dataset.index.memoryUsage() / 1024.0 << " KiB"
+             << std::defaultfloat << std::endl;
+    }
+
+    static bool selectReplay(const DatasetIndex& index, const DatasetFilter& filter, ReplaySubset& subset,
+                             std::string& error) {
+        subset = ReplaySubset();
+        if (!filter.empty()) {
+            RowBitmap matches;
+            if (!index.select(filter, matches, error)) return false;
+            subset.filtered = true;
+            subset.filter = filter;
+            subset.rows.reserve(matches.count());
+            matches.forEach([&subset](size_t row) { subset.rows.push_back(static_cast<uint32_t>(row)); });
+        }
+        return true;
+    }
+
+    // Apply a subset's filter to a dataset that replaced the one it was
+    // selected from. If the new dataset lacks the indexes (it came up
+    // empty), nothing of that kind is replayed.
+    static void reselectReplay(const DatasetIndex& index, ReplaySubset& subset) {
+        if (!subset.filtered) return;
+        DatasetFilter filter = subset.filter;
+        std::string error;
+        if (!selectReplay(index, filter, subset, error)) {
+            subset.filtered = true;
+            subset.filter = filter;
+        }
+    }
+
+    template <typename Columns>
+    std::atomic<uint64_t>& cursorFor() {
+        return std::is_same<Columns, MarineColumns>::value ? marineCursor : wasteCursor;
+    }
+
+    // Publish a copy of the current ReplayData with one dataset replaced,
+    // keeping its replay filter. Caller holds updateMutex.
+    template <typename Columns>
+    void publishDataset(std::shared_ptr<const IndexedDataset<Columns>> dataset) {
+        auto next = std::make_shared<ReplayData>(*replay.pin());
+        reselectReplay(dataset->index, next->template subset<Columns>());
+        next->template dataset<Columns>() = std::move(dataset);
+        replay.publish(std::move(next));
+    }
+
+    // Parse `lines` and publish the dataset with the rows added. Readers
+    // carry on with the previous version meanwhile. The new version shares
+    // the previous one's columns, index runs and replay rows, so only the
+    // new rows are parsed, copied, sorted and filtered.
+    template <typename Columns, typename Chunk>
+    bool appendRows(std::string_view lines, AppendStats& result) {
+        auto started = std::chrono::steady_clock::now();
+        result = AppendStats();
+        Chunk chunk;
+        chunk.reserveBytes(lines.size());
+        result.badRows = csv::parseLines<Chunk::FieldCount>(lines, chunk);
+        result.rows = chunk.rowCount();
+
+        if (result.rows > 0) {
+            std::lock_guard<InstrumentedMutex> lock(updateMutex);
+            auto next = std::make_shared<ReplayData>(*replay.pin());
+            std::shared_ptr<const IndexedDataset<Columns>>& current = next->template dataset<Columns>();
+            auto extended = std::make_shared<IndexedDataset<Columns>>();
+            extended->columns = current->columns.clone();
+            size_t firstRow = extended->columns.rowCount();
+            chunk.mergeInto(extended->columns);
+            extended->index = current->index;
+            extended->index.extend(extended->columns);
+            extended->loadStats = current->loadStats;
+            extended->sourcePath = current->sourcePath;
+
+            ReplaySubset& subset = next->template subset<Columns>();
+            RowBitmap matches;
+            std::string error;
+            if (subset.filtered && extended->index.select(subset.filter, matches, error, firstRow)) {
+                matches.forEach([&subset](size_t row) { subset.rows.push_back(static_cast<uint32_t>(row)); });
+            }
+            current = std::move(extended);
+            replay.publish(std::move(next));
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result.badRows == 0;
+    }
+
+    // Re-read one dataset from its source file (it was truncated or
+    // replaced) and restart its replay.
+    template <typename Columns, typename Chunk>
+    bool reloadDataset(const std::string& name, SnapshotKind kind) {
+        std::string path = replay.pin()->template dataset<Columns>()->sourcePath;
+        std::shared_ptr<const IndexedDataset<Columns>> dataset = loadDataset<Columns, Chunk>(name, path, kind);
+        bool loaded = !dataset->columns.empty();
+
+        std::lock_guard<InstrumentedMutex> lock(updateMutex);
+        publishDataset<Columns>(std::move(dataset));
+        cursorFor<Columns>().store(0);
+        return loaded;
+    }
+
+    // Publish a copy of the current ReplayData with one replay subset
+    // replaced, restarting that kind's cursor.
+    bool updateReplayFilter(bool marine, const DatasetFilter& filter, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(updateMutex);
+        auto next = std::make_shared<ReplayData>(*replay.pin());
+        const DatasetIndex& index = marine ? next->marine->index : next->waste->index;
+        if (!selectReplay(index, filter, marine ? next->marineReplay : next->wasteReplay, error)) return false;
+        replay.publish(std::move(next));
+        (marine ? marineCursor : wasteCursor).store(0);
+        return true;
+    }
+
+public:
+    AquaticDetector(const std::string& wasteDatasetPath = "waste_detection_with_images_dataset.csv",
+                   const std::string& marineDatasetPath = "expanded_marine_animal_2_dataset.csv") {
+        srand(static_cast<unsigned>(time(0)));
+        reloadDatasets(wasteDatasetPath, marineDatasetPath);
+    }
+
+    // Load both datasets and publish them, replaying every row from the
+    // start. Readers keep using the previous datasets until they next pin
+    // (detect() and friends do so on every call). Returns false if either
+    // dataset came up empty.
+    bool reloadDatasets(const std::string& wasteDatasetPath, const std::string& marineDatasetPath) {
+        auto next = std::make_shared<ReplayData>();
+        next->waste = loadDataset<WasteColumns, WasteChunk>("waste", wasteDatasetPath, SnapshotKind::Waste);
+        next->marine = loadDataset<MarineColumns, MarineChunk>("marine", marineDatasetPath, SnapshotKind::Marine);
+        bool loaded = !next->waste->columns.empty() && !next->marine->columns.empty();
+
+        std::lock_guard<InstrumentedMutex> lock(updateMutex);
+        replay.publish(std::move(next));
+        wasteCursor.store(0);
+        marineCursor.store(0);
+
+        if (!loaded) {
+            std::cerr << "Warning: One or both datasets failed to load properly" << std::endl;
+        }
+        return loaded;
+    }
+
+    // A consumer's own replay position, for parallel consumers that should
+    // not share (or contend on) the detector's cursors. It keeps the
+    // datasets it pinned and moves to a newly published version on its
+    // next call, so a frame costs one atomic load and no shared writes.
+    // Must not outlive the detector.
+    class ReplayCursor {
+    private:
+        const AquaticDetector* detector;
+        VersionedPtr<ReplayData>::Pin data;
+        uint64_t marine;
+        uint64_t waste;
+
+    public:
+        ReplayCursor(const AquaticDetector& owner, uint64_t start)
+            : detector(&owner), data(owner.replay.pin()), marine(start), waste(start) {}
+
+        void next(DetectionPair& result) {
+            if (data.version() != detector->replay.latestVersion()) data = detector->replay.pin();
+            replayFrame(*data, marine++, waste++, result);
+        }
+    };
+
+    ReplayCursor replayCursor(uint64_t start = 0) const { return ReplayCursor(*this, start); }
+
+    // Add rows appended to a dataset's CSV: `lines` holds whole lines, in
+    // the file's column order. Detection is never blocked; replay picks
+    // the rows up (through the replay filter, if one is set) on its next
+    // call. Returns false if any line was malformed; the others are kept.
+    bool appendWasteRows(std::string_view lines, AppendStats& result) {
+        return appendRows<WasteColumns, WasteChunk>(lines, result);
+    }
+
+    bool appendMarineRows(std::string_view lines, AppendStats& result) {
+        return appendRows<MarineColumns, MarineChunk>(lines, result);
+    }
+
+    // Re-read one dataset from the file it was loaded from, replacing its
+    // rows and restarting its replay. The replay filter is kept.
+    bool reloadWasteDataset() { return reloadDataset<WasteColumns, WasteChunk>("waste", SnapshotKind::Waste); }
+    bool reloadMarineDataset() { return reloadDataset<MarineColumns, MarineChunk>("marine", SnapshotKind::Marine); }
+
+    std::string getWastePath() const { return replay.pin()->waste->sourcePath; }
+    std::string getMarinePath() const { return replay.pin()->marine->sourcePath; }
+
+    bool useDnnBackend(const InferenceConfig& config) {
+        if (!dnnDetector.load(config)) {
+            std::cerr << "Failed to load detection model: " << config.modelPath << std::endl;
+            return false;
+        }
+        baseInputSize = cv::Size(config.inputWidth, config.inputHeight);
+        backend = DetectorBackend::Dnn;
+        return true;
+    }
+
+    // Run inference at a fraction of the configured input size, rounded to
+    // the 32-pixel stride YOLO models expect. Dataset replay ignores it.
+    void setResolutionScale(float scale) {
+        if (baseInputSize.area() == 0) return;
+        auto scaled = [scale](int pixels) { return std::max(32, static_cast<int>(pixels * scale) / 32 * 32); };
+        dnnDetector.setInputSize(scaled(baseInputSize.width), scaled(baseInputSize.height));
+    }
+
+    void useDatasetBackend() { backend = DetectorBackend::Dataset; }
+
+    // Rows matching `filter`, resolved through the secondary indexes.
+    // Returns false (with `error` set) if a term names an unindexed field.
+    bool queryWaste(const DatasetFilter& filter, RowBitmap& rows, std::string& error) const {
+        return replay.pin()->waste->index.select(filter, rows, error);
+    }
+
+    bool queryMarine(const DatasetFilter& filter, RowBitmap& rows, std::string& error) const {
+        return replay.pin()->marine->index.select(filter, rows, error);
+    }
+
+    DetectionResult wasteDetectionAt(size_t row) const {
+        return wasteRowResult(replay.pin()->waste->columns, row);
+    }
+
+    DetectionResult marineDetectionAt(size_t row) const {
+        return marineRowResult(replay.pin()->marine->columns, row);
+    }
+
+    // Restrict dataset replay to the rows matching a filter, in dataset
+    // order, restarting from the first match. An empty filter replays
+    // every row again. A filter matching nothing suppresses that kind.
+    bool setWasteReplayFilter(const DatasetFilter& filter, std::string& error) {
+        return updateReplayFilter(false, filter, error);
+    }
+
+    bool setMarineReplayFilter(const DatasetFilter& filter, std::string& error) {
+        return updateReplayFilter(true, filter, error);
+    }
+
+    size_t getWasteReplaySize() const { return replay.pin()->wasteRows(); }
+    size_t getMarineReplaySize() const { return replay.pin()->marineRows(); }
+
+    const char* getBackendName() const { return backend == DetectorBackend::Dnn ? "dnn" : "dataset"; }
+
+    InferenceStats getInferenceStats() {
+        if (backend == DetectorBackend::Dnn) return dnnDetector.getStats();
+        InferenceStats stats;
+        stats.frames = datasetFrames.load(std::memory_order_relaxed);
+        stats.batches = datasetBatches.load(std::memory_order_relaxed);
+        stats.seconds = datasetNanoseconds.load(std::memory_order_relaxed) / 1e9;
+        return stats;
+    }
+
+    DetectionPair detect(cv::Mat& frame) {
+        std::vector<DetectionPair> results;
+        detectBatch({frame}, results);
+        return std::move(results.front());
+    }
+
+    // Detect on several frames at once; the dnn backend runs them through a
+    // single forward pass.
+    std::vector<DetectionPair> detectBatch(const std::vector<cv::Mat>& frames) {
+        std::vector<DetectionPair> results;
+        detectBatch(frames, results);
+        return results;
+    }
+
+    // As above, into `results` (resized to one pair per frame). Passing the
+    // same vector back each time lets the dataset backend reuse its
+    // detections' storage, so a steady-state call does not allocate.
+    void detectBatch(const std::vector<cv::Mat>& frames, std::vector<DetectionPair>& results) {
+        if (backend == DetectorBackend::Dnn) {
+            dnnDetector.detectBatch(frames, results);
+        } else {
+            replayDataset(frames.size(), results);
+        }
+    }
+
+    EnvironmentalData readEnvironmentalSensors() {
+        EnvironmentalData data;
+        data.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+        auto pinned = replay.pin();
+        const ReplayData& replayData = *pinned;
+        if (replayData.wasteRows() > 0 && replayData.marineRows() > 0) {
+            const WasteColumns& wasteDataset = replayData.waste->columns;
+            const MarineColumns& marineDataset = replayData.marine->columns;
+            size_t wasteRow = replayData.wasteRow(wasteCursor.load(std::memory_order_relaxed));
+            size_t marineRow = replayData.marineRow(marineCursor.load(std::memory_order_relaxed));
+
+            data.temperature = (wasteDataset.temperature[wasteRow] + marineDataset.temperature[marineRow]) / 2.0f;
+            data.turbidity = wasteDataset.turbidity[wasteRow];
+            data.pH = (wasteDataset.pH[wasteRow] + marineDataset.pH[marineRow]) / 2.0f;
+            data.salinity = marineDataset.salinity[marineRow];
+        } else {
+            // Fallback to random data if datasets not loaded
+            data.temperature = 20.0f + static_cast<float>(rand() % 15);
+            data.turbidity = static_cast<float>(rand() % 50);
+            data.pH = 6.5f + static_cast<float>(rand() % 5) / 2.0f;
+            data.salinity = (rand() % 3 == 0) ? 0.5f : (rand() % 3 == 1) ? 15.0f : 35.0f;
+        }
+
+        return data;
+    }
+
+    // Read-only views for consumers that replay the datasets themselves;
+    // they stay valid across a reload for as long as they are held.
+    std::shared_ptr<const WasteColumns> getWasteDataset() const {
+        auto waste = replay.pin()->waste;
+        return std::shared_ptr<const WasteColumns>(waste, &waste->columns);
+    }
+
+    std::shared_ptr<const MarineColumns> getMarineDataset() const {
+        auto marine = replay.pin()->marine;
+        return std::shared_ptr<const MarineColumns>(marine, &marine->columns);
+    }
+
+    CsvLoadStats getWasteLoadStats() const { return replay.pin()->waste->loadStats; }
+    CsvLoadStats getMarineLoadStats() const { return replay.pin()->marine->loadStats; }
+
+    // Register frame-load latency, dataset update lock contention and cache
+    // counters. Call before detection starts.
+    void instrument(MetricsRegistry& metrics) {
+        frameLoadLatency = &metrics.histogram("aquatic_frame_load_seconds",
+                                              "Time to fetch a frame from the cache or decode it");
+        updateMutex.instrument(
+            &metrics.histogram("aquatic_lock_wait_seconds", "Time spent blocked acquiring a lock", "lock=\"dataset_update\""),
+            &metrics.counter("aquatic_lock_contended_total", "Lock acquisitions that had to wait", "lock=\"dataset_update\""));
+
+        using Type = MetricsRegistry::Type;
+        metrics.sample("aquatic_frame_cache_hits_total", "Frames served from the frame cache", Type::Counter, "",
+                       [this] { return static_cast<double>(frameCache.getStats().hits); });
+        metrics.sample("aquatic_frame_cache_misses_total", "Frames decoded on demand", Type::Counter, "",
+                       [this] { return static_cast<double>(frameCache.getStats().misses); });
+        metrics.sample("aquatic_inference_frames_total", "Frames run through the detector", Type::Counter, "",
+                       [this] { return static_cast<double>(getInferenceStats().frames); });
+    }
+
+    void configureFrameCache(const FrameCacheConfig& config) { frameCache.configure(config); }
+    FrameCacheStats getFrameCacheStats() const { return frameCache.getStats(); }
+
+    // The returned frame may be shared with the frame cache; treat it as
+    // read-only. `imageFile`, if given, receives the image's name.
+    bool captureFrame(cv::Mat& frame, bool isMarine, std::string* imageFile = nullptr) {
+        if (!frame.empty()) {
+            frame.release();
+        }
+
+        // Per thread (one per camera) and reused, like the paths they hold.
+        static thread_local std::string image;
+        static thread_local std::vector<std::string> upcoming;
+        {
+            auto data = replay.pin();
+            uint64_t marine = marineCursor.load(std::memory_order_relaxed);
+            uint64_t waste = wasteCursor.load(std::memory_order_relaxed);
+            if (isMarine && data->marineRows() > 0) {
+                const MarineColumns& columns = data->marine->columns;
+                image.assign(columns.strings.get(columns.imageFileName[data->marineRow(marine)]));
+            } else if (!isMarine && data->wasteRows() > 0) {
+                const WasteColumns& columns = data->waste->columns;
+                image.assign(columns.strings.get(columns.imageFileName[data->wasteRow(waste)]));
+            } else {
+                return false;
+            }
+            upcomingImages(*data, marine, waste, upcoming);
+        }
+
+        // Decode the next images in dataset order while this one is processed.
+        frameCache.prefetch(upcoming);
+
+        if (!loadFrame(image, frame)) {
+            std::cerr << "Error loading image: " << image << std::endl;
+            return false;
+        }
+        if (imageFile) *imageFile = image;
+        return true;
+    }
+
+    // A named image through the frame cache, as captureFrame() loads it.
+    bool loadFrame(const std::string& imageFile, cv::Mat& frame) {
+        ScopedLatency timer(frameLoadLatency);
+        return frameCache.get(imageFile, frame);
+    }
+};
+
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "log_format.hpp"
+#include "pipeline.hpp"
+
+struct AsyncLoggerConfig {
+    size_t queueCapacity = 2048;                      // chunks of LogChunk::kBytes
+    size_t flushBytes = 64 * 1024;                    // flush once this much is buffered...
+    std::chrono::milliseconds flushInterval{500};     // ...or this long after the last flush
+    bool mirrorToConsole = true;
+    bool blockWhenFull = false;                       // default: drop and count instead of stalling
+};
+
+struct AsyncLoggerStats {
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    uint64_t flushes = 0;
+    size_t highWater = 0;
+    size_t capacity = 0;
+};
+
+// One queue slot: a whole record, or a piece of one too long for a slot.
+// The text is stored inline, so logging does not touch the heap.
+struct LogChunk {
+    static constexpr size_t kBytes = 240;
+    char text[kBytes];
+    uint16_t length = 0;
+    bool continues = false; // appends to the long record in progress
+    bool more = false;      // the record goes on in the next chunk
+};
+
+// Logging off the hot path. Producers copy a record (cached timestamp
+// prefix plus message) into a chunk on a lock-free queue, without
+// allocating; a single writer thread appends records to a batch buffer and
+// writes it out when it reaches flushBytes or flushInterval has passed.
+// With nothing queued the writer sleeps until a producer wakes it.
+// Records longer than a chunk (the status block) are queued as a run of
+// chunks, one such record at a time, and reassembled by the writer.
+// stop() and the destructor always drain everything that was accepted.
+class AsyncLogger {
+private:
+    AsyncLoggerConfig config;
+    std::ofstream file;
+    BoundedQueue<LogChunk> queue;
+    std::thread writer;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<bool> mirrorToConsole;
+    std::atomic<bool> blockWhenFull;
+    std::atomic<int> activeProducers{0};
+    std::mutex fileMutex; // uncontended while the writer runs; orders late direct writes
+    std::mutex longRecordMutex; // keeps the chunks of two long records from interleaving
+    std::mutex wakeMutex;
+    std::condition_variable writerWake;
+    std::atomic<bool> writerParked{false}; // producers only take wakeMutex when set
+
+    // "[YYYY-MM-DD HH:MM:SS] " into `prefix`; returns its length.
+    static size_t formatPrefix(time_t now, char (&prefix)[48]) {
+        std::string_view stamp = formatLocalTimestamp(now);
+        if (stamp.empty() || stamp.size() > sizeof(prefix) - 3) {
+            std::memcpy(prefix, "[Invalid Time] ", 15);
+            return 15;
+        }
+        prefix[0] = '[';
+        std::memcpy(prefix + 1, stamp.data(), stamp.size());
+        std::memcpy(prefix + 1 + stamp.size(), "] ", 2);
+        return stamp.size() + 3;
+    }
+
+    // Wakes the writer per chunk, not per record: the rest of a long
+    // record may be waiting for the writer to make room.
+    bool enqueue(LogChunk& chunk, bool block) {
+        bool queued = block ? queue.push(std::move(chunk), OverflowPolicy::Block) : queue.tryPush(std::move(chunk));
+        if (!queued) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        wakeWriter();
+        return true;
+    }
+
+    // Queue prefix + message + newline as chunks. Only the first chunk
+    // may be dropped; once it is in, the rest wait for space so the
+    // writer never sees half a record.
+    void enqueueRecord(std::string_view prefix, std::string_view message, bool block) {
+        const std::string_view parts[] = {prefix, message, "\n"};
+        size_t part = 0, offset = 0;
+        LogChunk chunk;
+        while (true) {
+            chunk.length = 0;
+            while (part < 3 && chunk.length < LogChunk::kBytes) {
+                size_t count = std::min(LogChunk::kBytes - chunk.length, parts[part].size() - offset);
+                std::memcpy(chunk.text + chunk.length, parts[part].data() + offset, count);
+                chunk.length = static_cast<uint16_t>(chunk.length + count);
+                offset += count;
+                if (offset == parts[part].size()) {
+                    ++part;
+                    offset = 0;
+                }
+            }
+            chunk.more = part < 3;
+            if (!enqueue(chunk, block) || !chunk.more) return;
+            chunk.continues = true;
+            block = true;
+        }
+    }
+
+    // The fence pairs with the one in waitForRecords(): either the writer
+    // sees the new chunk before it sleeps, or we see it parked.
+    void wakeWriter() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!writerParked.load(std::memory_order_relaxed)) return;
+        { std::lock_guard<std::mutex> lock(wakeMutex); }
+        writerWake.notify_one();
+    }
+
+    // Sleep until a chunk is queued or stop() is called, and no later than
+    // `deadline` when a batch is waiting to be flushed.
+    void waitForRecords(bool haveBatch, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerParked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto ready = [this] { return !queue.empty() || !running.load(); };
+        if (haveBatch) {
+            writerWake.wait_until(lock, deadline, ready);
+        } else {
+            writerWake.wait(lock, ready);
+        }
+        writerParked.store(false, std::memory_order_relaxed);
+    }
+
+    void writeBatch(std::string& batch) {
+        if (batch.empty()) return;
+        std::lock_guard<std::mutex> lock(fileMutex);
+        file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        file.flush();
+        if (mirrorToConsole.load(std::memory_order_relaxed)) {
+            std::cout.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            std::cout.flush();
+        }
+        flushes.fetch_add(1, std::memory_order_relaxed);
+        batch.clear();
+    }
+
+    void writerLoop() {
+        std::string batch;
+        batch.reserve(config.flushBytes + 4096);
+        std::string pending; // a long record being reassembled
+        LogChunk chunk;
+        auto lastFlush = std::chrono::steady_clock::now();
+
+        while (true) {
+            bool gotRecord = false;
+            while (batch.size() < config.flushBytes && queue.tryPop(chunk)) {
+                std::string_view text(chunk.text, chunk.length);
+                gotRecord = true;
+                if (chunk.continues || chunk.more) {
+                    pending.append(text);
+                    if (chunk.more) continue;
+                    batch.append(pending);
+                    pending.clear();
+                } else {
+                    batch.append(text);
+                }
+                written.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (batch.size() >= config.flushBytes || (!batch.empty() && now - lastFlush >= config.flushInterval)) {
+                writeBatch(batch);
+                lastFlush = now;
+            }
+
+            if (!gotRecord) {
+                if (!running.load()) {
+                    if (activeProducers.load() == 0 && queue.empty()) break;
+                    std::this_thread::yield(); // a producer is finishing its record
+                    continue;
+                }
+                waitForRecords(!batch.empty(), lastFlush + config.flushInterval);
+            }
+        }
+        writeBatch(batch);
+    }
+
+public:
+    explicit AsyncLogger(const std::string& path, const AsyncLoggerConfig& cfg = AsyncLoggerConfig())
+        : config(cfg), queue(cfg.queueCapacity), mirrorToConsole(cfg.mirrorToConsole), blockWhenFull(cfg.blockWhenFull) {
+        file.open(path, std::ios::app);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open log file");
+        }
+        running = true;
+        writer = std::thread([this]() { writerLoop(); });
+    }
+
+    ~AsyncLogger() { stop(); }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void setConsoleMirroring(bool enabled) { mirrorToConsole = enabled; }
+    void setBlockWhenFull(bool enabled) { blockWhenFull = enabled; }
+
+    void log(std::string_view message) {
+        log(message, std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    }
+
+    // Stamp the record with `when` instead of the wall clock (simulated time).
+    void log(std::string_view message, time_t when) {
+        char prefixText[48];
+        std::string_view prefix(prefixText, formatPrefix(when, prefixText));
+
+        // Registering as a producer before checking `running` guarantees the
+        // writer either sees this record in the queue or we see it stopped.
+        activeProducers.fetch_add(1);
+        if (!running.load()) {
+            activeProducers.fetch_sub(1);
+            // Writer stopping or gone (late shutdown messages): write through.
+            std::lock_guard<std::mutex> lock(fileMutex);
+            file << prefix << message << '\n' << std::flush;
+            written.fetch_add(1, std::memory_order_relaxed);
+            if (mirrorToConsole.load(std::memory_order_relaxed)) std::cout << prefix << message << '\n' << std::flush;
+            return;
+        }
+
+        bool block = blockWhenFull.load(std::memory_order_relaxed);
+        if (prefix.size() + message.size() + 1 <= LogChunk::kBytes) {
+            enqueueRecord(prefix, message, block);
+        } else {
+            std::lock_guard<std::mutex> lock(longRecordMutex);
+            enqueueRecord(prefix, message, block);
+        }
+        activeProducers.fetch_sub(1);
+    }
+
+    // Drain everything queued so far and stop the writer. Idempotent.
+    void stop() {
+        if (running.exchange(false)) {
+            { std::lock_guard<std::mutex> lock(wakeMutex); }
+            writerWake.notify_one();
+            if (writer.joinable()) writer.join();
+        }
+    }
+
+    AsyncLoggerStats getStats() const {
+        AsyncLoggerStats stats;
+        stats.written = written.load(std::memory_order_relaxed);
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+        stats.flushes = flushes.load(std::memory_order_relaxed);
+        stats.highWater = queue.highWaterMark();
+        stats.capacity = queue.capacity();
+        return stats;
+    }
+};
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Compare two monitor_bench result files.
+
+    python3 compare_bench.py BASELINE.json CANDIDATE.json [--threshold PERCENT]
+
+Prints the median ns/op of every benchmark in both files and the change.
+Exits with status 1 if any benchmark slowed down by more than the
+threshold (default 5%), so it can gate a CI job.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    return doc.get("context", {}), {b["name"]: b for b in doc["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=5.0, help="regression threshold in percent")
+    args = parser.parse_args()
+
+    base_ctx, base = load(args.baseline)
+    cand_ctx, cand = load(args.candidate)
+    print(f"baseline  {base_ctx.get('revision', '?')} {base_ctx.get('label', '')}")
+    print(f"candidate {cand_ctx.get('revision', '?')} {cand_ctx.get('label', '')}")
+    print(f"{'benchmark':32} {'base ns/op':>14} {'new ns/op':>14} {'change':>9}")
+
+    regressions = 0
+    for name in sorted(set(base) | set(cand)):
+        if name not in base or name not in cand:
+            print(f"{name:32} {'only in ' + ('baseline' if name in base else 'candidate'):>39}")
+            continue
+        old, new = base[name]["ns_per_op"], cand[name]["ns_per_op"]
+        change = (new - old) / old * 100.0 if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:32} {old:14.1f} {new:14.1f} {change:+8.1f}%{flag}")
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,128 @@
+// Dataset replay throughput against reader thread count.
+//
+//   cmake --build build --target contention_bench
+//   ./build/contention_bench [max-threads] [seconds-per-run] [rows]
+//
+// Every reader hammers the detector for a fixed time on seeded synthetic
+// datasets (written to contention_bench_data/). Cases:
+//   detect      detect() on the detector's shared cursors
+//   sensors     readEnvironmentalSensors()
+//   cursor      one ReplayCursor per thread, no shared writes
+//   detect+swap detect() while a writer publishes a new replay filter
+//               every millisecond
+// Readers never take a lock, so total throughput should grow with threads
+// up to the core count and hold beyond it.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aquatic_detector.hpp"
+#include "synthetic_datasets.hpp"
+
+using namespace std;
+namespace fs = filesystem;
+
+// Keeps a result alive so the optimiser cannot drop the work producing it.
+static volatile size_t benchSink;
+
+// Run `body(thread)` on `threads` threads until `seconds` pass; returns
+// operations per second summed over threads. `body` returns the number of
+// operations it just did.
+static double measure(unsigned threads, double seconds, const function<uint64_t(unsigned)>& body) {
+    atomic<bool> start{false}, stop{false};
+    vector<uint64_t> counts(threads * 8, 0); // one cache line apart
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            while (!start.load(memory_order_acquire)) this_thread::yield();
+            uint64_t done = 0;
+            while (!stop.load(memory_order_relaxed)) done += body(t);
+            counts[t * 8] = done;
+        });
+    }
+    auto started = chrono::steady_clock::now();
+    start.store(true, memory_order_release);
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto& worker : workers) worker.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    uint64_t total = 0;
+    for (unsigned t = 0; t < threads; ++t) total += counts[t * 8];
+    return total / elapsed;
+}
+
+int main(int argc, char** argv) {
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 32;
+    double seconds = argc > 2 ? atof(argv[2]) : 0.5;
+    size_t rows = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100000;
+
+    fs::create_directories("contention_bench_data");
+    fs::current_path("contention_bench_data");
+    writeSyntheticWasteCsv("waste.csv", rows);
+    writeSyntheticMarineCsv("marine.csv", rows / 2);
+    AquaticDetector detector("waste.csv", "marine.csv");
+
+    vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    cout << "rows " << rows << ", " << seconds << " s per run, " << thread::hardware_concurrency() << " cores\n";
+    cout << "threads      detect/s     sensors/s      cursor/s  detect+swap/s\n";
+
+    DatasetFilter everything, some;
+    string error;
+    parseDatasetFilter("confidence>=50", some, error);
+
+    for (unsigned threads : threadCounts) {
+        double detect = measure(threads, seconds, [&](unsigned) {
+            cv::Mat frame;
+            benchSink = detector.detect(frame).first.size();
+            return uint64_t{1};
+        });
+        double sensors = measure(threads, seconds, [&](unsigned) {
+            benchSink = static_cast<size_t>(detector.readEnvironmentalSensors().pH);
+            return uint64_t{1};
+        });
+
+        vector<AquaticDetector::ReplayCursor> cursors;
+        for (unsigned t = 0; t < threads; ++t) cursors.push_back(detector.replayCursor(t * 7919u));
+        vector<DetectionPair> results(threads);
+        double cursor = measure(threads, seconds, [&](unsigned t) {
+            cursors[t].next(results[t]);
+            benchSink = results[t].first.size();
+            return uint64_t{1};
+        });
+        cursors.clear();
+
+        atomic<bool> swapping{true};
+        thread writer([&]() {
+            bool toggle = false;
+            string writerError;
+            while (swapping.load()) {
+                detector.setWasteReplayFilter((toggle = !toggle) ? some : everything, writerError);
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+        double swapped = measure(threads, seconds, [&](unsigned) {
+            cv::Mat frame;
+            benchSink = detector.detect(frame).second.size();
+            return uint64_t{1};
+        });
+        swapping = false;
+        writer.join();
+        detector.setWasteReplayFilter(everything, error);
+
+        cout << setw(7) << threads << fixed << setprecision(0) << setw(14) << detect << setw(14) << sensors
+             << setw(14) << cursor << setw(15) << swapped << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Fleet simulation throughput against worker thread count.
+//
+//   g++ -std=c++17 -O3 -march=native -pthread -I.. fleet_bench.cpp -o fleet_bench
+//   ./fleet_bench [buoys] [hours] [max-threads]
+//
+// Uses the synthetic detection model so no dataset is needed. Every thread
+// count simulates the same seeded fleet, so the detection totals must match
+// across rows; only the wall time should change.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "fleet_simulation.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t buoys = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000;
+    float hours = argc > 2 ? static_cast<float>(atof(argv[2])) : 168.0f;
+    unsigned maxThreads = argc > 3 ? static_cast<unsigned>(atoi(argv[3])) : max(1u, thread::hardware_concurrency());
+
+    cout << "buoys " << buoys << ", " << hours << " simulated hours, up to " << maxThreads << " threads\n";
+    cout << "threads  wall(s)   buoys/sec    buoy-hours/sec  speedup  steals    detections\n";
+
+    vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0.0;
+    for (unsigned threads : threadCounts) {
+        FleetConfig config;
+        config.buoys = buoys;
+        FleetSimulation fleet(config);
+        WorkStealingPool pool(threads);
+        FleetStats stats = fleet.run(pool, hours);
+
+        if (threads == 1) baseline = stats.wallSeconds;
+        cout << setw(7) << threads << "  " << fixed << setprecision(3) << setw(8) << stats.wallSeconds << "  "
+             << setprecision(0) << setw(10) << buoys / stats.wallSeconds << "  " << setw(14)
+             << stats.buoyHoursPerSecond() << "  " << setprecision(2) << setw(7) << baseline / stats.wallSeconds
+             << "  " << setw(8) << stats.steals << "  " << stats.detections << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,508 @@
+// Round-trip and torn-tail checks for the history store and the trace
+// format. Built next to the benchmarks and run by ctest; exits non-zero
+// if anything read back differs from what was written.
+//
+//   ./format_check
+//
+// Files are written to the current directory and removed afterwards.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "monitor_trace.hpp"
+#include "timeseries_store.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    if (ok) return;
+    ++failures;
+    cerr << "FAIL: " << what << endl;
+}
+
+static bool sameFloat(float a, float b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+
+static bool closeTo(double a, double b) { return fabs(a - b) <= 1e-6 * max(1.0, fabs(b)); }
+
+// xorshift64: reproducible input without <random>'s distributions, whose
+// output differs between standard libraries.
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static float randomFloat(uint64_t& state, float low, float high) {
+    return low + (high - low) * static_cast<float>(nextRandom(state) % 1000000) / 1000000.0f;
+}
+
+static void appendGarbage(const string& path, size_t bytes) {
+    ofstream out(path, ios::binary | ios::app);
+    uint64_t state = 99;
+    for (size_t i = 0; i < bytes; ++i) out.put(static_cast<char>(nextRandom(state)));
+}
+
+// ---- TimeSeriesStore ------------------------------------------------------
+
+struct StoredDetection {
+    DetectionResult detection;
+    bool isMarine;
+};
+
+// Irregular spacing and values, so every timestamp and float bucket of the
+// tsz codecs is exercised: repeats, small and large jumps, sign changes.
+static vector<EnvironmentalData> sampleEnvironment(size_t count) {
+    vector<EnvironmentalData> points;
+    uint64_t state = 7;
+    time_t time = 1700000000;
+    float temperature = 18.0f;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t r = nextRandom(state) % 10;
+        time += r < 5 ? 300 : r < 8 ? 300 + static_cast<time_t>(nextRandom(state) % 200) : r < 9 ? 1 : 90000;
+        if (r % 3 == 0) temperature = randomFloat(state, -2.0f, 35.0f);
+        EnvironmentalData data;
+        data.timestamp = time;
+        data.temperature = temperature;
+        data.turbidity = i % 7 == 0 ? 0.0f : randomFloat(state, 0.0f, 1000.0f);
+        data.pH = 8.1f;
+        data.salinity = randomFloat(state, -1e6f, 1e6f);
+        points.push_back(data);
+    }
+    return points;
+}
+
+static vector<StoredDetection> sampleDetections(size_t count) {
+    const vector<string> labels = {"Plastic Bottle", "Fishing Net", "Sea Turtle", "Bottlenose Dolphin",
+                                   string(300, 'x'), ""};
+    const vector<string> activities = {"", "Swimming", "Feeding", "Resting near the surface for a while"};
+    vector<StoredDetection> points;
+    uint64_t state = 11;
+    time_t time = 1700000000;
+    for (size_t i = 0; i < count; ++i) {
+        time += static_cast<time_t>(nextRandom(state) % 900);
+        StoredDetection stored;
+        stored.isMarine = nextRandom(state) % 2 == 0;
+        stored.detection.label = labels[nextRandom(state) % labels.size()];
+        stored.detection.activity = stored.isMarine ? activities[nextRandom(state) % activities.size()] : "";
+        stored.detection.confidence = randomFloat(state, 0.0f, 100.0f);
+        stored.detection.size = i % 5 == 0 ? 0.0f : randomFloat(state, 0.5f, 400.0f);
+        stored.detection.timestamp = time;
+        points.push_back(stored);
+    }
+    return points;
+}
+
+// Everything `store` returns equals the first `envCount`/`detectionCount`
+// points written, and its aggregates match ones computed here.
+static void checkStoreContents(const TimeSeriesStore& store, const vector<EnvironmentalData>& env, size_t envCount,
+                               const vector<StoredDetection>& detections, size_t detectionCount,
+                               const string& stage) {
+    vector<EnvironmentalData> readEnv;
+    store.scanEnvironment(numeric_limits<time_t>::min() / 2, numeric_limits<time_t>::max() / 2,
+                          [&](const EnvironmentalData& data) { readEnv.push_back(data); });
+    check(readEnv.size() == envCount, stage + ": environment point count");
+    for (size_t i = 0; i < min(readEnv.size(), envCount); ++i) {
+        const EnvironmentalData& a = readEnv[i];
+        const EnvironmentalData& b = env[i];
+        if (a.timestamp != b.timestamp || !sameFloat(a.temperature, b.temperature) ||
+            !sameFloat(a.turbidity, b.turbidity) || !sameFloat(a.pH, b.pH) || !sameFloat(a.salinity, b.salinity)) {
+            check(false, stage + ": environment point " + to_string(i));
+            break;
+        }
+    }
+
+    vector<StoredDetection> readDetections;
+    store.scanDetections(numeric_limits<time_t>::min() / 2, numeric_limits<time_t>::max() / 2,
+                         [&](const DetectionResult& detection, bool isMarine) {
+                             readDetections.push_back({detection, isMarine});
+                         });
+    check(readDetections.size() == detectionCount, stage + ": detection count");
+    for (size_t i = 0; i < min(readDetections.size(), detectionCount); ++i) {
+        const StoredDetection& a = readDetections[i];
+        const StoredDetection& b = detections[i];
+        if (a.isMarine != b.isMarine || a.detection.label != b.detection.label ||
+            a.detection.activity != b.detection.activity || a.detection.timestamp != b.detection.timestamp ||
+            !sameFloat(a.detection.confidence, b.detection.confidence) ||
+            !sameFloat(a.detection.size, b.detection.size)) {
+            check(false, stage + ": detection " + to_string(i));
+            break;
+        }
+    }
+
+    // A range that cuts through blocks, so both the header aggregates and
+    // the decoder contribute.
+    if (envCount > 10) {
+        time_t from = env[envCount / 5].timestamp, to = env[envCount * 4 / 5].timestamp;
+        RangeAggregate expected;
+        for (size_t i = 0; i < envCount; ++i) {
+            if (env[i].timestamp >= from && env[i].timestamp <= to) expected.add(env[i].salinity);
+        }
+        QueryCost cost;
+        RangeAggregate got = store.aggregateEnvironment(from, to, EnvChannel::Salinity, &cost);
+        check(got.count == expected.count && sameFloat(got.min, expected.min) && sameFloat(got.max, expected.max) &&
+                  closeTo(got.sum, expected.sum),
+              stage + ": environment aggregate");
+        check(cost.blocksFromIndex > 0 && cost.blocksDecoded > 0, stage + ": aggregate used index and decoder");
+    }
+    if (detectionCount > 10) {
+        time_t from = detections[detectionCount / 3].detection.timestamp;
+        time_t to = detections[detectionCount - 1].detection.timestamp;
+        DetectionAggregate expected;
+        for (size_t i = 0; i < detectionCount; ++i) {
+            const StoredDetection& d = detections[i];
+            if (d.detection.timestamp < from || d.detection.timestamp > to) continue;
+            ++(d.isMarine ? expected.marine : expected.waste);
+            expected.confidence.add(d.detection.confidence);
+            expected.size.add(d.detection.size);
+        }
+        DetectionAggregate got = store.aggregateDetections(from, to);
+        check(got.marine == expected.marine && got.waste == expected.waste &&
+                  got.confidence.count == expected.confidence.count &&
+                  sameFloat(got.confidence.max, expected.confidence.max) &&
+                  sameFloat(got.size.min, expected.size.min) && closeTo(got.size.sum, expected.size.sum),
+              stage + ": detection aggregate");
+    }
+}
+
+static void checkTimeSeriesStore() {
+    const string path = "format_check_history.aqts";
+    remove(path.c_str());
+    TimeSeriesConfig config;
+    config.blockPoints = 256;
+    config.maxPendingSeconds = 0; // full blocks only; checkTimeBoundSeal() covers the rest
+    vector<EnvironmentalData> env = sampleEnvironment(3000);
+    vector<StoredDetection> detections = sampleDetections(2000);
+
+    {
+        TimeSeriesStore store(config);
+        check(store.open(path), "store: create");
+        for (size_t i = 0; i < env.size(); ++i) {
+            store.appendEnvironment(env[i]);
+            if (i < detections.size()) store.appendDetection(detections[i].detection, detections[i].isMarine);
+        }
+        // Sealed blocks plus the unsealed tail.
+        checkStoreContents(store, env, env.size(), detections, detections.size(), "store before close");
+        check(store.getStats().pendingPoints > 0, "store: some points still pending");
+    }
+
+    size_t sealedEnv, sealedDetections;
+    uint64_t fileBytes;
+    {
+        TimeSeriesStore store(config);
+        check(store.open(path), "store: reopen");
+        TimeSeriesStats stats = store.getStats();
+        check(stats.points == env.size() + detections.size() && stats.recoveredBytes == 0, "store: reopened stats");
+        check(stats.compressionRatio() > 1.0, "store: compresses");
+        checkStoreContents(store, env, env.size(), detections, detections.size(), "store after reopen");
+        sealedEnv = env.size();
+        sealedDetections = detections.size();
+        fileBytes = stats.fileBytes;
+    }
+
+    // Garbage after the last block, as left by a crash mid-write.
+    appendGarbage(path, 777);
+    {
+        TimeSeriesStore store(config);
+        check(store.open(path), "store: open with garbage tail");
+        TimeSeriesStats stats = store.getStats();
+        check(stats.recoveredBytes == 777 && stats.fileBytes == fileBytes, "store: garbage tail discarded");
+        checkStoreContents(store, env, sealedEnv, detections, sealedDetections, "store after garbage tail");
+    }
+
+    // A block cut short: everything before it survives, and appending
+    // afterwards continues a readable file.
+    filesystem::resize_file(path, fileBytes - 100);
+    {
+        TimeSeriesStore store(config);
+        check(store.open(path), "store: open with torn block");
+        TimeSeriesStats stats = store.getStats();
+        check(stats.recoveredBytes > 0 && stats.points < env.size() + detections.size(),
+              "store: torn block discarded");
+        vector<EnvironmentalData> readEnv;
+        store.scanEnvironment(0, numeric_limits<time_t>::max() / 2,
+                              [&](const EnvironmentalData& data) { readEnv.push_back(data); });
+        size_t kept = readEnv.size();
+        size_t keptDetections = stats.points - kept;
+        checkStoreContents(store, env, kept, detections, keptDetections, "store after torn block");
+
+        for (size_t i = kept; i < env.size(); ++i) store.appendEnvironment(env[i]);
+        for (size_t i = keptDetections; i < detections.size(); ++i) {
+            store.appendDetection(detections[i].detection, detections[i].isMarine);
+        }
+    }
+    {
+        TimeSeriesStore store(config);
+        check(store.open(path), "store: reopen after repair");
+        check(store.getStats().recoveredBytes == 0, "store: no tail after repair");
+        checkStoreContents(store, env, env.size(), detections, detections.size(), "store after repair");
+    }
+    remove(path.c_str());
+}
+
+// A series that fills blocks slowly still reaches disk once its oldest
+// pending point is maxPendingSeconds old; sensor samples age out quiet
+// detections too.
+static void checkTimeBoundSeal() {
+    const string path = "format_check_aging.aqts";
+    remove(path.c_str());
+    TimeSeriesConfig config;
+    config.maxPendingSeconds = 3600;
+    TimeSeriesStore store(config);
+    check(store.open(path), "aging: create");
+
+    DetectionResult detection;
+    detection.label = "Fishing Net";
+    detection.confidence = 80.0f;
+    detection.size = 12.0f;
+    detection.timestamp = 1700000000;
+    store.appendDetection(detection, false);
+    EnvironmentalData data{};
+    for (time_t t = 1700000000; t < 1700000000 + 3600; t += 300) {
+        data.timestamp = t;
+        store.appendEnvironment(data);
+    }
+    check(store.getStats().blocks == 0 && store.getStats().pendingPoints == 13, "aging: nothing sealed early");
+    data.timestamp = 1700000000 + 3600;
+    store.appendEnvironment(data);
+    TimeSeriesStats stats = store.getStats();
+    check(stats.blocks == 2 && stats.pendingPoints == 0, "aging: both series sealed after maxPendingSeconds");
+    store.close();
+    remove(path.c_str());
+}
+
+// ---- Trace ----------------------------------------------------------------
+
+constexpr uint32_t kTraceCameras = 2;
+
+struct TraceStep {
+    EnvironmentalData environment;
+    TraceFrame frames[kTraceCameras];
+    bool detected[kTraceCameras]; // false: the frame's detections were dropped
+    DetectionPair detections[kTraceCameras];
+};
+
+static bool sameDetections(const vector<DetectionResult>& a, const vector<DetectionResult>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].label != b[i].label || a[i].activity != b[i].activity || a[i].timestamp != b[i].timestamp ||
+            !sameFloat(a[i].confidence, b[i].confidence) || !sameFloat(a[i].size, b[i].size) ||
+            a[i].box.x != b[i].box.x || a[i].box.y != b[i].box.y || a[i].box.width != b[i].box.width ||
+            a[i].box.height != b[i].box.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static vector<TraceStep> sampleTrace(size_t count) {
+    const vector<string> labels = {"Plastic Bottle", "Fishing Net", "Sea Turtle", "Jellyfish", ""};
+    vector<EnvironmentalData> env = sampleEnvironment(count);
+    vector<TraceStep> steps(count);
+    uint64_t state = 23;
+    for (size_t i = 0; i < count; ++i) {
+        TraceStep& step = steps[i];
+        step.environment = env[i];
+        for (uint32_t camera = 0; camera < kTraceCameras; ++camera) {
+            TraceFrame& frame = step.frames[camera];
+            frame.camera = camera;
+            frame.sequence = i;
+            frame.isMarine = nextRandom(state) % 3 != 0;
+            // Mostly repeats, to exercise the per-block string table.
+            frame.image = i % 11 == 0 ? "unique_" + to_string(i) + ".jpg" : labels[i % 4] + ".jpg";
+            frame.time = env[i].timestamp;
+
+            step.detected[camera] = nextRandom(state) % 17 != 0;
+            if (!step.detected[camera]) continue;
+            for (vector<DetectionResult>* found : {&step.detections[camera].first, &step.detections[camera].second}) {
+                size_t n = nextRandom(state) % 3;
+                for (size_t k = 0; k < n; ++k) {
+                    DetectionResult detection;
+                    detection.label = labels[nextRandom(state) % labels.size()];
+                    detection.activity = found == &step.detections[camera].first ? "Swimming" : "";
+                    detection.confidence = randomFloat(state, 0.0f, 100.0f);
+                    detection.size = randomFloat(state, 0.0f, 400.0f);
+                    detection.timestamp = env[i].timestamp - static_cast<time_t>(k);
+                    detection.box.x = static_cast<int>(nextRandom(state) % 640) - 20;
+                    detection.box.y = static_cast<int>(nextRandom(state) % 480);
+                    detection.box.width = static_cast<int>(nextRandom(state) % 100);
+                    detection.box.height = static_cast<int>(nextRandom(state) % 100);
+                    found->push_back(detection);
+                }
+            }
+        }
+    }
+    return steps;
+}
+
+// Records detections up to `kLag` frames late and out of sequence order,
+// as several detect workers would.
+static TraceStats writeTrace(const string& path, const TraceHeader& header, const vector<TraceStep>& steps) {
+    constexpr size_t kLag = 8;
+    TraceWriter writer;
+    check(writer.open(path, header, 2048), "trace: create");
+    vector<size_t> late;
+    auto recordLate = [&]() {
+        for (auto j = late.rbegin(); j != late.rend(); ++j) {
+            for (uint32_t camera = 0; camera < kTraceCameras; ++camera) {
+                const TraceStep& step = steps[*j];
+                if (step.detected[camera]) {
+                    writer.recordDetections(camera, *j, step.frames[camera].time + 2, step.detections[camera]);
+                }
+            }
+        }
+        late.clear();
+    };
+    for (size_t i = 0; i < steps.size(); ++i) {
+        writer.recordEnvironment(steps[i].environment);
+        for (uint32_t camera = 0; camera < kTraceCameras; ++camera) writer.recordFrame(steps[i].frames[camera]);
+        late.push_back(i);
+        if (late.size() == kLag) recordLate();
+    }
+    recordLate();
+    writer.close();
+    return writer.getStats();
+}
+
+// Replays `path` the way --replay does and checks it against `steps`.
+// Returns how many steps came back whole.
+static size_t replayTrace(TraceReader& reader, const vector<TraceStep>& steps, size_t first, const string& stage) {
+    size_t step = first;
+    for (; step < steps.size(); ++step) {
+        EnvironmentalData data{};
+        if (!reader.nextEnvironment(data)) break;
+        const EnvironmentalData& expected = steps[step].environment;
+        if (data.timestamp != expected.timestamp || !sameFloat(data.temperature, expected.temperature) ||
+            !sameFloat(data.turbidity, expected.turbidity) || !sameFloat(data.pH, expected.pH) ||
+            !sameFloat(data.salinity, expected.salinity)) {
+            check(false, stage + ": environment record " + to_string(step));
+            return step;
+        }
+        bool whole = true;
+        for (uint32_t camera = 0; camera < kTraceCameras; ++camera) {
+            TraceFrame frame;
+            if (!reader.nextFrame(camera, frame)) {
+                whole = false;
+                continue;
+            }
+            const TraceFrame& expectedFrame = steps[step].frames[camera];
+            if (frame.camera != camera || frame.sequence != expectedFrame.sequence ||
+                frame.isMarine != expectedFrame.isMarine || frame.image != expectedFrame.image ||
+                frame.time != expectedFrame.time) {
+                check(false, stage + ": frame record " + to_string(step));
+                return step;
+            }
+            DetectionPair found;
+            bool any = reader.detectionsFor(camera, step, found);
+            if (any && (!steps[step].detected[camera] ||
+                        !sameDetections(found.first, steps[step].detections[camera].first) ||
+                        !sameDetections(found.second, steps[step].detections[camera].second))) {
+                check(false, stage + ": detection record " + to_string(step));
+                return step;
+            }
+            if (any != steps[step].detected[camera]) whole = false;
+        }
+        if (!whole) break;
+    }
+    return step;
+}
+
+static void checkTrace() {
+    const string path = "format_check_trace.aqtrace";
+    remove(path.c_str());
+    TraceHeader header;
+    header.seed = 3;
+    header.start = chrono::system_clock::time_point(chrono::seconds(1700000000));
+    header.hours = 2.5f;
+    vector<TraceStep> steps = sampleTrace(1500);
+    TraceStats written = writeTrace(path, header, steps);
+    check(written.blocks > 50, "trace: spans many blocks");
+
+    uint64_t fileBytes = filesystem::file_size(path);
+    {
+        TraceReader reader;
+        check(reader.open(path), "trace: open");
+        check(reader.getHeader().seed == header.seed && reader.getHeader().start == header.start &&
+                  sameFloat(reader.getHeader().hours, header.hours),
+              "trace: header");
+        check(reader.blockCount() == written.blocks && reader.recordCount() == written.records(),
+              "trace: block index");
+        check(reader.endTime() == steps.back().frames[0].time + 2, "trace: end time");
+        check(replayTrace(reader, steps, 0, "trace") == steps.size(), "trace: every step replayed");
+        check(reader.getCorruptBlocks() == 0, "trace: no corrupt blocks");
+        TraceStats consumed = reader.getConsumed();
+        check(consumed.environment == written.environment && consumed.frames == written.frames &&
+                  consumed.detections == written.detections,
+              "trace: every record consumed");
+
+        // Resume from the middle, as a seek does.
+        int64_t middle = steps[steps.size() / 2].environment.timestamp;
+        reader.seek(middle);
+        EnvironmentalData data{};
+        check(reader.nextEnvironment(data), "trace: read after seek");
+        size_t resume = 0;
+        while (resume < steps.size() && steps[resume].environment.timestamp != data.timestamp) ++resume;
+        check(resume > 0 && resume < steps.size() && data.timestamp <= middle, "trace: seek lands before target");
+    }
+
+    // Garbage after the last block: ignored, every block still replays.
+    appendGarbage(path, 333);
+    {
+        TraceReader reader;
+        check(reader.open(path), "trace: open with garbage tail");
+        check(reader.blockCount() == written.blocks, "trace: garbage tail ignored");
+        check(replayTrace(reader, steps, 0, "trace with garbage tail") == steps.size(),
+              "trace: every step replayed despite garbage tail");
+    }
+
+    // A torn last block: what precedes it replays, nothing after.
+    filesystem::resize_file(path, fileBytes - 10);
+    size_t tornSteps;
+    {
+        TraceReader reader;
+        check(reader.open(path), "trace: open with torn block");
+        check(reader.blockCount() == written.blocks - 1, "trace: torn block dropped");
+        tornSteps = replayTrace(reader, steps, 0, "torn trace");
+        check(tornSteps > 0 && tornSteps < steps.size(), "trace: torn trace replays a prefix");
+    }
+
+    // A damaged payload in the middle: replay stops at that block.
+    {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekp(static_cast<streamoff>(fileBytes / 2));
+        file.put('\x5a');
+    }
+    {
+        TraceReader reader;
+        check(reader.open(path), "trace: open with damaged block");
+        size_t replayed = replayTrace(reader, steps, 0, "damaged trace");
+        check(replayed > 0 && replayed < tornSteps, "trace: damaged trace replays a prefix");
+        check(reader.getCorruptBlocks() > 0 || reader.blockCount() < written.blocks - 1,
+              "trace: damaged block detected");
+    }
+    remove(path.c_str());
+}
+
+int main() {
+    checkTimeSeriesStore();
+    checkTimeBoundSeal();
+    checkTrace();
+
+    if (failures) {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "format_check: all checks passed" << endl;
+    return 0;
+}
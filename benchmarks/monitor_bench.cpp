@@ -0,0 +1,434 @@
+// Microbenchmarks for the monitor's hot paths.
+//
+//   cmake --build build --target monitor_bench
+//   ./build/monitor_bench [--filter TEXT] [--min-time SECONDS] [--repetitions N]
+//                         [--rows N] [--out FILE] [--label TEXT]
+//
+// Runs in a scratch directory (monitor_bench_data/) holding seeded
+// synthetic datasets and images, so no real data is needed. A summary goes
+// to stdout and the full results to --out (default monitor_bench.json):
+// one object per benchmark with the median, min and max ns per operation
+// over the repetitions. Compare two result files with compare_bench.py.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "floating_monitor.hpp"
+#include "synthetic_datasets.hpp"
+
+#ifndef AQUATIC_GIT_REVISION
+#define AQUATIC_GIT_REVISION "unknown"
+#endif
+
+using namespace std;
+namespace fs = filesystem;
+
+// Keeps a result alive so the optimiser cannot drop the work producing it.
+static volatile size_t benchSink;
+
+struct BenchResult {
+    string name;
+    uint64_t iterations = 0;  // per repetition
+    vector<double> nsPerOp;   // one entry per repetition
+    double itemsPerOp = 0.0;  // e.g. rows per CSV load; 0 if not meaningful
+    map<string, double> counters;
+
+    double median() const {
+        vector<double> sorted = nsPerOp;
+        sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    }
+    double min() const { return *min_element(nsPerOp.begin(), nsPerOp.end()); }
+    double max() const { return *max_element(nsPerOp.begin(), nsPerOp.end()); }
+};
+
+class BenchRunner {
+private:
+    double minSeconds;
+    int repetitions;
+    string filter;
+    vector<BenchResult> results;
+
+    static double timeIterations(const function<void(uint64_t)>& body, uint64_t iterations) {
+        auto started = chrono::steady_clock::now();
+        body(iterations);
+        return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    }
+
+public:
+    BenchRunner(double minTime, int reps, string nameFilter)
+        : minSeconds(minTime), repetitions(reps), filter(move(nameFilter)) {}
+
+    bool selected(const string& name) const { return filter.empty() || name.find(filter) != string::npos; }
+
+    // `body(n)` performs the operation n times. The iteration count is
+    // grown until one repetition takes at least --min-time.
+    BenchResult* run(const string& name, const function<void(uint64_t)>& body, double itemsPerOp = 0.0) {
+        if (!selected(name)) return nullptr;
+
+        uint64_t iterations = 1;
+        double seconds = timeIterations(body, iterations);
+        while (seconds < minSeconds && iterations < (uint64_t{1} << 40)) {
+            double scale = seconds > 0.0 ? minSeconds / seconds * 1.2 : 10.0;
+            iterations = max(iterations + 1, static_cast<uint64_t>(iterations * min(scale, 10.0)));
+            seconds = timeIterations(body, iterations);
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.iterations = iterations;
+        result.itemsPerOp = itemsPerOp;
+        for (int r = 0; r < repetitions; ++r) {
+            result.nsPerOp.push_back(timeIterations(body, iterations) * 1e9 / iterations);
+        }
+
+        cout << left << setw(32) << name << right << fixed << setprecision(1) << setw(14) << result.median()
+             << " ns/op" << setw(12) << iterations << " iter";
+        if (itemsPerOp > 0) cout << setprecision(0) << setw(14) << itemsPerOp * 1e9 / result.median() << " items/s";
+        cout << defaultfloat << endl;
+
+        results.push_back(move(result));
+        return &results.back();
+    }
+
+    bool writeJson(const string& path, const string& label) const {
+        ofstream out(path);
+        if (!out) return false;
+        time_t now = time(nullptr);
+        char date[32];
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+        out << "{\n  \"context\": {\"revision\": \"" << AQUATIC_GIT_REVISION << "\", \"label\": \"" << label
+            << "\", \"date\": \"" << date << "\", \"threads\": " << thread::hardware_concurrency()
+            << ", \"min_time_s\": " << minSeconds << ", \"repetitions\": " << repetitions << "},\n";
+        out << "  \"benchmarks\": [\n";
+        out << setprecision(6);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.median() << ", \"ns_per_op_min\": " << r.min()
+                << ", \"ns_per_op_max\": " << r.max();
+            if (r.itemsPerOp > 0) out << ", \"items_per_second\": " << r.itemsPerOp * 1e9 / r.median();
+            for (const auto& [counter, value] : r.counters) out << ", \"" << counter << "\": " << value;
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+// Synthetic datasets under the names AquaticDetector loads by default,
+// and a small set of images for the frame cache to decode.
+static void prepareData(size_t rows) {
+    const size_t images = 64;
+    writeSyntheticWasteCsv("waste_detection_with_images_dataset.csv", rows, images);
+    writeSyntheticMarineCsv("expanded_marine_animal_2_dataset.csv", rows / 2, images);
+    writeSyntheticWasteCsv("csv_bench_waste.csv", rows);
+
+    cv::Mat image(480, 640, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+    for (size_t i = 0; i < images; ++i) {
+        if (!fs::exists("img_" + to_string(i) + ".jpg")) cv::imwrite("img_" + to_string(i) + ".jpg", image);
+        if (!fs::exists("m_" + to_string(i) + ".jpg")) cv::imwrite("m_" + to_string(i) + ".jpg", image);
+    }
+}
+
+int main(int argc, char** argv) {
+    string filter, outPath = "monitor_bench.json", label;
+    double minTime = 0.2;
+    int repetitions = 5;
+    size_t rows = 100000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i], value = argv[i + 1];
+        if (arg == "--filter") filter = value;
+        else if (arg == "--min-time") minTime = atof(value.c_str());
+        else if (arg == "--repetitions") repetitions = max(1, atoi(value.c_str()));
+        else if (arg == "--rows") rows = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--out") outPath = value;
+        else if (arg == "--label") label = value;
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+    outPath = fs::absolute(outPath).string();
+
+    fs::create_directories("monitor_bench_data");
+    fs::current_path("monitor_bench_data");
+    prepareData(rows);
+
+    BenchRunner bench(minTime, repetitions, filter);
+
+    bench.run("csv_load/waste", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            WasteColumns columns;
+            loadCsvParallel<WasteChunk::FieldCount, WasteChunk>(
+                "csv_bench_waste.csv", [&columns](const WasteChunk& chunk) { chunk.mergeInto(columns); });
+            benchSink = columns.rowCount();
+        }
+    }, static_cast<double>(rows));
+
+    EnvironmentalData env{21.5f, 12.0f, 7.9f, 35.0f, time(nullptr)};
+    bench.run("to_string/environmental", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink = env.toString().size();
+    });
+
+    DetectionResult detection;
+    detection.label = "Plastic (Bottle)";
+    detection.confidence = 87.5f;
+    detection.size = 23.4f;
+    detection.activity = "Floating";
+    detection.timestamp = time(nullptr);
+    bench.run("to_string/detection", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) benchSink = detection.toString().size();
+    });
+
+    // The allocation-free path the monitor logs through.
+    LogLine line;
+    bench.run("format/environmental", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            line.clear();
+            env.appendTo(line);
+            benchSink = line.size();
+        }
+    });
+    bench.run("format/detection", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            line.clear();
+            detection.appendTo(line);
+            benchSink = line.size();
+        }
+    });
+
+    LatencyHistogram histogram;
+    bench.run("metrics/histogram_record", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) histogram.record((i * 2654435761u) & 0xfffff);
+    });
+    bench.run("metrics/scoped_latency", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) ScopedLatency timer(&histogram);
+    });
+
+    if (bench.selected("motion_gate")) {
+        // The pre-filter's own cost per camera frame; compare with detect/*.
+        cv::Mat still(480, 640, CV_8UC3), moved;
+        cv::randu(still, cv::Scalar::all(0), cv::Scalar::all(255));
+        moved = still.clone();
+        moved(cv::Rect(200, 150, 80, 60)).setTo(cv::Scalar::all(255));
+        MotionGateConfig config;
+        config.enabled = true;
+        config.refreshEvery = 0;
+        MotionGate gate;
+        gate.configure(config);
+        bench.run("motion_gate/static_640x480", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) benchSink = gate.evaluate(still).changed;
+        });
+        bench.run("motion_gate/moving_640x480", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                MotionDecision decision = gate.evaluate(i & 1 ? moved : still);
+                benchSink = gate.detectorRegion(moved, decision).width;
+            }
+        });
+    }
+
+    if (bench.selected("track")) {
+        // Ten drifting objects; detector output every other frame.
+        TrackerConfig config;
+        config.enabled = true;
+        ObjectTracker tracker;
+        tracker.configure(config);
+        DetectionPair detections, fresh;
+        bench.run("track/10_objects", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                if (i & 1) {
+                    tracker.predict(detections);
+                } else {
+                    detections.first.clear();
+                    detections.second.assign(10, detection);
+                    for (int k = 0; k < 10; ++k) {
+                        detections.second[k].box = cv::Rect(k * 60 + static_cast<int>(i % 64), 100, 40, 40);
+                    }
+                    tracker.update(detections, fresh);
+                }
+                benchSink = detections.second.size();
+            }
+        });
+    }
+
+    if (bench.selected("trace")) {
+        // One frame's worth of records: capture plus a waste detection.
+        DetectionPair found;
+        found.second.push_back(detection);
+        TraceHeader header;
+        header.start = chrono::system_clock::now();
+        TraceWriter writer;
+        writer.open("bench_trace.aqtr", header);
+        uint64_t written = 0;
+        bench.run("trace/record_frame", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i, ++written) {
+                writer.recordFrame({0, written, false, "img_123.jpg", detection.timestamp});
+                writer.recordDetections(0, written, detection.timestamp, found);
+            }
+        });
+        writer.close();
+
+        bench.run("trace/replay_frame", [&](uint64_t n) {
+            TraceReader reader;
+            reader.open("bench_trace.aqtr");
+            TraceFrame frame;
+            DetectionPair replayed;
+            for (uint64_t i = 0; i < n; ++i) {
+                if (!reader.nextFrame(0, frame)) {
+                    reader.seek(0); // wrap around
+                    reader.nextFrame(0, frame);
+                }
+                reader.detectionsFor(0, frame.sequence, replayed);
+                benchSink = replayed.second.size();
+            }
+        });
+    }
+
+    if (bench.selected("archive")) {
+        // The action stage's cost to hand off a frame, and the encoders'
+        // throughput when nothing may be dropped.
+        cv::Mat frame(480, 640, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        DetectionPair found;
+        found.second.push_back(detection);
+        found.second.back().box = cv::Rect(200, 150, 80, 60);
+        ArchiveConfig config;
+        config.directory = "bench_archive";
+        config.budgetBytes = 16ull * 1024 * 1024;
+        FrameArchive archive;
+        archive.start(config);
+        bench.run("archive/submit_640x480", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) archive.submit(frame, found, "camera", detection.timestamp);
+        });
+        archive.stop();
+
+        config.overflow = OverflowPolicy::Block;
+        bench.run("archive/write_640x480", [&](uint64_t n) {
+            archive.start(config);
+            for (uint64_t i = 0; i < n; ++i) archive.submit(frame, found, "camera", detection.timestamp);
+            archive.stop();
+            benchSink = archive.getStats().written;
+        });
+        filesystem::remove_all(config.directory);
+    }
+
+    if (bench.selected("detect") || bench.selected("capture")) {
+        AquaticDetector detector;
+        cv::Mat frame;
+        bench.run("detect/dataset", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) benchSink = detector.detect(frame).first.size();
+        });
+        // One call for a frame from each of the buoy's three cameras.
+        vector<cv::Mat> frames(3);
+        bench.run("detect_batch/dataset_x3", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) benchSink = detector.detectBatch(frames).size();
+        }, 3.0);
+        bench.run("capture_frame/cached", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) benchSink = detector.captureFrame(frame, i & 1);
+        });
+    }
+
+    if (bench.selected("ingest")) {
+        // A fresh copy each run, since both cases grow it.
+        writeSyntheticWasteCsv("ingest_waste.csv", rows);
+        writeSyntheticWasteCsv("ingest_batch.csv", 100);
+        ifstream batchFile("ingest_batch.csv");
+        string line, batch;
+        for (int skip = 0; skip < 2 && getline(batchFile, line); ++skip) {
+        }
+        while (getline(batchFile, line)) batch += line + "\n";
+
+        AquaticDetector detector("ingest_waste.csv", "expanded_marine_animal_2_dataset.csv");
+        bench.run("ingest/append_100_rows", [&](uint64_t n) {
+            AppendStats result;
+            for (uint64_t i = 0; i < n; ++i) detector.appendWasteRows(batch, result);
+        }, 100.0);
+
+        // Append to the file and wait until replay can see the rows: the
+        // ingestion lag, notification included.
+        IngestConfig config;
+        config.minBatchInterval = chrono::milliseconds(0);
+        DatasetIngester ingester(detector, config);
+        ingester.start();
+        bench.run("ingest/file_to_replay_100_rows", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t before = detector.getWasteDataset()->rowCount();
+                {
+                    ofstream out("ingest_waste.csv", ios::app);
+                    out << batch;
+                }
+                while (detector.getWasteDataset()->rowCount() == before) this_thread::yield();
+            }
+        }, 100.0);
+        ingester.stop();
+    }
+
+    if (bench.selected("log_data") || bench.selected("run_iteration")) {
+        FloatingAquaticMonitor monitor;
+        monitor.setConsoleLogging(false);
+        monitor.openHistory("bench_history.aqts");
+
+        const string record = "Environmental Data: " + env.toString();
+        AsyncLoggerStats before = monitor.getLoggerStats();
+        if (BenchResult* result = bench.run("log_data", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) monitor.logData(record);
+            })) {
+            AsyncLoggerStats after = monitor.getLoggerStats();
+            uint64_t offered = (after.written + after.dropped) - (before.written + before.dropped);
+            result->counters["dropped_fraction"] =
+                offered ? static_cast<double>(after.dropped - before.dropped) / offered : 0.0;
+        }
+
+        // Each iteration handles whatever is due at the current virtual
+        // time, then jumps to the next scheduled event.
+        monitor.simulate(24.0f * 365.0f * 100.0f);
+        monitor.beginRun();
+        if (BenchResult* result = bench.run("run_iteration/simulated", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) benchSink = monitor.runIteration();
+            })) {
+            SimulationStats sim = monitor.getSimulationStats();
+            result->counters["simulated_hours_per_iteration"] = sim.events ? sim.simulatedHours / sim.events : 0.0;
+        }
+        monitor.endRun();
+    }
+
+    // Same loop with every stage timed, to measure instrumentation overhead
+    // against run_iteration/simulated.
+    if (bench.selected("run_iteration")) {
+        FloatingAquaticMonitor monitor;
+        monitor.setConsoleLogging(false);
+        monitor.openHistory("bench_history_metrics.aqts");
+        monitor.enableMetrics("bench_metrics.prom");
+        monitor.simulate(24.0f * 365.0f * 100.0f);
+        monitor.beginRun();
+        bench.run("run_iteration/simulated_metrics", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) benchSink = monitor.runIteration();
+        });
+        monitor.endRun();
+    }
+
+    if (!bench.writeJson(outPath, label)) {
+        cerr << "Failed to write " << outPath << endl;
+        return 1;
+    }
+    cout << "Results written to " << outPath << endl;
+    return 0;
+}
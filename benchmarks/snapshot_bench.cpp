@@ -0,0 +1,87 @@
+// Cold CSV parse vs. binary snapshot load for the waste dataset.
+//
+//   g++ -std=c++17 -O2 -pthread -I.. snapshot_bench.cpp -o snapshot_bench
+//   ./snapshot_bench [rows] [repetitions]
+//
+// A synthetic CSV with the survey export layout is generated in the current
+// directory, parsed once to build its snapshot, then both paths are timed.
+// The CSV path includes parsing and interning; the snapshot path is mmap,
+// header/bounds validation and (optionally) the payload checksum.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "columnar_dataset.hpp"
+#include "csv_loader.hpp"
+#include "dataset_snapshot.hpp"
+#include "synthetic_datasets.hpp"
+
+using namespace std;
+
+template <typename Fn>
+static double bestOf(int repetitions, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = chrono::steady_clock::now();
+        fn();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    const string csvPath = "snapshot_bench_waste.csv";
+
+    writeSyntheticWasteCsv(csvPath, rows);
+    remove(snapshotPathFor(csvPath).c_str());
+
+    size_t csvBytes = 0;
+    double csvSeconds = bestOf(repetitions, [&]() {
+        WasteColumns columns;
+        auto stats = loadCsvParallel<WasteChunk::FieldCount, WasteChunk>(
+            csvPath, [&columns](const WasteChunk& chunk) { chunk.mergeInto(columns); });
+        columns.shrinkToFit();
+        csvBytes = columns.memoryUsage();
+        if (stats.rows != rows) cerr << "unexpected row count " << stats.rows << endl;
+    });
+
+    {
+        WasteColumns columns;
+        loadCsvParallel<WasteChunk::FieldCount, WasteChunk>(
+            csvPath, [&columns](const WasteChunk& chunk) { chunk.mergeInto(columns); });
+        if (!writeSnapshot(csvPath, SnapshotKind::Waste, columns)) {
+            cerr << "failed to write snapshot" << endl;
+            return 1;
+        }
+    }
+
+    auto snapshotLoad = [&](bool verify) {
+        return bestOf(repetitions, [&]() {
+            WasteColumns columns;
+            string why;
+            if (!loadSnapshot(csvPath, SnapshotKind::Waste, columns, why, verify)) {
+                cerr << "snapshot load failed: " << why << endl;
+                exit(1);
+            }
+        });
+    };
+    double verifiedSeconds = snapshotLoad(true);
+    double unverifiedSeconds = snapshotLoad(false);
+
+    cout << "rows                      " << rows << "\n";
+    cout << "csv parse                 " << csvSeconds * 1000.0 << " ms (" << rows / csvSeconds << " rows/sec, "
+         << csvBytes / 1024 << " KiB heap)\n";
+    cout << "snapshot load (checksum)  " << verifiedSeconds * 1000.0 << " ms, " << csvSeconds / verifiedSeconds
+         << "x faster\n";
+    cout << "snapshot load (no verify) " << unverifiedSeconds * 1000.0 << " ms, "
+         << csvSeconds / unverifiedSeconds << "x faster\n";
+
+    remove(csvPath.c_str());
+    remove(snapshotPathFor(csvPath).c_str());
+    return 0;
+}
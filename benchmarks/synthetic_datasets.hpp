@@ -0,0 +1,50 @@
+#pragma once
+
+// Seeded survey exports in the layout the loaders expect, so benchmarks
+// need no real dataset. Image names repeat every `distinctImages` rows.
+
+#include <cstddef>
+#include <fstream>
+#include <random>
+#include <string>
+
+inline void writeSyntheticWasteCsv(const std::string& path, size_t rows, size_t distinctImages = 5000) {
+    static const char* waterBodies[] = {"River", "Lake", "Ocean", "Estuary"};
+    static const char* locations[] = {"Urban", "Rural", "Coastal", "Harbour"};
+    static const char* wasteTypes[] = {"Plastic", "Metal", "Glass", "Organic", "Paper"};
+    static const char* subtypes[] = {"Bottle", "Bag", "Can", "", "Wrapper", "Net"};
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::ofstream out(path);
+    out << "> metadata.\n";
+    out << "ID,waterBodyType,locationType,wasteType,wasteSubtype,imageFileName,confidence,size,weight,temperature,turbidity,pH\n";
+    for (size_t i = 0; i < rows; ++i) {
+        out << i << ',' << waterBodies[rng() % 4] << ',' << locations[rng() % 4] << ','
+            << wasteTypes[rng() % 5] << ',' << subtypes[rng() % 6] << ",img_" << (i % distinctImages) << ".jpg,"
+            << unit(rng) * 100.0f << ',' << unit(rng) * 40.0f << ',' << unit(rng) * 2.0f << ','
+            << 18.0f + unit(rng) * 10.0f << ',' << unit(rng) * 80.0f << ',' << 6.0f + unit(rng) * 3.0f << '\n';
+    }
+}
+
+inline void writeSyntheticMarineCsv(const std::string& path, size_t rows, size_t distinctImages = 5000) {
+    static const char* waterBodies[] = {"River", "Lake", "Ocean", "Estuary"};
+    static const char* locations[] = {"Reef", "Open Water", "Coastal", "Kelp Forest"};
+    static const char* animalTypes[] = {"Fish", "Mammal", "Reptile", "Crustacean"};
+    static const char* species[] = {"Tuna", "Dolphin", "Sea Turtle", "Crab", "Salmon", "Seal"};
+    static const char* activities[] = {"Feeding", "Swimming", "Resting", "Migrating"};
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::ofstream out(path);
+    out << "> metadata.\n";
+    out << "ID,waterBodyType,locationType,animalType,animalSpecies,imageFileName,confidence,size,weight,activity,temperature,salinity,pH\n";
+    for (size_t i = 0; i < rows; ++i) {
+        out << i << ',' << waterBodies[rng() % 4] << ',' << locations[rng() % 4] << ',' << animalTypes[rng() % 4]
+            << ',' << species[rng() % 6] << ",m_" << (i % distinctImages) << ".jpg," << unit(rng) * 100.0f << ','
+            << unit(rng) * 200.0f << ',' << unit(rng) * 50.0f << ',' << activities[rng() % 4] << ','
+            << 18.0f + unit(rng) * 10.0f << ',' << unit(rng) * 35.0f << ',' << 7.5f + unit(rng) * 1.0f << '\n';
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// What a camera looks at. In dataset replay a Marine camera replays the
+// marine dataset's images and a Waste camera the waste dataset's; Either
+// picks one at random per frame, like the original single camera.
+enum class CameraFeed { Marine, Waste, Either };
+
+struct CameraConfig {
+    std::string name;
+    CameraFeed feed = CameraFeed::Either;
+};
+
+inline const char* cameraFeedName(CameraFeed feed) {
+    switch (feed) {
+    case CameraFeed::Marine: return "marine";
+    case CameraFeed::Waste: return "waste";
+    default: return "either";
+    }
+}
+
+// The cameras a buoy carries: above-water for floating debris, below-water
+// for marine life, and one on the conveyor inlet.
+inline std::vector<CameraConfig> buoyCameras() {
+    return {{"above-water", CameraFeed::Waste}, {"below-water", CameraFeed::Marine}, {"conveyor-inlet", CameraFeed::Waste}};
+}
+
+// Parse "name:feed,name:feed" (feed is marine, waste or either), or
+// "buoy" for buoyCameras(). Returns false with `error` set on a bad entry.
+inline bool parseCameraList(const std::string& text, std::vector<CameraConfig>& cameras, std::string& error) {
+    if (text == "buoy") {
+        cameras = buoyCameras();
+        return true;
+    }
+
+    std::vector<CameraConfig> parsed;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string entry = text.substr(start, end - start);
+        start = end + 1;
+
+        size_t colon = entry.find(':');
+        CameraConfig camera;
+        camera.name = entry.substr(0, colon);
+        std::string feed = colon == std::string::npos ? "either" : entry.substr(colon + 1);
+        if (camera.name.empty()) {
+            error = "empty camera name in \"" + text + "\"";
+            return false;
+        }
+        if (feed == "marine") {
+            camera.feed = CameraFeed::Marine;
+        } else if (feed == "waste") {
+            camera.feed = CameraFeed::Waste;
+        } else if (feed == "either") {
+            camera.feed = CameraFeed::Either;
+        } else {
+            error = "unknown feed \"" + feed + "\" for camera " + camera.name;
+            return false;
+        }
+        for (const CameraConfig& other : parsed) {
+            if (other.name == camera.name) {
+                error = "duplicate camera " + camera.name;
+                return false;
+            }
+        }
+        parsed.push_back(std::move(camera));
+    }
+    cameras = std::move(parsed);
+    return true;
+}
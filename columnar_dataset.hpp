@@ -0,0 +1,511 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "csv_loader.hpp"
+
+// One contiguous column. Normally owns its storage; after borrow() it is a
+// read-only view into a mapped snapshot and copies itself on the first write.
+// Copies share the storage, and rows are only ever appended: a copy that
+// ends where the storage's written rows end appends in place, past the rows
+// the other copies see, and only a copy that has fallen behind or filled
+// the buffer moves to a new one. A published dataset thus costs the
+// version appended to it just the new rows, amortised.
+template <typename T>
+class Column {
+private:
+    struct Storage {
+        std::unique_ptr<T[]> data;
+        size_t capacity = 0;
+        std::atomic<size_t> used{0}; // rows written, by whichever copy appended last
+    };
+
+    std::shared_ptr<Storage> storage; // null while empty or borrowed
+    const T* view = nullptr;
+    size_t count = 0;
+    bool borrowed = false;
+
+    // Copy our rows into a buffer of `capacity` that only this copy uses.
+    void moveTo(size_t capacity) {
+        auto fresh = std::make_shared<Storage>();
+        fresh->data.reset(new T[capacity]);
+        fresh->capacity = capacity;
+        fresh->used.store(count, std::memory_order_relaxed);
+        std::copy(view, view + count, fresh->data.get());
+        storage = std::move(fresh);
+        view = storage->data.get();
+        borrowed = false;
+    }
+
+    // Room for `extra` rows after ours: the storage's tail if no other copy
+    // has claimed it, else a larger buffer. Returns where they go.
+    // Storage no other copy holds needs no CAS, which keeps loading cheap.
+    T* claim(size_t extra) {
+        size_t needed = count + extra;
+        if (!borrowed && storage && needed <= storage->capacity) {
+            if (storage.use_count() == 1) {
+                storage->used.store(needed, std::memory_order_relaxed);
+                return storage->data.get() + count;
+            }
+            size_t expected = count;
+            if (storage->used.compare_exchange_strong(expected, needed))
+                return storage->data.get() + count;
+        }
+        moveTo(std::max({needed, count + count / 2, size_t{16}}));
+        storage->used.store(needed, std::memory_order_relaxed);
+        return storage->data.get() + count;
+    }
+
+public:
+    using value_type = T;
+
+    Column() = default;
+    Column(const Column& other) = default;
+    Column(Column&& other) noexcept { *this = std::move(other); }
+    Column& operator=(const Column& other) = default;
+    Column& operator=(Column&& other) noexcept {
+        storage = std::move(other.storage);
+        view = other.view;
+        count = other.count;
+        borrowed = other.borrowed;
+        other.view = nullptr;
+        other.count = 0;
+        other.borrowed = false;
+        return *this;
+    }
+
+    const T& operator[](size_t i) const { return view[i]; }
+    const T* data() const { return view; }
+    const T* begin() const { return view; }
+    const T* end() const { return view + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool isBorrowed() const { return borrowed; }
+
+    void push_back(T value) {
+        *claim(1) = value;
+        ++count;
+    }
+
+    void reserve(size_t n) {
+        if (n <= count) return;
+        bool ownsTail = !borrowed && storage && storage->used.load() == count;
+        if (!ownsTail || storage->capacity < n) moveTo(n);
+    }
+
+    void shrink_to_fit() {
+        if (borrowed || !storage || storage->capacity == count) return;
+        if (count == 0) {
+            storage.reset();
+            view = nullptr;
+            return;
+        }
+        moveTo(count);
+    }
+
+    void append(const Column& other) {
+        size_t n = other.size();
+        if (n == 0) return;
+        std::copy(other.begin(), other.end(), claim(n));
+        count += n;
+    }
+
+    void borrow(const T* data, size_t n) {
+        storage.reset();
+        view = data;
+        count = n;
+        borrowed = true;
+    }
+
+    size_t heapBytes() const { return storage ? storage->capacity * sizeof(T) : 0; }
+};
+
+// Deduplicated storage for categorical strings. Every distinct value is kept
+// once and referred to by a dense id; id 0 is always the empty string so an
+// absent field (e.g. no waste subtype) costs nothing to test for. Values are
+// either owned by the pool or borrowed from a mapped snapshot; the lookup
+// index is only built when something new has to be interned.
+class StringPool {
+private:
+    // Shared by a pool and its clones. Strings are only added, so the views
+    // of older clones stay valid. The index covers the values of the newest
+    // clone, which is the only one that interns through it.
+    struct Owned {
+        std::deque<std::string> strings; // deque keeps element addresses stable for the views
+        std::unordered_map<std::string_view, uint32_t> index;
+        bool indexed = false;
+        size_t values = 0; // held by the newest clone
+    };
+
+    std::shared_ptr<Owned> owned;
+    Column<std::string_view> values;
+    size_t borrowedCount = 0; // leading values that view external memory
+
+    explicit StringPool(std::shared_ptr<Owned> shared) : owned(std::move(shared)) {}
+
+    void ensureIndex() {
+        if (owned->indexed) return;
+        owned->index.reserve(values.size());
+        for (size_t i = 0; i < values.size(); ++i) owned->index.emplace(values[i], static_cast<uint32_t>(i));
+        owned->indexed = true;
+    }
+
+    // A newer clone has interned past our values: stop sharing with it.
+    void fork() {
+        auto copy = std::make_shared<Owned>();
+        Column<std::string_view> copied;
+        copied.reserve(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i < borrowedCount) {
+                copied.push_back(values[i]);
+            } else {
+                copy->strings.emplace_back(values[i]);
+                copied.push_back(copy->strings.back());
+            }
+        }
+        copy->values = copied.size();
+        owned = std::move(copy);
+        values = std::move(copied);
+    }
+
+public:
+    StringPool() : owned(std::make_shared<Owned>()) { intern(std::string_view()); }
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    uint32_t intern(std::string_view value) {
+        if (values.size() != owned->values) fork();
+        ensureIndex();
+        auto it = owned->index.find(value);
+        if (it != owned->index.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(values.size());
+        owned->strings.emplace_back(value);
+        values.push_back(owned->strings.back());
+        owned->index.emplace(values[id], id);
+        owned->values = values.size();
+        return id;
+    }
+
+    // Replace the contents with views into externally owned memory (a mapped
+    // snapshot). The caller keeps that memory alive for the pool's lifetime.
+    void borrow(const std::vector<std::string_view>& borrowedValues) {
+        owned = std::make_shared<Owned>();
+        values = Column<std::string_view>();
+        values.reserve(borrowedValues.size());
+        for (std::string_view value : borrowedValues) values.push_back(value);
+        owned->values = values.size();
+        borrowedCount = values.size();
+    }
+
+    // A copy with the same ids, for appending to a published dataset. It
+    // shares this pool's strings, so it costs nothing until it interns,
+    // and must not outlive the memory borrowed values view.
+    StringPool clone() const {
+        StringPool copy(owned);
+        copy.values = values;
+        copy.borrowedCount = borrowedCount;
+        return copy;
+    }
+
+    std::string_view get(uint32_t id) const { return values[id]; }
+    size_t size() const { return values.size(); }
+
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(*this) + values.heapBytes();
+        for (const auto& v : owned->strings) bytes += sizeof(v) + (v.capacity() > 15 ? v.capacity() + 1 : 0);
+        if (owned->indexed) {
+            bytes += owned->index.bucket_count() * sizeof(void*) +
+                     owned->index.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 2 * sizeof(void*));
+        }
+        return bytes;
+    }
+};
+
+// Per-chunk dictionary used while parsing in parallel. Ids are local to one
+// chunk and are translated to StringPool ids when the chunk is merged, so the
+// shared pool is only touched once per distinct value rather than per row.
+class ChunkDictionary {
+private:
+    std::unordered_map<std::string_view, uint32_t> index;
+    std::vector<std::string_view> values;
+
+public:
+    uint32_t localId(std::string_view value) {
+        auto [it, inserted] = index.try_emplace(value, static_cast<uint32_t>(values.size()));
+        if (inserted) values.push_back(value);
+        return it->second;
+    }
+
+    std::vector<uint32_t> remapInto(StringPool& pool) const {
+        std::vector<uint32_t> globalIds(values.size());
+        for (size_t i = 0; i < values.size(); ++i) globalIds[i] = pool.intern(values[i]);
+        return globalIds;
+    }
+};
+
+// Waste survey rows stored column-wise. Categorical columns hold ids into
+// `strings`; `label` is the pre-joined "wasteType (wasteSubtype)" string.
+// `backing` keeps a mapped snapshot alive while columns borrow from it.
+struct WasteColumns {
+    std::shared_ptr<const MappedFile> backing;
+    StringPool strings;
+    Column<uint32_t> waterBodyType;
+    Column<uint32_t> locationType;
+    Column<uint32_t> wasteType;
+    Column<uint32_t> wasteSubtype;
+    Column<uint32_t> imageFileName;
+    Column<uint32_t> label;
+    Column<float> confidence;
+    Column<float> size;
+    Column<float> weight;
+    Column<float> temperature;
+    Column<float> turbidity;
+    Column<float> pH;
+
+    size_t rowCount() const { return confidence.size(); }
+    bool empty() const { return confidence.empty(); }
+
+    // A copy that rows can be appended to, sharing these columns' storage;
+    // see Column and StringPool::clone().
+    WasteColumns clone() const {
+        WasteColumns copy;
+        copy.backing = backing;
+        copy.strings = strings.clone();
+        copy.waterBodyType = waterBodyType;
+        copy.locationType = locationType;
+        copy.wasteType = wasteType;
+        copy.wasteSubtype = wasteSubtype;
+        copy.imageFileName = imageFileName;
+        copy.label = label;
+        copy.confidence = confidence;
+        copy.size = size;
+        copy.weight = weight;
+        copy.temperature = temperature;
+        copy.turbidity = turbidity;
+        copy.pH = pH;
+        return copy;
+    }
+
+    template <typename Fn>
+    void forEachColumn(Fn fn) {
+        fn(waterBodyType); fn(locationType); fn(wasteType); fn(wasteSubtype); fn(imageFileName); fn(label);
+        fn(confidence); fn(size); fn(weight); fn(temperature); fn(turbidity); fn(pH);
+    }
+
+    void reserve(size_t rows) {
+        forEachColumn([rows](auto& column) { column.reserve(rows); });
+    }
+
+    void shrinkToFit() {
+        forEachColumn([](auto& column) { column.shrink_to_fit(); });
+    }
+
+    size_t memoryUsage() {
+        size_t bytes = sizeof(*this) + strings.memoryUsage();
+        forEachColumn([&bytes](auto& column) { bytes += column.heapBytes(); });
+        return bytes;
+    }
+};
+
+// Marine survey rows stored column-wise, same conventions as WasteColumns.
+struct MarineColumns {
+    std::shared_ptr<const MappedFile> backing;
+    StringPool strings;
+    Column<uint32_t> waterBodyType;
+    Column<uint32_t> locationType;
+    Column<uint32_t> animalType;
+    Column<uint32_t> animalSpecies;
+    Column<uint32_t> imageFileName;
+    Column<uint32_t> activity;
+    Column<float> confidence;
+    Column<float> size;
+    Column<float> weight;
+    Column<float> temperature;
+    Column<float> salinity;
+    Column<float> pH;
+
+    size_t rowCount() const { return confidence.size(); }
+    bool empty() const { return confidence.empty(); }
+
+    // A copy that rows can be appended to, sharing these columns' storage;
+    // see Column and StringPool::clone().
+    MarineColumns clone() const {
+        MarineColumns copy;
+        copy.backing = backing;
+        copy.strings = strings.clone();
+        copy.waterBodyType = waterBodyType;
+        copy.locationType = locationType;
+        copy.animalType = animalType;
+        copy.animalSpecies = animalSpecies;
+        copy.imageFileName = imageFileName;
+        copy.activity = activity;
+        copy.confidence = confidence;
+        copy.size = size;
+        copy.weight = weight;
+        copy.temperature = temperature;
+        copy.salinity = salinity;
+        copy.pH = pH;
+        return copy;
+    }
+
+    template <typename Fn>
+    void forEachColumn(Fn fn) {
+        fn(waterBodyType); fn(locationType); fn(animalType); fn(animalSpecies); fn(imageFileName); fn(activity);
+        fn(confidence); fn(size); fn(weight); fn(temperature); fn(salinity); fn(pH);
+    }
+
+    void reserve(size_t rows) {
+        forEachColumn([rows](auto& column) { column.reserve(rows); });
+    }
+
+    void shrinkToFit() {
+        forEachColumn([](auto& column) { column.shrink_to_fit(); });
+    }
+
+    size_t memoryUsage() {
+        size_t bytes = sizeof(*this) + strings.memoryUsage();
+        forEachColumn([&bytes](auto& column) { bytes += column.heapBytes(); });
+        return bytes;
+    }
+};
+
+// Appends one parsed chunk to the global columns, translating local ids.
+inline void appendCategorical(Column<uint32_t>& dst, const Column<uint32_t>& src,
+                              const std::vector<uint32_t>& globalIds) {
+    for (uint32_t localId : src) dst.push_back(globalIds[localId]);
+}
+
+template <typename T>
+inline void appendNumeric(Column<T>& dst, const Column<T>& src) {
+    dst.append(src);
+}
+
+// CSV sink for loadCsvParallel:
+// ID,waterBodyType,locationType,wasteType,wasteSubtype,imageFileName,
+// confidence,size,weight,temperature,turbidity,pH
+struct WasteChunk {
+    static constexpr size_t FieldCount = 12;
+
+    ChunkDictionary dictionary;
+    WasteColumns rows; // categorical columns hold ChunkDictionary ids
+
+    void reserveBytes(size_t bytes) { rows.reserve(bytes / 64 + 1); }
+    size_t rowCount() const { return rows.rowCount(); }
+
+    bool addRow(const std::array<std::string_view, FieldCount>& f) {
+        float confidence, size, weight, temperature, turbidity, pH;
+        if (!csv::parseFloat(f[6], confidence) || !csv::parseFloat(f[7], size) ||
+            !csv::parseFloat(f[8], weight) || !csv::parseFloat(f[9], temperature) ||
+            !csv::parseFloat(f[10], turbidity) || !csv::parseFloat(f[11], pH, 7.0f)) {
+            return false;
+        }
+
+        rows.waterBodyType.push_back(dictionary.localId(f[1]));
+        rows.locationType.push_back(dictionary.localId(f[2]));
+        rows.wasteType.push_back(dictionary.localId(f[3]));
+        rows.wasteSubtype.push_back(dictionary.localId(f[4]));
+        rows.imageFileName.push_back(dictionary.localId(f[5]));
+        rows.confidence.push_back(confidence);
+        rows.size.push_back(size);
+        rows.weight.push_back(weight);
+        rows.temperature.push_back(temperature);
+        rows.turbidity.push_back(turbidity);
+        rows.pH.push_back(pH);
+        return true;
+    }
+
+    void mergeInto(WasteColumns& dst) const {
+        StringPool& pool = dst.strings;
+        auto ids = dictionary.remapInto(pool);
+        appendCategorical(dst.waterBodyType, rows.waterBodyType, ids);
+        appendCategorical(dst.locationType, rows.locationType, ids);
+        appendCategorical(dst.wasteType, rows.wasteType, ids);
+        appendCategorical(dst.wasteSubtype, rows.wasteSubtype, ids);
+        appendCategorical(dst.imageFileName, rows.imageFileName, ids);
+        appendNumeric(dst.confidence, rows.confidence);
+        appendNumeric(dst.size, rows.size);
+        appendNumeric(dst.weight, rows.weight);
+        appendNumeric(dst.temperature, rows.temperature);
+        appendNumeric(dst.turbidity, rows.turbidity);
+        appendNumeric(dst.pH, rows.pH);
+
+        // Labels only depend on (type, subtype), so build each string once.
+        std::unordered_map<uint64_t, uint32_t> labelIds;
+        for (size_t i = dst.label.size(); i < dst.wasteType.size(); ++i) {
+            uint64_t key = (static_cast<uint64_t>(dst.wasteType[i]) << 32) | dst.wasteSubtype[i];
+            auto it = labelIds.find(key);
+            if (it == labelIds.end()) {
+                std::string label(pool.get(dst.wasteType[i]));
+                std::string_view subtype = pool.get(dst.wasteSubtype[i]);
+                if (!subtype.empty()) label.append(" (").append(subtype).append(")");
+                it = labelIds.emplace(key, pool.intern(label)).first;
+            }
+            dst.label.push_back(it->second);
+        }
+    }
+};
+
+// CSV sink for loadCsvParallel:
+// ID,waterBodyType,locationType,animalType,animalSpecies,imageFileName,
+// confidence,size,weight,activity,temperature,salinity,pH
+struct MarineChunk {
+    static constexpr size_t FieldCount = 13;
+
+    ChunkDictionary dictionary;
+    MarineColumns rows; // categorical columns hold ChunkDictionary ids
+
+    void reserveBytes(size_t bytes) { rows.reserve(bytes / 64 + 1); }
+    size_t rowCount() const { return rows.rowCount(); }
+
+    bool addRow(const std::array<std::string_view, FieldCount>& f) {
+        float confidence, size, weight, temperature, salinity, pH;
+        if (!csv::parseFloat(f[6], confidence) || !csv::parseFloat(f[7], size) ||
+            !csv::parseFloat(f[8], weight) || !csv::parseFloat(f[10], temperature) ||
+            !csv::parseFloat(f[11], salinity) || !csv::parseFloat(f[12], pH, 7.0f)) {
+            return false;
+        }
+
+        rows.waterBodyType.push_back(dictionary.localId(f[1]));
+        rows.locationType.push_back(dictionary.localId(f[2]));
+        rows.animalType.push_back(dictionary.localId(f[3]));
+        rows.animalSpecies.push_back(dictionary.localId(f[4]));
+        rows.imageFileName.push_back(dictionary.localId(f[5]));
+        rows.activity.push_back(dictionary.localId(f[9]));
+        rows.confidence.push_back(confidence);
+        rows.size.push_back(size);
+        rows.weight.push_back(weight);
+        rows.temperature.push_back(temperature);
+        rows.salinity.push_back(salinity);
+        rows.pH.push_back(pH);
+        return true;
+    }
+
+    void mergeInto(MarineColumns& dst) const {
+        auto ids = dictionary.remapInto(dst.strings);
+        appendCategorical(dst.waterBodyType, rows.waterBodyType, ids);
+        appendCategorical(dst.locationType, rows.locationType, ids);
+        appendCategorical(dst.animalType, rows.animalType, ids);
+        appendCategorical(dst.animalSpecies, rows.animalSpecies, ids);
+        appendCategorical(dst.imageFileName, rows.imageFileName, ids);
+        appendCategorical(dst.activity, rows.activity, ids);
+        appendNumeric(dst.confidence, rows.confidence);
+        appendNumeric(dst.size, rows.size);
+        appendNumeric(dst.weight, rows.weight);
+        appendNumeric(dst.temperature, rows.temperature);
+        appendNumeric(dst.salinity, rows.salinity);
+        appendNumeric(dst.pH, rows.pH);
+    }
+};
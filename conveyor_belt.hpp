@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "detection_types.hpp"
+#include "pipeline.hpp"
+#include "power_system.hpp"
+#include "sim_clock.hpp"
+
+struct ConveyorConfig {
+    float runSeconds = 2.0f;        // belt time to carry one item to the bin
+    float extraItemSeconds = 0.5f;  // added per item that joins a run already underway
+    float maxRunSeconds = 10.0f;    // a run stops extending once it is this long
+    float coalesceSeconds = 0.25f;  // wait this long for neighbours before starting a run
+    size_t maxItemsPerRun = 8;
+    size_t queueCapacity = 32;
+};
+
+// One belt run, reported to the completion handler when it finishes.
+struct ConveyorRun {
+    std::vector<DetectionResult> items;
+    float seconds = 0.0f;
+    float energyWh = 0.0f;
+    bool interrupted = false; // stop() was called mid-run
+    bool powered = true;      // battery could cover the energy used
+};
+
+struct ConveyorStats {
+    uint64_t submitted = 0;
+    uint64_t rejected = 0; // queue full
+    uint64_t runs = 0;
+    uint64_t itemsCollected = 0;
+    float busySeconds = 0.0f;
+    float energyWh = 0.0f;
+    size_t pending = 0;
+};
+
+// Asynchronous actuator: processWaste() only queues the item. Items that
+// arrive close together are grouped into a single belt run, whose energy is
+// charged to the battery before completion is reported.
+//
+// The belt is a small state machine advanced by pump(now). In real time the
+// worker thread started by start() pumps it; in simulation the driver calls
+// pump() itself and uses nextEventTime() to schedule the next jump.
+class ConveyorBelt {
+private:
+    enum class Phase { Idle, Gathering, Running };
+    using TimePoint = Clock::time_point;
+
+    Battery& battery;
+    ConveyorConfig config;
+    bool isRunning;
+    float speed;
+    float powerUsage;
+    mutable std::mutex conveyorMutex; // Added 'mutable' here
+    std::condition_variable wake;     // new work, stop() or shutdown
+    bool haltRequested = false;
+    bool shuttingDown = false;
+
+    BoundedQueue<DetectionResult> jobs;
+    // Items back from finished runs, and the emptied item list of the
+    // last one, reused so a steady stream of waste does not allocate.
+    BoundedQueue<DetectionResult> spare;
+    std::vector<DetectionResult> spareItems; // guarded by conveyorMutex
+    Phase phase = Phase::Idle;
+    ConveyorRun current;
+    TimePoint gatherUntil;
+    TimePoint runStarted;
+    TimePoint runEnds;
+
+    std::function<void(const ConveyorRun&)> onComplete;
+    ConveyorStats stats;
+    std::thread worker;
+
+    static Clock::duration seconds(float s) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(s));
+    }
+
+    // Move queued items into the current run; items joining a moving belt
+    // extend it. Caller holds conveyorMutex.
+    void absorbJobsLocked() {
+        DetectionResult item;
+        while (current.items.size() < config.maxItemsPerRun && jobs.tryPop(item)) {
+            current.items.push_back(std::move(item));
+            if (phase == Phase::Running) {
+                runEnds = std::min(runStarted + seconds(config.maxRunSeconds), runEnds + seconds(config.extraItemSeconds));
+            }
+        }
+    }
+
+    // Advance the state machine to `now`. Returns true and fills `finished`
+    // when a run ends. Caller holds conveyorMutex.
+    bool stepLocked(TimePoint now, ConveyorRun& finished) {
+        if (phase == Phase::Idle) {
+            if (jobs.empty()) return false;
+            phase = Phase::Gathering;
+            gatherUntil = now + seconds(config.coalesceSeconds);
+            current = ConveyorRun();
+            current.items.swap(spareItems);
+            haltRequested = false;
+        }
+
+        if (phase == Phase::Gathering) {
+            absorbJobsLocked();
+            if (now < gatherUntil && current.items.size() < config.maxItemsPerRun) return false;
+            phase = Phase::Running;
+            isRunning = true;
+            runStarted = now;
+            float planned = config.runSeconds + config.extraItemSeconds * (current.items.size() - 1);
+            runEnds = now + seconds(std::min(config.maxRunSeconds, planned));
+        }
+
+        absorbJobsLocked();
+        bool halted = haltRequested || shuttingDown;
+        if (!halted && now < runEnds) return false;
+
+        current.interrupted = halted && now < runEnds;
+        current.seconds = std::chrono::duration<float>(std::min(now, runEnds) - runStarted).count();
+        current.energyWh = powerUsage * current.seconds / 3600.0f;
+        finished = std::move(current);
+        current = ConveyorRun();
+        phase = Phase::Idle;
+        isRunning = false;
+        haltRequested = false;
+        return true;
+    }
+
+    TimePoint nextEventLocked() const {
+        switch (phase) {
+        case Phase::Gathering: return gatherUntil;
+        case Phase::Running: return runEnds;
+        default: return jobs.empty() ? TimePoint::max() : TimePoint::min();
+        }
+    }
+
+    void workerLoop() {
+        while (true) {
+            pump(std::chrono::system_clock::now());
+            std::unique_lock<std::mutex> lock(conveyorMutex);
+            if (shuttingDown && phase == Phase::Idle) return;
+            TimePoint next = nextEventLocked();
+            if (next == TimePoint::max()) {
+                wake.wait(lock);
+            } else if (next > std::chrono::system_clock::now()) {
+                wake.wait_until(lock, next);
+            }
+        }
+    }
+
+public:
+    explicit ConveyorBelt(Battery& battery, const ConveyorConfig& cfg = ConveyorConfig())
+        : battery(battery), config(cfg), isRunning(false), speed(0.5f), powerUsage(150.0f),
+          jobs(cfg.queueCapacity), spare(cfg.queueCapacity + cfg.maxItemsPerRun) {}
+
+    ~ConveyorBelt() { shutdown(); }
+
+    ConveyorBelt(const ConveyorBelt&) = delete;
+    ConveyorBelt& operator=(const ConveyorBelt&) = delete;
+
+    // Run the belt in real time on its own thread.
+    void start() {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        if (worker.joinable()) return;
+        shuttingDown = false;
+        worker = std::thread([this]() { workerLoop(); });
+    }
+
+    // Stop the worker thread, ending any run in progress.
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(conveyorMutex);
+            shuttingDown = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    void activate() {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        isRunning = true;
+    }
+
+    // Halt the current run. Queued items stay queued for the next one.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(conveyorMutex);
+            haltRequested = phase == Phase::Running;
+            isRunning = false;
+        }
+        wake.notify_all();
+    }
+
+    bool isActive() const {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        return isRunning;
+    }
+
+    float getPowerUsage() const {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        return isRunning ? powerUsage : 0;
+    }
+
+    // Called after each run, on whichever thread pumped the belt.
+    void setCompletionHandler(std::function<void(const ConveyorRun&)> handler) {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        onComplete = std::move(handler);
+    }
+
+    // Queue an item for collection and return immediately. Returns false if
+    // the queue is full.
+    bool processWaste(const DetectionResult& waste) {
+        DetectionResult job;
+        spare.tryPop(job); // a recycled item keeps its strings' storage
+        job = waste;
+        bool accepted = jobs.tryPush(std::move(job));
+        {
+            std::lock_guard<std::mutex> lock(conveyorMutex);
+            ++(accepted ? stats.submitted : stats.rejected);
+        }
+        if (accepted) wake.notify_one();
+        return accepted;
+    }
+
+    // Advance the belt to `now`, finishing at most one run.
+    void pump(TimePoint now) {
+        ConveyorRun finished;
+        std::function<void(const ConveyorRun&)> handler;
+        {
+            std::lock_guard<std::mutex> lock(conveyorMutex);
+            if (!stepLocked(now, finished)) return;
+            handler = onComplete;
+        }
+
+        finished.powered = battery.discharge(powerUsage, finished.seconds / 3600.0f);
+        {
+            std::lock_guard<std::mutex> lock(conveyorMutex);
+            ++stats.runs;
+            if (!finished.interrupted) stats.itemsCollected += finished.items.size();
+            stats.busySeconds += finished.seconds;
+            stats.energyWh += finished.energyWh;
+        }
+        if (handler) handler(finished);
+
+        for (DetectionResult& item : finished.items) spare.tryPush(std::move(item));
+        finished.items.clear();
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        if (finished.items.capacity() > spareItems.capacity()) spareItems.swap(finished.items);
+    }
+
+    // When pump() next has something to do: TimePoint::max() when idle,
+    // TimePoint::min() when work is waiting to be picked up.
+    TimePoint nextEventTime() const {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        return nextEventLocked();
+    }
+
+    ConveyorStats getStats() const {
+        std::lock_guard<std::mutex> lock(conveyorMutex);
+        ConveyorStats snapshot = stats;
+        snapshot.pending = jobs.size();
+        return snapshot;
+    }
+};
+
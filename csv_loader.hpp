@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. Uses mmap on POSIX and falls back to a
+// heap copy elsewhere, so callers only ever see a contiguous char range.
+class MappedFile {
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    std::vector<char> fallbackBuffer;
+
+    void reset() {
+#ifndef _WIN32
+        if (mappedData && fallbackBuffer.empty() && mappedSize > 0) {
+            munmap(const_cast<char*>(mappedData), mappedSize);
+        }
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+        fallbackBuffer.clear();
+    }
+
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { reset(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            reset();
+            mappedData = other.mappedData;
+            mappedSize = other.mappedSize;
+            fallbackBuffer = std::move(other.fallbackBuffer);
+            if (!fallbackBuffer.empty()) mappedData = fallbackBuffer.data();
+            other.mappedData = nullptr;
+            other.mappedSize = 0;
+        }
+        return *this;
+    }
+
+    bool open(const std::string& path) {
+        reset();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        mappedSize = static_cast<size_t>(st.st_size);
+        if (mappedSize == 0) {
+            ::close(fd);
+            mappedData = "";
+            return true;
+        }
+
+        void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            mappedSize = 0;
+            return false;
+        }
+        madvise(addr, mappedSize, MADV_SEQUENTIAL);
+        mappedData = static_cast<const char*>(addr);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+        fallbackBuffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(fallbackBuffer.data(), static_cast<std::streamsize>(fallbackBuffer.size()));
+        mappedData = fallbackBuffer.data();
+        mappedSize = fallbackBuffer.size();
+        return true;
+#endif
+    }
+
+    bool isOpen() const { return mappedData != nullptr; }
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    std::string_view view() const { return {mappedData, mappedSize}; }
+};
+
+struct CsvLoadStats {
+    bool opened = false;
+    size_t rows = 0;
+    size_t badRows = 0;
+    size_t bytes = 0; // of the source file, i.e. where appended rows start
+    unsigned threads = 0;
+    double seconds = 0.0;
+
+    double rowsPerSecond() const { return seconds > 0 ? rows / seconds : 0.0; }
+};
+
+namespace csv {
+
+// Strip surrounding blanks and a trailing CR left by Windows line endings.
+inline std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// Empty fields take the supplied default, the same rule the old stof-based
+// parser applied. Anything that is not entirely a number is rejected, and
+// so are "nan" and "inf": the sorted indexes need ordered values.
+inline bool parseFloat(std::string_view token, float& out, float emptyValue = 0.0f) {
+    token = trim(token);
+    if (token.empty()) {
+        out = emptyValue;
+        return true;
+    }
+    if (token.front() == '+') token.remove_prefix(1);
+#if defined(__cpp_lib_to_chars) || (defined(_GLIBCXX_RELEASE) && _GLIBCXX_RELEASE >= 11) || defined(_MSC_VER)
+    auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size() && std::isfinite(out);
+#else
+    char buffer[64];
+    if (token.size() >= sizeof(buffer)) return false;
+    std::copy(token.begin(), token.end(), buffer);
+    buffer[token.size()] = '\0';
+    char* end = nullptr;
+    out = std::strtof(buffer, &end);
+    return end == buffer + token.size() && std::isfinite(out);
+#endif
+}
+
+// Split one line into exactly N fields without allocating. The final field
+// receives the rest of the line. Returns false if the line is too short.
+template <size_t N>
+inline bool splitFields(std::string_view line, std::array<std::string_view, N>& fields) {
+    size_t start = 0;
+    for (size_t i = 0; i + 1 < N; ++i) {
+        size_t comma = line.find(',', start);
+        if (comma == std::string_view::npos) return false;
+        fields[i] = line.substr(start, comma - start);
+        start = comma + 1;
+    }
+    fields[N - 1] = trim(line.substr(start));
+    return true;
+}
+
+// Offset of the first data row: skips the "> metadata." preamble lines
+// exported by the survey tooling and then the column header.
+inline size_t findBodyStart(std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        size_t next = eol == std::string_view::npos ? text.size() : eol + 1;
+        if (text.substr(pos, next - pos).find("> metadata.") == std::string_view::npos) {
+            return next; // this is the header line, data starts after it
+        }
+        pos = next;
+    }
+    return text.size();
+}
+
+// Split [begin, end) into roughly equal pieces whose boundaries all fall
+// just after a newline, so every line belongs to exactly one chunk.
+inline std::vector<std::pair<size_t, size_t>> lineAlignedChunks(std::string_view text, size_t begin,
+                                                                size_t chunkCount) {
+    std::vector<std::pair<size_t, size_t>> chunks;
+    size_t end = text.size();
+    if (begin >= end) return chunks;
+
+    chunkCount = std::max<size_t>(1, chunkCount);
+    size_t target = std::max<size_t>(1, (end - begin) / chunkCount);
+    size_t start = begin;
+    while (start < end) {
+        size_t cut = std::min(end, start + target);
+        if (cut < end) {
+            size_t eol = text.find('\n', cut);
+            cut = eol == std::string_view::npos ? end : eol + 1;
+        }
+        chunks.emplace_back(start, cut);
+        start = cut;
+    }
+    return chunks;
+}
+
+// Feed every non-empty line of `text` to `sink` (see loadCsvParallel for
+// the Chunk interface). A final line without a newline is parsed too.
+// Returns the number of malformed lines.
+template <size_t FieldCount, typename Chunk>
+size_t parseLines(std::string_view text, Chunk& sink) {
+    std::array<std::string_view, FieldCount> fields;
+    size_t badRows = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view line = trim(text.substr(pos, eol - pos));
+        pos = eol + 1;
+
+        if (line.empty()) continue;
+
+        if (!splitFields(line, fields) || !sink.addRow(fields)) {
+            ++badRows;
+        }
+    }
+    return badRows;
+}
+
+} // namespace csv
+
+// Parse a CSV export in parallel. The body is cut into line-aligned chunks
+// and each chunk is fed to its own `Chunk` sink, which must provide
+//     void reserveBytes(size_t);
+//     bool addRow(const std::array<std::string_view, FieldCount>&);
+//     size_t rowCount() const;
+// addRow returns false for a malformed row. No lock is taken per row. Once
+// all chunks are parsed, `merge(chunk)` is called for each in file order
+// while the file is still mapped, so sinks may keep views into the text.
+template <size_t FieldCount, typename Chunk, typename MergeFn>
+CsvLoadStats loadCsvParallel(const std::string& path, MergeFn merge, unsigned threadCount = 0) {
+    CsvLoadStats stats;
+    auto started = std::chrono::steady_clock::now();
+
+    MappedFile file(path);
+    if (!file.isOpen()) return stats;
+    stats.opened = true;
+
+    std::string_view text = file.view();
+    stats.bytes = text.size();
+
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    // A few chunks per thread keeps cores busy when row lengths vary.
+    auto chunks = csv::lineAlignedChunks(text, csv::findBodyStart(text), threadCount * 4);
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(1, chunks.size())));
+    stats.threads = threadCount;
+
+    std::vector<Chunk> sinks(chunks.size());
+    std::vector<size_t> chunkBad(chunks.size(), 0);
+    std::atomic<size_t> nextChunk{0};
+
+    auto worker = [&]() {
+        for (size_t c = nextChunk.fetch_add(1); c < chunks.size(); c = nextChunk.fetch_add(1)) {
+            std::string_view chunk = text.substr(chunks[c].first, chunks[c].second - chunks[c].first);
+            sinks[c].reserveBytes(chunk.size());
+            chunkBad[c] = csv::parseLines<FieldCount>(chunk, sinks[c]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threadCount; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    for (size_t c = 0; c < sinks.size(); ++c) {
+        stats.rows += sinks[c].rowCount();
+        stats.badRows += chunkBad[c];
+        merge(sinks[c]);
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
@@ -0,0 +1,575 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "columnar_dataset.hpp"
+
+// One bit per dataset row. Every index lookup produces one and predicates
+// are combined by word-wise AND/OR, 64 rows per instruction. A bitmap may
+// cover only the rows from some first row on, e.g. those just appended.
+class RowBitmap {
+private:
+    std::vector<uint64_t> words;
+    size_t first = 0; // row of bit 0
+    size_t rows = 0;
+
+    static int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int n = 0;
+        while (!(word & 1)) { word >>= 1; ++n; }
+        return n;
+#endif
+    }
+
+    static size_t popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_popcountll(word));
+#else
+        size_t n = 0;
+        for (; word; word &= word - 1) ++n;
+        return n;
+#endif
+    }
+
+public:
+    RowBitmap() = default;
+    explicit RowBitmap(size_t rowCount, bool filled = false) : RowBitmap(0, rowCount, filled) {}
+    // Rows [firstRow, endRow).
+    RowBitmap(size_t firstRow, size_t endRow, bool filled)
+        : words((endRow - firstRow + 63) / 64, filled ? ~uint64_t{0} : 0), first(firstRow), rows(endRow - firstRow) {
+        if (filled && rows % 64) words.back() = (uint64_t{1} << (rows % 64)) - 1;
+    }
+
+    size_t size() const { return rows; }
+    size_t firstRow() const { return first; }
+    void set(size_t row) { row -= first; words[row >> 6] |= uint64_t{1} << (row & 63); }
+    void reset(size_t row) { row -= first; words[row >> 6] &= ~(uint64_t{1} << (row & 63)); }
+    bool test(size_t row) const { row -= first; return (words[row >> 6] >> (row & 63)) & 1; }
+
+    // Set rows [from, to), a word at a time where possible.
+    void setRange(size_t from, size_t to) {
+        for (; from < to && (from - first) % 64; ++from) set(from);
+        for (; from + 64 <= to; from += 64) words[(from - first) >> 6] = ~uint64_t{0};
+        for (; from < to; ++from) set(from);
+    }
+
+    RowBitmap& operator&=(const RowBitmap& other) {
+        for (size_t i = 0; i < words.size(); ++i) words[i] &= other.words[i];
+        return *this;
+    }
+
+    RowBitmap& operator|=(const RowBitmap& other) {
+        for (size_t i = 0; i < words.size(); ++i) words[i] |= other.words[i];
+        return *this;
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t word : words) n += popcount(word);
+        return n;
+    }
+
+    // Visit set rows in ascending order.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (uint64_t word = words[i]; word; word &= word - 1) fn(first + i * 64 + lowestBit(word));
+        }
+    }
+
+    std::vector<uint32_t> rowIds() const {
+        std::vector<uint32_t> ids;
+        ids.reserve(count());
+        forEach([&ids](size_t row) { ids.push_back(static_cast<uint32_t>(row)); });
+        return ids;
+    }
+};
+
+// Appended rows are indexed as a run of their own, and copies of an index
+// share its runs, so extending a published index costs only the new rows.
+// Runs are merged from the newest back while one is no more than twice the
+// size of the next: sizes then shrink geometrically, so a lookup searches
+// O(log rows) runs and each row is merged O(log rows) times. Every run
+// covers a contiguous range of rows.
+template <typename Run, typename Merge>
+inline void mergeNewestRuns(std::vector<std::shared_ptr<const Run>>& runs, Merge merge) {
+    while (runs.size() >= 2 && runs[runs.size() - 2]->rowCount() <= 2 * runs.back()->rowCount()) {
+        std::shared_ptr<const Run> merged = merge(*runs[runs.size() - 2], *runs.back());
+        runs.pop_back();
+        runs.back() = std::move(merged);
+    }
+}
+
+// Inverted index over one categorical column: the rows of each distinct
+// value, stored back to back (CSR) and built with one counting sort per
+// run. Values are renumbered densely, since the dataset's string pool also
+// holds every image file name.
+class CategoricalIndex {
+private:
+    struct Run {
+        size_t firstRow = 0; // covers dataset rows [firstRow, endRow)
+        size_t endRow = 0;
+        std::vector<uint32_t> offsets; // per value, into rows; one extra at the end
+        std::vector<uint32_t> rows;    // ascending within each value
+
+        size_t rowCount() const { return endRow - firstRow; }
+        size_t countOf(uint32_t id) const { return id + 1 < offsets.size() ? offsets[id + 1] - offsets[id] : 0; }
+    };
+
+    std::unordered_map<std::string, uint32_t> ids; // value -> dense id
+    std::vector<std::shared_ptr<const Run>> runs;  // oldest first
+
+    // `dense` holds the dense id of each row from firstRow on.
+    std::shared_ptr<const Run> makeRun(const std::vector<uint32_t>& dense, size_t firstRow) const {
+        auto run = std::make_shared<Run>();
+        run->firstRow = firstRow;
+        run->endRow = firstRow + dense.size();
+        run->offsets.assign(ids.size() + 1, 0);
+        for (uint32_t id : dense) ++run->offsets[id + 1];
+        std::partial_sum(run->offsets.begin(), run->offsets.end(), run->offsets.begin());
+
+        run->rows.resize(dense.size());
+        std::vector<uint32_t> next(run->offsets.begin(), run->offsets.end() - 1);
+        for (size_t i = 0; i < dense.size(); ++i) run->rows[next[dense[i]]++] = static_cast<uint32_t>(firstRow + i);
+        return run;
+    }
+
+    // The older run's rows come first in each list, keeping it ascending.
+    static std::shared_ptr<const Run> mergeRuns(const Run& older, const Run& newer) {
+        auto run = std::make_shared<Run>();
+        run->firstRow = older.firstRow;
+        run->endRow = newer.endRow;
+        size_t values = std::max(older.offsets.size(), newer.offsets.size()) - 1;
+        run->offsets.resize(values + 1);
+        run->rows.resize(older.rows.size() + newer.rows.size());
+        auto out = run->rows.begin();
+        for (uint32_t id = 0; id < values; ++id) {
+            run->offsets[id] = static_cast<uint32_t>(out - run->rows.begin());
+            for (const Run* part : {&older, &newer}) {
+                if (id + 1 < part->offsets.size()) {
+                    out = std::copy(part->rows.begin() + part->offsets[id], part->rows.begin() + part->offsets[id + 1],
+                                    out);
+                }
+            }
+        }
+        run->offsets[values] = static_cast<uint32_t>(run->rows.size());
+        return run;
+    }
+
+    size_t endRow() const { return runs.empty() ? 0 : runs.back()->endRow; }
+
+public:
+    void build(const Column<uint32_t>& column, const StringPool& strings) {
+        std::vector<uint32_t> denseId(strings.size(), UINT32_MAX);
+        std::vector<uint32_t> dense(column.size());
+        ids.clear();
+        runs.clear();
+        for (size_t row = 0; row < column.size(); ++row) {
+            uint32_t& id = denseId[column[row]];
+            if (id == UINT32_MAX) {
+                id = static_cast<uint32_t>(ids.size());
+                ids.emplace(std::string(strings.get(column[row])), id);
+            }
+            dense[row] = id;
+        }
+        runs.push_back(makeRun(dense, 0));
+    }
+
+    // Index rows [firstRow, column.size()) appended since the last build,
+    // as a new run. The runs of the index this was copied from are shared,
+    // not copied.
+    void append(const Column<uint32_t>& column, const StringPool& strings, size_t firstRow) {
+        std::unordered_map<uint32_t, uint32_t> denseOf; // pool id -> dense id
+        std::vector<uint32_t> dense(column.size() - firstRow);
+        for (size_t row = firstRow; row < column.size(); ++row) {
+            auto it = denseOf.find(column[row]);
+            if (it == denseOf.end()) {
+                auto known = ids.emplace(std::string(strings.get(column[row])), static_cast<uint32_t>(ids.size()));
+                it = denseOf.emplace(column[row], known.first->second).first;
+            }
+            dense[row - firstRow] = it->second;
+        }
+        runs.push_back(makeRun(dense, firstRow));
+        mergeNewestRuns(runs, mergeRuns);
+    }
+
+    // Number of rows holding `value`; 0 if it never occurs.
+    size_t count(const std::string& value) const {
+        auto it = ids.find(value);
+        if (it == ids.end()) return 0;
+        size_t total = 0;
+        for (const auto& run : runs) total += run->countOf(it->second);
+        return total;
+    }
+
+    // Rows from firstRow on holding any of `values`. Touches at most half
+    // of each run's rows: a common selection is built by clearing the rows
+    // it excludes.
+    RowBitmap select(const std::vector<std::string>& values, size_t firstRow = 0) const {
+        std::vector<uint32_t> chosen;
+        for (const auto& value : values) {
+            auto it = ids.find(value);
+            if (it == ids.end() || std::find(chosen.begin(), chosen.end(), it->second) != chosen.end()) continue;
+            chosen.push_back(it->second);
+        }
+
+        RowBitmap bitmap(firstRow, std::max(firstRow, endRow()), false);
+        for (const auto& run : runs) {
+            if (run->endRow <= firstRow) continue;
+            if (run->firstRow < firstRow) {
+                // Straddles firstRow: just the tail of each chosen list.
+                for (uint32_t id : chosen) {
+                    if (!run->countOf(id)) continue;
+                    auto end = run->rows.begin() + run->offsets[id + 1];
+                    auto it = std::lower_bound(run->rows.begin() + run->offsets[id], end, firstRow);
+                    for (; it != end; ++it) bitmap.set(*it);
+                }
+                continue;
+            }
+
+            size_t matches = 0;
+            for (uint32_t id : chosen) matches += run->countOf(id);
+            bool invert = matches > run->rowCount() / 2;
+            if (invert) bitmap.setRange(run->firstRow, run->endRow);
+            for (uint32_t id = 0; id + 1 < run->offsets.size(); ++id) {
+                bool isChosen = std::find(chosen.begin(), chosen.end(), id) != chosen.end();
+                if (isChosen == invert) continue;
+                for (uint32_t i = run->offsets[id]; i < run->offsets[id + 1]; ++i) {
+                    if (invert) bitmap.reset(run->rows[i]);
+                    else bitmap.set(run->rows[i]);
+                }
+            }
+        }
+        return bitmap;
+    }
+
+    size_t distinctValues() const { return ids.size(); }
+
+    size_t memoryUsage() const {
+        size_t bytes = ids.size() * (sizeof(std::string) + sizeof(uint32_t) + 2 * sizeof(void*));
+        for (const auto& run : runs) bytes += (run->offsets.capacity() + run->rows.capacity()) * sizeof(uint32_t);
+        return bytes;
+    }
+};
+
+// Row ids ordered by one numeric column, with the values alongside so a
+// range lookup is two binary searches over contiguous floats per run.
+class SortedIndex {
+private:
+    struct Run {
+        size_t firstRow = 0; // covers dataset rows [firstRow, endRow)
+        size_t endRow = 0;
+        std::vector<float> values;
+        std::vector<uint32_t> rows;
+
+        size_t rowCount() const { return endRow - firstRow; }
+
+        // Positions in sorted order of the rows with min <= value <= max.
+        std::pair<size_t, size_t> range(float min, float max) const {
+            size_t first = std::lower_bound(values.begin(), values.end(), min) - values.begin();
+            size_t last = std::upper_bound(values.begin(), values.end(), max) - values.begin();
+            return {first, std::max(first, last)};
+        }
+    };
+
+    std::vector<std::shared_ptr<const Run>> runs; // oldest first
+
+    static std::shared_ptr<const Run> makeRun(const Column<float>& column, size_t firstRow) {
+        // Sorting (value, row) pairs keeps the comparisons on contiguous
+        // memory; an indirect sort through the column is twice as slow.
+        std::vector<std::pair<float, uint32_t>> pairs(column.size() - firstRow);
+        for (size_t i = 0; i < pairs.size(); ++i) pairs[i] = {column[firstRow + i], static_cast<uint32_t>(firstRow + i)};
+        std::sort(pairs.begin(), pairs.end());
+
+        auto run = std::make_shared<Run>();
+        run->firstRow = firstRow;
+        run->endRow = column.size();
+        run->values.resize(pairs.size());
+        run->rows.resize(pairs.size());
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            run->values[i] = pairs[i].first;
+            run->rows[i] = pairs[i].second;
+        }
+        return run;
+    }
+
+    // Gives the order makeRun() would over both runs' rows.
+    static std::shared_ptr<const Run> mergeRuns(const Run& older, const Run& newer) {
+        auto run = std::make_shared<Run>();
+        run->firstRow = older.firstRow;
+        run->endRow = newer.endRow;
+        run->values.resize(older.values.size() + newer.values.size());
+        run->rows.resize(run->values.size());
+        size_t i = 0, j = 0;
+        for (size_t out = 0; out < run->values.size(); ++out) {
+            // The older run's rows have lower ids, so they win ties.
+            if (j == newer.values.size() || (i < older.values.size() && !(newer.values[j] < older.values[i]))) {
+                run->values[out] = older.values[i];
+                run->rows[out] = older.rows[i++];
+            } else {
+                run->values[out] = newer.values[j];
+                run->rows[out] = newer.rows[j++];
+            }
+        }
+        return run;
+    }
+
+    size_t endRow() const { return runs.empty() ? 0 : runs.back()->endRow; }
+
+public:
+    void build(const Column<float>& column) {
+        runs.clear();
+        runs.push_back(makeRun(column, 0));
+    }
+
+    // Index rows [firstRow, column.size()) as a new run, sharing the
+    // existing ones.
+    void append(const Column<float>& column, size_t firstRow) {
+        runs.push_back(makeRun(column, firstRow));
+        mergeNewestRuns(runs, mergeRuns);
+    }
+
+    // Rows from firstRow on with min <= value <= max, built in each run
+    // from whichever side of the range is smaller.
+    RowBitmap select(float min, float max, size_t firstRow = 0) const {
+        RowBitmap bitmap(firstRow, std::max(firstRow, endRow()), false);
+        for (const auto& run : runs) {
+            if (run->endRow <= firstRow) continue;
+            auto [first, last] = run->range(min, max);
+            if (run->firstRow < firstRow) {
+                for (size_t i = first; i < last; ++i) {
+                    if (run->rows[i] >= firstRow) bitmap.set(run->rows[i]);
+                }
+                continue;
+            }
+            if (last - first > run->rowCount() / 2) {
+                bitmap.setRange(run->firstRow, run->endRow);
+                for (size_t i = 0; i < first; ++i) bitmap.reset(run->rows[i]);
+                for (size_t i = last; i < run->rows.size(); ++i) bitmap.reset(run->rows[i]);
+            } else {
+                for (size_t i = first; i < last; ++i) bitmap.set(run->rows[i]);
+            }
+        }
+        return bitmap;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = 0;
+        for (const auto& run : runs) bytes += run->values.capacity() * sizeof(float) + run->rows.capacity() * sizeof(uint32_t);
+        return bytes;
+    }
+};
+
+// A conjunction of predicates. A row matches a category term if its value
+// is any of the listed ones, and a range term if min <= value <= max.
+struct DatasetFilter {
+    struct Category {
+        std::string field;
+        std::vector<std::string> values;
+    };
+
+    struct Range {
+        std::string field;
+        float min = std::numeric_limits<float>::lowest();
+        float max = std::numeric_limits<float>::max();
+    };
+
+    std::vector<Category> categories;
+    std::vector<Range> ranges;
+
+    bool empty() const { return categories.empty() && ranges.empty(); }
+};
+
+// Parses comma-separated terms: "field=a|b" for categories and
+// "field>=x", "field<=x", "field>x", "field<x" for ranges, e.g.
+// "wasteType=Plastic,locationType=River|Estuary,confidence>=80".
+inline bool parseDatasetFilter(const std::string& text, DatasetFilter& filter, std::string& error) {
+    filter = DatasetFilter();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string term = text.substr(start, end - start);
+        start = end + 1;
+        if (term.empty()) continue;
+
+        size_t op = term.find_first_of("<>=");
+        if (op == 0 || op == std::string::npos) {
+            error = "expected field=value or field<op>number in '" + term + "'";
+            return false;
+        }
+        std::string field = term.substr(0, op);
+
+        if (term[op] == '=') {
+            DatasetFilter::Category category{field, {}};
+            size_t from = op + 1;
+            while (from <= term.size()) {
+                size_t bar = term.find('|', from);
+                if (bar == std::string::npos) bar = term.size();
+                category.values.push_back(term.substr(from, bar - from));
+                from = bar + 1;
+            }
+            filter.categories.push_back(std::move(category));
+            continue;
+        }
+
+        bool inclusive = op + 1 < term.size() && term[op + 1] == '=';
+        std::string number = term.substr(op + (inclusive ? 2 : 1));
+        char* parsedEnd = nullptr;
+        float value = std::strtof(number.c_str(), &parsedEnd);
+        if (number.empty() || *parsedEnd != '\0' || std::isnan(value)) {
+            error = "invalid number in '" + term + "'";
+            return false;
+        }
+
+        DatasetFilter::Range range{field};
+        if (term[op] == '>') {
+            range.min = inclusive ? value : std::nextafter(value, std::numeric_limits<float>::max());
+        } else {
+            range.max = inclusive ? value : std::nextafter(value, std::numeric_limits<float>::lowest());
+        }
+        filter.ranges.push_back(range);
+    }
+    return true;
+}
+
+// Named secondary indexes over one dataset, built after it loads and
+// extended as rows are appended.
+// select() turns each filter term into a bitmap and intersects them.
+class DatasetIndex {
+private:
+    size_t rowCount = 0;
+    std::vector<std::pair<std::string, CategoricalIndex>> categorical;
+    std::vector<std::pair<std::string, SortedIndex>> sorted;
+    double buildSeconds = 0.0;
+
+    template <typename Index>
+    static const Index* find(const std::vector<std::pair<std::string, Index>>& indexes, const std::string& field) {
+        for (const auto& [name, index] : indexes) {
+            if (name == field) return &index;
+        }
+        return nullptr;
+    }
+
+    std::string fieldList() const {
+        std::string list;
+        for (const auto& entry : categorical) list += (list.empty() ? "" : ", ") + entry.first;
+        for (const auto& entry : sorted) list += (list.empty() ? "" : ", ") + entry.first;
+        return list;
+    }
+
+    // The indexed fields of each dataset, in index order.
+    template <typename CategoricalFn, typename SortedFn>
+    static void indexedFields(const WasteColumns& dataset, CategoricalFn&& categoricalField, SortedFn&& sortedField) {
+        categoricalField("waterBodyType", dataset.waterBodyType);
+        categoricalField("locationType", dataset.locationType);
+        categoricalField("wasteType", dataset.wasteType);
+        sortedField("confidence", dataset.confidence);
+        sortedField("size", dataset.size);
+    }
+
+    template <typename CategoricalFn, typename SortedFn>
+    static void indexedFields(const MarineColumns& dataset, CategoricalFn&& categoricalField, SortedFn&& sortedField) {
+        categoricalField("waterBodyType", dataset.waterBodyType);
+        categoricalField("locationType", dataset.locationType);
+        categoricalField("animalType", dataset.animalType);
+        categoricalField("animalSpecies", dataset.animalSpecies);
+        sortedField("confidence", dataset.confidence);
+        sortedField("size", dataset.size);
+    }
+
+    template <typename Fn>
+    void timed(Fn&& fn) {
+        auto started = std::chrono::steady_clock::now();
+        fn();
+        buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+public:
+    template <typename Columns>
+    void build(const Columns& dataset) {
+        timed([&] {
+            categorical.clear();
+            sorted.clear();
+            rowCount = dataset.rowCount();
+            indexedFields(
+                dataset,
+                [&](const char* name, const Column<uint32_t>& column) {
+                    categorical.emplace_back(name, CategoricalIndex());
+                    categorical.back().second.build(column, dataset.strings);
+                },
+                [&](const char* name, const Column<float>& column) {
+                    sorted.emplace_back(name, SortedIndex());
+                    sorted.back().second.build(column);
+                });
+        });
+    }
+
+    // Index the rows appended to `dataset` since the last build() or
+    // extend(), without rebuilding: the new rows become a run of each
+    // index, and the runs of the index this was copied from are shared.
+    template <typename Columns>
+    void extend(const Columns& dataset) {
+        if (categorical.empty() && sorted.empty()) {
+            build(dataset);
+            return;
+        }
+        timed([&] {
+            size_t firstRow = rowCount;
+            size_t nextCategorical = 0, nextSorted = 0;
+            indexedFields(
+                dataset,
+                [&](const char*, const Column<uint32_t>& column) {
+                    categorical[nextCategorical++].second.append(column, dataset.strings, firstRow);
+                },
+                [&](const char*, const Column<float>& column) { sorted[nextSorted++].second.append(column, firstRow); });
+            rowCount = dataset.rowCount();
+        });
+    }
+
+    size_t rows() const { return rowCount; }
+    double getBuildSeconds() const { return buildSeconds; }
+
+    // Rows from firstRow on matching every term of `filter`; an empty
+    // filter matches all.
+    bool select(const DatasetFilter& filter, RowBitmap& result, std::string& error, size_t firstRow = 0) const {
+        result = RowBitmap(firstRow, std::max(firstRow, rowCount), true);
+        for (const auto& term : filter.categories) {
+            const CategoricalIndex* index = find(categorical, term.field);
+            if (!index) {
+                error = "no index on '" + term.field + "' (indexed: " + fieldList() + ")";
+                return false;
+            }
+            result &= index->select(term.values, firstRow);
+        }
+        for (const auto& term : filter.ranges) {
+            const SortedIndex* index = find(sorted, term.field);
+            if (!index) {
+                error = "no index on '" + term.field + "' (indexed: " + fieldList() + ")";
+                return false;
+            }
+            result &= index->select(term.min, term.max, firstRow);
+        }
+        return true;
+    }
+
+    size_t memoryUsage() const {
+        size_t bytes = sizeof(*this);
+        for (const auto& entry : categorical) bytes += entry.second.memoryUsage();
+        for (const auto& entry : sorted) bytes += entry.second.memoryUsage();
+        return bytes;
+    }
+};
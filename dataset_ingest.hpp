@@ -0,0 +1,488 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "aquatic_detector.hpp"
+#include "log_format.hpp"
+#include "metrics.hpp"
+
+// Follows a file that is only ever appended to, handing back whole new
+// lines. A line still being written is held until its newline arrives.
+// Truncation, or a new file replacing it at the same path (rotation), is
+// reported so the caller can re-read the file from the start.
+class FileTail {
+public:
+    enum class Change { None, Appended, Replaced };
+
+private:
+    std::string path;
+    uint64_t offset = 0;      // bytes read so far, including `partial`
+    std::string partial;      // an unfinished last line
+    bool skipToNewline = false;
+    char lastByte = '\n';     // the byte before `offset`, re-checked on every read
+    uint64_t device = 0;
+    uint64_t inode = 0;
+
+#ifndef _WIN32
+    static bool readAt(int fd, uint64_t position, char* out, size_t count) {
+        while (count > 0) {
+            ssize_t got = pread(fd, out, count, static_cast<off_t>(position));
+            if (got <= 0) return false;
+            out += got;
+            position += static_cast<uint64_t>(got);
+            count -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+#endif
+
+public:
+    // Follow `filePath` from byte `position`, usually where a full load of
+    // it ended. If that is mid-line, the loader parsed the line as it was,
+    // so the rest of it is skipped. Returns false if the file cannot be
+    // opened; it is then reported as Replaced once it appears.
+    bool follow(const std::string& filePath, uint64_t position) {
+        path = filePath;
+        offset = position;
+        partial.clear();
+        skipToNewline = false;
+        lastByte = '\n';
+        device = inode = 0;
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        if (ok) {
+            device = static_cast<uint64_t>(st.st_dev);
+            inode = static_cast<uint64_t>(st.st_ino);
+            if (position > 0) ok = readAt(fd, position - 1, &lastByte, 1);
+        }
+        ::close(fd);
+        skipToNewline = lastByte != '\n';
+        return ok;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        if (position > 0) {
+            file.seekg(static_cast<std::streamoff>(position - 1));
+            file.get(lastByte);
+        }
+        skipToNewline = lastByte != '\n';
+        return static_cast<bool>(file);
+#endif
+    }
+
+    // Read what was appended since the last call. On Appended `lines` holds
+    // the new complete lines and `modified` the file's modification time.
+    // A missing file is None: a rotation may be half done.
+    Change read(std::string& lines, std::chrono::system_clock::time_point& modified) {
+        lines.clear();
+        std::string fresh;
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return Change::None;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return Change::None;
+        }
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        if (static_cast<uint64_t>(st.st_dev) != device || static_cast<uint64_t>(st.st_ino) != inode || size < offset) {
+            ::close(fd);
+            return Change::Replaced;
+        }
+        if (size == offset) {
+            ::close(fd);
+            return Change::None;
+        }
+#ifdef __APPLE__
+        const struct timespec& mtime = st.st_mtimespec;
+#else
+        const struct timespec& mtime = st.st_mtim;
+#endif
+        modified = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(mtime.tv_sec) + std::chrono::nanoseconds(mtime.tv_nsec)));
+
+        // Start one byte early: if that byte changed, the file was
+        // truncated and refilled past our offset between two reads.
+        uint64_t start = offset > 0 ? offset - 1 : 0;
+        fresh.resize(static_cast<size_t>(size - start));
+        bool ok = readAt(fd, start, &fresh[0], fresh.size());
+        ::close(fd);
+        if (!ok) return Change::None;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return Change::None;
+        uint64_t size = static_cast<uint64_t>(file.tellg());
+        if (size < offset) return Change::Replaced;
+        if (size == offset) return Change::None;
+        modified = std::chrono::system_clock::now();
+        uint64_t start = offset > 0 ? offset - 1 : 0;
+        fresh.resize(static_cast<size_t>(size - start));
+        file.seekg(static_cast<std::streamoff>(start));
+        if (!file.read(&fresh[0], static_cast<std::streamsize>(fresh.size()))) return Change::None;
+#endif
+        if (offset > 0) {
+            if (fresh[0] != lastByte) return Change::Replaced;
+            partial.append(fresh, 1, std::string::npos);
+        } else {
+            partial.append(fresh);
+        }
+        offset = size;
+        lastByte = fresh.back();
+
+        if (skipToNewline) {
+            size_t newline = partial.find('\n');
+            if (newline == std::string::npos) {
+                partial.clear();
+                return Change::None;
+            }
+            partial.erase(0, newline + 1);
+            skipToNewline = false;
+        }
+
+        size_t end = partial.rfind('\n');
+        if (end == std::string::npos) return Change::None;
+        lines.assign(partial, 0, end + 1);
+        partial.erase(0, end + 1);
+        return Change::Appended;
+    }
+
+    const std::string& getPath() const { return path; }
+    uint64_t position() const { return offset; }
+    size_t pendingBytes() const { return partial.size(); }
+};
+
+// Sleeps until a watched file may have changed, a timeout passes or wake()
+// is called. On Linux it uses inotify on the files' directories, so a file
+// renamed into place is noticed as well as appends; elsewhere (or if
+// inotify is unavailable) it only times out, and callers poll.
+class FileWatcher {
+private:
+    struct Watch {
+        int descriptor;
+        std::string name;
+    };
+
+    int notifyFd = -1;
+    int wakeFd = -1;
+    std::vector<Watch> watches;
+    std::mutex wakeMutex;
+    std::condition_variable wakeSignal;
+    bool woken = false;
+
+    static std::pair<std::string, std::string> splitPath(const std::string& path) {
+        size_t slash = path.rfind('/');
+        if (slash == std::string::npos) return {".", path};
+        return {slash == 0 ? "/" : path.substr(0, slash), path.substr(slash + 1)};
+    }
+
+    void close() {
+#ifdef __linux__
+        if (notifyFd >= 0) ::close(notifyFd);
+        if (wakeFd >= 0) ::close(wakeFd);
+#endif
+        notifyFd = wakeFd = -1;
+        watches.clear();
+    }
+
+#ifdef __linux__
+    // Drain pending events; true if any names a watched file.
+    bool drainEvents() {
+        alignas(inotify_event) char buffer[4096];
+        bool relevant = false;
+        while (true) {
+            ssize_t got = ::read(notifyFd, buffer, sizeof(buffer));
+            if (got <= 0) break;
+            for (ssize_t pos = 0; pos < got;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+                if (event->mask & IN_Q_OVERFLOW) relevant = true;
+                if (event->len > 0) {
+                    for (const Watch& watch : watches) {
+                        if (watch.descriptor == event->wd && watch.name == event->name) relevant = true;
+                    }
+                }
+                pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+        return relevant;
+    }
+#endif
+
+public:
+    FileWatcher() = default;
+    ~FileWatcher() { close(); }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watch `paths`, replacing any earlier set. Returns false if change
+    // notification is unavailable; wait() then always runs to its timeout.
+    bool watch(const std::vector<std::string>& paths) {
+        close();
+#ifdef __linux__
+        notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (notifyFd < 0 || wakeFd < 0) {
+            close();
+            return false;
+        }
+        for (const std::string& path : paths) {
+            auto [directory, name] = splitPath(path);
+            int descriptor = inotify_add_watch(notifyFd, directory.c_str(),
+                                               IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE |
+                                                   IN_MOVED_FROM);
+            if (descriptor < 0) {
+                close();
+                return false;
+            }
+            watches.push_back({descriptor, name});
+        }
+        return true;
+#else
+        (void)paths;
+        return false;
+#endif
+    }
+
+    bool usingNotifications() const { return notifyFd >= 0; }
+
+    // Returns true if a watched file changed; false on timeout or wake().
+    bool wait(std::chrono::milliseconds timeout) {
+#ifdef __linux__
+        if (notifyFd >= 0) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (true) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                pollfd fds[2] = {{notifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+                int ready = ::poll(fds, 2, static_cast<int>(std::max<int64_t>(0, left.count())));
+                if (ready <= 0) return false;
+                if (fds[1].revents & POLLIN) {
+                    uint64_t count;
+                    (void)!::read(wakeFd, &count, sizeof(count));
+                    return false;
+                }
+                // The directory may be busy with other files (the log, a
+                // snapshot being written); keep waiting through those.
+                if (drainEvents()) return true;
+            }
+        }
+#endif
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeSignal.wait_for(lock, timeout, [this] { return woken; });
+        woken = false;
+        return false;
+    }
+
+    // Make the current (or next) wait() return early.
+    void wake() {
+#ifdef __linux__
+        if (wakeFd >= 0) {
+            uint64_t one = 1;
+            (void)!::write(wakeFd, &one, sizeof(one));
+            return;
+        }
+#endif
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        woken = true;
+        wakeSignal.notify_all();
+    }
+};
+
+struct IngestConfig {
+    std::chrono::milliseconds pollInterval{1000};    // re-check without a notification (the only check without inotify)
+    std::chrono::milliseconds minBatchInterval{100}; // a burst of appends within this becomes one publish
+};
+
+struct IngestStats {
+    uint64_t rows = 0;
+    uint64_t badRows = 0;
+    uint64_t bytes = 0;
+    uint64_t batches = 0;
+    uint64_t reloads = 0;      // files truncated or replaced, re-read in full
+    double busySeconds = 0.0;  // parsing, indexing and publishing
+    double lastLagSeconds = 0.0;
+    double maxLagSeconds = 0.0;
+    bool notifications = false;
+
+    double rowsPerSecond() const { return busySeconds > 0 ? rows / busySeconds : 0.0; }
+};
+
+// Streams rows appended to the detector's dataset CSVs into it while it
+// runs. A background thread waits on FileWatcher, reads only the new bytes
+// through FileTail and hands whole lines to AquaticDetector::append*Rows,
+// which publishes a new dataset version without blocking detection. A
+// truncated or rotated file is reloaded in full.
+//
+// Lag is measured from the file's last modification to the rows being
+// visible to detect(), so it covers notification, parsing and publishing.
+class DatasetIngester {
+private:
+    AquaticDetector& detector;
+    IngestConfig config;
+    FileTail wasteTail;
+    FileTail marineTail;
+    FileWatcher watcher;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::function<void(std::string_view)> logHandler;
+    LatencyHistogram* lagLatency = nullptr; // set by instrument()
+
+    mutable std::mutex statsMutex;
+    IngestStats stats;
+
+    void note(std::string_view message) {
+        if (logHandler) logHandler(message);
+    }
+
+    template <typename Append, typename Reload>
+    void ingest(const char* name, FileTail& tail, Append&& append, Reload&& reload) {
+        std::string lines;
+        std::chrono::system_clock::time_point modified;
+        FileTail::Change change = tail.read(lines, modified);
+
+        if (change == FileTail::Change::Replaced) {
+            LogLine& message = scratchLine();
+            message << "Ingest: " << name << " dataset " << tail.getPath() << " was truncated or replaced; reloading";
+            note(message.view());
+            CsvLoadStats loaded = reload();
+            tail.follow(tail.getPath(), loaded.bytes);
+            std::lock_guard<std::mutex> lock(statsMutex);
+            ++stats.reloads;
+            return;
+        }
+        if (change != FileTail::Change::Appended) return;
+
+        AppendStats result;
+        append(lines, result);
+        auto lag = std::max(std::chrono::system_clock::duration::zero(), std::chrono::system_clock::now() - modified);
+        if (lagLatency) lagLatency->record(std::chrono::duration_cast<std::chrono::steady_clock::duration>(lag));
+        double lagSeconds = std::chrono::duration<double>(lag).count();
+
+        if (result.badRows > 0) {
+            LogLine& message = scratchLine();
+            message << "Ingest: skipped " << result.badRows << " malformed " << name << " rows";
+            note(message.view());
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.rows += result.rows;
+        stats.badRows += result.badRows;
+        stats.bytes += lines.size();
+        ++stats.batches;
+        stats.busySeconds += result.seconds;
+        stats.lastLagSeconds = lagSeconds;
+        stats.maxLagSeconds = std::max(stats.maxLagSeconds, lagSeconds);
+    }
+
+    void loop() {
+        auto lastBatch = std::chrono::steady_clock::now() - config.minBatchInterval;
+        while (running.load()) {
+            watcher.wait(config.pollInterval);
+            // Coalesce a burst: wait out the rest of minBatchInterval.
+            auto due = lastBatch + config.minBatchInterval;
+            while (running.load() && std::chrono::steady_clock::now() < due) {
+                watcher.wait(std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now()) +
+                             std::chrono::milliseconds(1));
+            }
+            if (!running.load()) break;
+            pollOnce();
+            lastBatch = std::chrono::steady_clock::now();
+        }
+    }
+
+public:
+    explicit DatasetIngester(AquaticDetector& target, const IngestConfig& cfg = IngestConfig())
+        : detector(target), config(cfg) {}
+
+    ~DatasetIngester() { stop(); }
+
+    DatasetIngester(const DatasetIngester&) = delete;
+    DatasetIngester& operator=(const DatasetIngester&) = delete;
+
+    // Called with one-line notes (reloads, malformed rows) from the
+    // ingestion thread. Set before start().
+    void setLogHandler(std::function<void(std::string_view)> handler) { logHandler = std::move(handler); }
+
+    // Follow both dataset files from where the detector's load of them
+    // ended, and start the ingestion thread. Idempotent.
+    void start() {
+        if (running.exchange(true)) return;
+        wasteTail.follow(detector.getWastePath(), detector.getWasteLoadStats().bytes);
+        marineTail.follow(detector.getMarinePath(), detector.getMarineLoadStats().bytes);
+        bool notifications = watcher.watch({wasteTail.getPath(), marineTail.getPath()});
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.notifications = notifications;
+        }
+        worker = std::thread([this]() { loop(); });
+    }
+
+    void stop() {
+        if (!running.exchange(false)) return;
+        watcher.wake();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Ingest whatever has been appended, now, on the calling thread. The
+    // ingestion thread does this after each notification; call it directly
+    // only while that thread is not running.
+    void pollOnce() {
+        ingest("waste", wasteTail,
+               [this](std::string_view lines, AppendStats& result) { detector.appendWasteRows(lines, result); },
+               [this] {
+                   detector.reloadWasteDataset();
+                   return detector.getWasteLoadStats();
+               });
+        ingest("marine", marineTail,
+               [this](std::string_view lines, AppendStats& result) { detector.appendMarineRows(lines, result); },
+               [this] {
+                   detector.reloadMarineDataset();
+                   return detector.getMarineLoadStats();
+               });
+    }
+
+    IngestStats getStats() const {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+
+    // Register the lag histogram and row counters. Call before start().
+    void instrument(MetricsRegistry& metrics) {
+        lagLatency = &metrics.histogram("aquatic_ingest_lag_seconds",
+                                        "Time from a dataset file changing to its new rows being replayable");
+        using Type = MetricsRegistry::Type;
+        metrics.sample("aquatic_ingest_rows_total", "Rows appended to the datasets while running", Type::Counter, "",
+                       [this] { return static_cast<double>(getStats().rows); });
+        metrics.sample("aquatic_ingest_bad_rows_total", "Appended rows skipped as malformed", Type::Counter, "",
+                       [this] { return static_cast<double>(getStats().badRows); });
+        metrics.sample("aquatic_ingest_reloads_total", "Dataset files reloaded after truncation or rotation",
+                       Type::Counter, "", [this] { return static_cast<double>(getStats().reloads); });
+        metrics.sample("aquatic_ingest_rows_per_second", "Ingestion throughput while busy", Type::Gauge, "",
+                       [this] { return getStats().rowsPerSecond(); });
+    }
+};
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "columnar_dataset.hpp"
+#include "csv_loader.hpp"
+
+// Binary snapshot of a parsed dataset, written next to its CSV as
+// "<csv>.snap". The file holds the column arrays and string pool exactly as
+// they sit in memory, 64-byte aligned, so loading is mmap + validation and
+// the columns borrow straight from the mapping.
+//
+// Layout: SnapshotHeader | string offsets (uint64[n+1]) | string bytes |
+//         column 0 | column 1 | ...
+// A snapshot is stale when the CSV's size or mtime differs from the values
+// recorded in the header; it is then rebuilt from the CSV.
+
+enum class SnapshotKind : uint32_t { Waste = 1, Marine = 2 };
+
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint32_t kSnapshotByteOrder = 0x01020304;
+constexpr size_t kSnapshotMaxColumns = 16;
+constexpr size_t kSnapshotAlignment = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t kind;
+    uint32_t columnCount;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t rowCount;
+    uint64_t stringCount;
+    uint64_t stringOffsetsOffset;
+    uint64_t stringBlobOffset;
+    uint64_t columnOffsets[kSnapshotMaxColumns];
+    uint64_t fileSize;
+    uint64_t payloadChecksum; // over [sizeof(SnapshotHeader), fileSize)
+    uint64_t headerChecksum;  // over the header bytes before this field
+};
+
+static_assert(std::is_trivially_copyable<SnapshotHeader>::value, "snapshot header is written raw");
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "snapshot header must keep 8-byte alignment");
+
+// Streaming 64-bit checksum. Four independent lanes over 32-byte stripes
+// keep it near memory bandwidth; it guards against torn or corrupted files,
+// not against tampering.
+class Checksum64 {
+private:
+    static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+    uint64_t lanes[4] = {kPrime1, kPrime2, ~kPrime1, ~kPrime2};
+    unsigned char pending[32];
+    size_t pendingSize = 0;
+    uint64_t totalSize = 0;
+
+    static uint64_t rotl(uint64_t v, int r) { return (v << r) | (v >> (64 - r)); }
+
+    void stripe(const unsigned char* p) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t word;
+            std::memcpy(&word, p + i * 8, 8);
+            lanes[i] = rotl(lanes[i] + word * kPrime2, 31) * kPrime1;
+        }
+    }
+
+public:
+    void update(const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        totalSize += size;
+
+        if (pendingSize > 0) {
+            size_t take = std::min(size, sizeof(pending) - pendingSize);
+            std::memcpy(pending + pendingSize, p, take);
+            pendingSize += take;
+            p += take;
+            size -= take;
+            if (pendingSize < sizeof(pending)) return;
+            stripe(pending);
+            pendingSize = 0;
+        }
+        for (; size >= 32; p += 32, size -= 32) stripe(p);
+        std::memcpy(pending, p, size);
+        pendingSize = size;
+    }
+
+    uint64_t digest() const {
+        uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        h ^= totalSize * kPrime1;
+        for (size_t i = 0; i < pendingSize; ++i) h = rotl(h ^ (pending[i] * kPrime2), 11) * kPrime1;
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        return h;
+    }
+
+    static uint64_t of(const void* data, size_t size) {
+        Checksum64 sum;
+        sum.update(data, size);
+        return sum.digest();
+    }
+};
+
+struct SnapshotSource {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+
+    static bool stat(const std::string& csvPath, SnapshotSource& out) {
+        std::error_code ec;
+        out.size = std::filesystem::file_size(csvPath, ec);
+        if (ec) return false;
+        auto mtime = std::filesystem::last_write_time(csvPath, ec);
+        if (ec) return false;
+        out.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+        return true;
+    }
+};
+
+inline std::string snapshotPathFor(const std::string& csvPath) { return csvPath + ".snap"; }
+
+namespace snapshot_detail {
+
+inline uint64_t alignUp(uint64_t offset) {
+    return (offset + kSnapshotAlignment - 1) & ~static_cast<uint64_t>(kSnapshotAlignment - 1);
+}
+
+class Writer {
+private:
+    std::ofstream out;
+    Checksum64 checksum;
+    uint64_t position = 0;
+
+public:
+    explicit Writer(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {}
+
+    bool ok() const { return out.good(); }
+    uint64_t offset() const { return position; }
+
+    void write(const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        checksum.update(data, size);
+        position += size;
+    }
+
+    void padTo(uint64_t target) {
+        static const char zeros[kSnapshotAlignment] = {};
+        while (position < target) write(zeros, static_cast<size_t>(std::min<uint64_t>(target - position, sizeof(zeros))));
+    }
+
+    void align() { padTo(alignUp(position)); }
+
+    // Placeholder for the header, which is not part of the payload checksum.
+    void reserveHeader() {
+        SnapshotHeader blank{};
+        out.write(reinterpret_cast<const char*>(&blank), sizeof(blank));
+        position += sizeof(blank);
+    }
+
+    // The header is rewritten last, once every offset and the payload
+    // checksum are known; it is deliberately kept out of the checksum.
+    bool finish(SnapshotHeader& header) {
+        header.fileSize = position;
+        header.payloadChecksum = checksum.digest();
+        header.headerChecksum = Checksum64::of(&header, offsetof(SnapshotHeader, headerChecksum));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.flush();
+        return out.good();
+    }
+};
+
+} // namespace snapshot_detail
+
+// Write `columns` as a snapshot of `csvPath`. The file is written to a
+// temporary name and renamed into place so a crash never leaves a torn
+// snapshot where the loader would find it.
+template <typename Columns>
+bool writeSnapshot(const std::string& csvPath, SnapshotKind kind, Columns& columns) {
+    SnapshotSource source;
+    if (!SnapshotSource::stat(csvPath, source)) return false;
+
+    const std::string finalPath = snapshotPathFor(csvPath);
+    const std::string tempPath = finalPath + ".tmp";
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, "AQSNAP\0\0", 8);
+    header.version = kSnapshotVersion;
+    header.byteOrder = kSnapshotByteOrder;
+    header.kind = static_cast<uint32_t>(kind);
+    header.sourceSize = source.size;
+    header.sourceMtime = source.mtime;
+    header.rowCount = columns.rowCount();
+    header.stringCount = columns.strings.size();
+
+    {
+        snapshot_detail::Writer writer(tempPath);
+        if (!writer.ok()) return false;
+
+        writer.reserveHeader();
+        writer.align();
+
+        header.stringOffsetsOffset = writer.offset();
+        uint64_t stringOffset = 0;
+        for (uint64_t i = 0; i < header.stringCount; ++i) {
+            writer.write(&stringOffset, sizeof(stringOffset));
+            stringOffset += columns.strings.get(static_cast<uint32_t>(i)).size();
+        }
+        writer.write(&stringOffset, sizeof(stringOffset));
+
+        header.stringBlobOffset = writer.offset();
+        for (uint64_t i = 0; i < header.stringCount; ++i) {
+            std::string_view value = columns.strings.get(static_cast<uint32_t>(i));
+            writer.write(value.data(), value.size());
+        }
+
+        uint32_t columnIndex = 0;
+        columns.forEachColumn([&](auto& column) {
+            using T = typename std::decay_t<decltype(column)>::value_type;
+            writer.align();
+            header.columnOffsets[columnIndex++] = writer.offset();
+            writer.write(column.data(), column.size() * sizeof(T));
+        });
+        header.columnCount = columnIndex;
+        writer.align();
+
+        if (!writer.ok() || !writer.finish(header)) {
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+// Map the snapshot for `csvPath` into `columns`. Returns false, with the
+// reason in `why`, if it is missing, stale, from another build or corrupt;
+// `columns` is left untouched in that case.
+template <typename Columns>
+bool loadSnapshot(const std::string& csvPath, SnapshotKind kind, Columns& columns, std::string& why,
+                  bool verifyChecksum = true) {
+    SnapshotSource source;
+    if (!SnapshotSource::stat(csvPath, source)) {
+        why = "source CSV not found";
+        return false;
+    }
+
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(snapshotPathFor(csvPath))) {
+        why = "no snapshot";
+        return false;
+    }
+
+    const char* base = file->data();
+    if (file->size() < sizeof(SnapshotHeader)) {
+        why = "truncated header";
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, "AQSNAP\0\0", 8) != 0 || header.byteOrder != kSnapshotByteOrder) {
+        why = "not a snapshot for this platform";
+        return false;
+    }
+    if (header.version != kSnapshotVersion) {
+        why = "snapshot version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.headerChecksum != Checksum64::of(&header, offsetof(SnapshotHeader, headerChecksum))) {
+        why = "header checksum mismatch";
+        return false;
+    }
+    if (header.kind != static_cast<uint32_t>(kind)) {
+        why = "wrong dataset kind";
+        return false;
+    }
+    if (header.sourceSize != source.size || header.sourceMtime != source.mtime) {
+        why = "source CSV changed";
+        return false;
+    }
+    if (header.fileSize != file->size()) {
+        why = "truncated snapshot";
+        return false;
+    }
+
+    size_t expectedColumns = 0;
+    columns.forEachColumn([&](auto&) { ++expectedColumns; });
+    if (header.columnCount != expectedColumns) {
+        why = "column layout changed";
+        return false;
+    }
+
+    // Bounds-check every region before trusting any offset in it.
+    uint64_t offsetsEnd = header.stringOffsetsOffset + (header.stringCount + 1) * sizeof(uint64_t);
+    if (header.stringCount == 0 || offsetsEnd > header.fileSize || header.stringBlobOffset < offsetsEnd ||
+        header.stringOffsetsOffset % sizeof(uint64_t) != 0) {
+        why = "bad string table";
+        return false;
+    }
+    const uint64_t* stringOffsets = reinterpret_cast<const uint64_t*>(base + header.stringOffsetsOffset);
+    if (header.stringBlobOffset + stringOffsets[header.stringCount] > header.fileSize) {
+        why = "bad string table";
+        return false;
+    }
+
+    bool columnsValid = true;
+    uint32_t columnIndex = 0;
+    columns.forEachColumn([&](auto& column) {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+        uint64_t offset = header.columnOffsets[columnIndex++];
+        if (offset % alignof(T) != 0 || offset + header.rowCount * sizeof(T) > header.fileSize) {
+            columnsValid = false;
+        }
+    });
+    if (!columnsValid) {
+        why = "bad column table";
+        return false;
+    }
+
+    if (verifyChecksum &&
+        header.payloadChecksum != Checksum64::of(base + sizeof(SnapshotHeader), header.fileSize - sizeof(SnapshotHeader))) {
+        why = "payload checksum mismatch";
+        return false;
+    }
+
+    std::vector<std::string_view> values(header.stringCount);
+    const char* blob = base + header.stringBlobOffset;
+    for (uint64_t i = 0; i < header.stringCount; ++i) {
+        if (stringOffsets[i] > stringOffsets[i + 1]) {
+            why = "bad string table";
+            return false;
+        }
+        values[i] = std::string_view(blob + stringOffsets[i], stringOffsets[i + 1] - stringOffsets[i]);
+    }
+
+    columns.backing = file;
+    columns.strings.borrow(values);
+    columnIndex = 0;
+    columns.forEachColumn([&](auto& column) {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+        column.borrow(reinterpret_cast<const T*>(base + header.columnOffsets[columnIndex++]),
+                      static_cast<size_t>(header.rowCount));
+    });
+    return true;
+}
+
+// Size of the CSV a snapshot loaded by loadSnapshot() was built from; the
+// argument is the columns' `backing`.
+inline uint64_t snapshotSourceSize(const MappedFile& snapshot) {
+    SnapshotHeader header;
+    std::memcpy(&header, snapshot.data(), sizeof(header));
+    return header.sourceSize;
+}
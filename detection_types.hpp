@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "log_format.hpp"
+
+// Floats are written with to_string()'s six decimals, so existing logs
+// keep their layout.
+
+struct EnvironmentalData {
+    float temperature;
+    float turbidity;
+    float pH;
+    float salinity;
+    time_t timestamp;
+
+    template <typename Out>
+    void appendTo(Out& out) const {
+        out << '[' << formatLocalTimestamp(timestamp) << "] Temp: " << fixedFloat(temperature, 6)
+            << "°C | Turbidity: " << fixedFloat(turbidity, 6) << " NTU | pH: " << fixedFloat(pH, 6)
+            << " | Salinity: " << fixedFloat(salinity, 6) << " ppt";
+    }
+
+    std::string toString() const {
+        LogLine line;
+        appendTo(line);
+        return line.str();
+    }
+};
+
+struct DetectionResult {
+    std::string label;
+    float confidence;
+    float size;
+    std::string activity;
+    time_t timestamp;
+    cv::Rect box; // pixel bounding box in the source frame; empty for dataset replay
+    uint32_t trackId = 0; // set by ObjectTracker; 0 when untracked
+
+    template <typename Out>
+    void appendTo(Out& out) const {
+        out << '[' << formatLocalTimestamp(timestamp) << "] " << label << " (" << fixedFloat(confidence, 6) << "%)";
+        if (size > 0) out << " | Size: " << fixedFloat(size, 6) << " cm";
+        if (!activity.empty()) out << " | Activity: " << activity;
+        if (trackId) out << " | Track: " << trackId;
+    }
+
+    std::string toString() const {
+        LogLine line;
+        appendTo(line);
+        return line.str();
+    }
+};
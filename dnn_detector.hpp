@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "detection_types.hpp"
+
+// Marine detections first, waste detections second, as AquaticDetector::detect returns them.
+using DetectionPair = std::pair<std::vector<DetectionResult>, std::vector<DetectionResult>>;
+
+struct InferenceConfig {
+    std::string modelPath;      // .onnx, or Darknet .weights
+    std::string configPath;     // Darknet .cfg; empty for ONNX
+    std::string classNamesPath; // one class per line, "marine:" or "waste:" prefix (default waste)
+    int inputWidth = 640;
+    int inputHeight = 640;
+    float confidenceThreshold = 0.5f;
+    float nmsThreshold = 0.45f;
+    float pixelScale = 1.0f / 255.0f;
+    bool swapRB = true;
+    float cmPerPixel = 0.0f; // calibration for DetectionResult::size; 0 leaves size unset
+    int threads = 0;         // cv::setNumThreads value; 0 keeps OpenCV's default
+};
+
+// Frames/sec and per-frame latency for one detection backend.
+struct InferenceStats {
+    size_t frames = 0;
+    size_t batches = 0;
+    double seconds = 0.0;
+
+    void record(size_t frameCount, double elapsed) {
+        frames += frameCount;
+        ++batches;
+        seconds += elapsed;
+    }
+
+    double framesPerSecond() const { return seconds > 0 ? frames / seconds : 0.0; }
+    double msPerFrame() const { return frames > 0 ? seconds * 1000.0 / frames : 0.0; }
+};
+
+// CPU object detector on top of cv::dnn. Handles YOLO-style outputs from
+// Darknet (rows of cx,cy,w,h,obj,classes...) and ONNX exports, either
+// [N, boxes, attrs] or the transposed [N, attrs, boxes] layout without an
+// objectness column. A whole batch of frames goes through one forward pass,
+// and the input blob and output buffers are reused between calls.
+class DnnDetector {
+private:
+    struct ClassInfo {
+        std::string label;
+        bool isMarine;
+    };
+
+    InferenceConfig config;
+    cv::dnn::Net net;
+    std::vector<std::string> outputNames;
+    std::vector<ClassInfo> classes;
+    cv::Mat inputBlob;
+    std::vector<cv::Mat> outputs;
+    InferenceStats stats;
+    std::mutex netMutex; // cv::dnn::Net is not safe for concurrent forward()
+
+    // Scratch reused across frames to keep postprocessing allocation-light.
+    std::vector<cv::Rect> boxes;
+    std::vector<cv::Rect> shiftedBoxes;
+    std::vector<float> scores;
+    std::vector<int> classIds;
+    std::vector<int> keep;
+
+    void loadClassNames(const std::string& path) {
+        classes.clear();
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line.rfind("marine:", 0) == 0) {
+                classes.push_back({line.substr(7), true});
+            } else if (line.rfind("waste:", 0) == 0) {
+                classes.push_back({line.substr(6), false});
+            } else {
+                classes.push_back({line, false});
+            }
+        }
+    }
+
+    // View of one frame's predictions as a (boxes x attrs) float matrix.
+    // `transposed` means attributes run down the rows instead (YOLOv8 style).
+    static bool framePredictions(const cv::Mat& out, int frameIndex, int batchSize, const float*& data,
+                                 int& rows, int& attrs, bool& transposed) {
+        if (out.dims == 3) {
+            int a = out.size[1], b = out.size[2];
+            data = out.ptr<float>() + static_cast<size_t>(frameIndex) * a * b;
+            transposed = a < b;
+            rows = transposed ? b : a;
+            attrs = transposed ? a : b;
+            return true;
+        }
+        if (out.dims == 2) {
+            // Darknet region layers stack every frame's rows into one matrix.
+            int perFrame = out.rows / std::max(1, batchSize);
+            data = out.ptr<float>() + static_cast<size_t>(frameIndex) * perFrame * out.cols;
+            rows = perFrame;
+            attrs = out.cols;
+            transposed = false;
+            return true;
+        }
+        return false;
+    }
+
+    void collectCandidates(const cv::Mat& out, int frameIndex, int batchSize, const cv::Size& frameSize) {
+        const float* data = nullptr;
+        int rows = 0, attrs = 0;
+        bool transposed = false;
+        if (!framePredictions(out, frameIndex, batchSize, data, rows, attrs, transposed)) return;
+
+        bool hasObjectness = transposed ? false : (classes.empty() || attrs == static_cast<int>(classes.size()) + 5);
+        int classOffset = hasObjectness ? 5 : 4;
+        if (attrs <= classOffset) return;
+
+        auto at = [&](int row, int attr) {
+            return transposed ? data[static_cast<size_t>(attr) * rows + row] : data[static_cast<size_t>(row) * attrs + attr];
+        };
+
+        for (int r = 0; r < rows; ++r) {
+            float objectness = hasObjectness ? at(r, 4) : 1.0f;
+            if (objectness < config.confidenceThreshold) continue;
+
+            int bestClass = 0;
+            float bestScore = 0.0f;
+            for (int c = classOffset; c < attrs; ++c) {
+                float score = at(r, c);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestClass = c - classOffset;
+                }
+            }
+            float confidence = bestScore * objectness;
+            if (confidence < config.confidenceThreshold) continue;
+
+            float cx = at(r, 0), cy = at(r, 1), w = at(r, 2), h = at(r, 3);
+            // Darknet emits coordinates normalised to [0,1]; ONNX exports use input pixels.
+            bool normalised = cx <= 1.5f && cy <= 1.5f && w <= 1.5f && h <= 1.5f;
+            float sx = normalised ? frameSize.width : static_cast<float>(frameSize.width) / config.inputWidth;
+            float sy = normalised ? frameSize.height : static_cast<float>(frameSize.height) / config.inputHeight;
+
+            int left = static_cast<int>((cx - w / 2) * sx);
+            int top = static_cast<int>((cy - h / 2) * sy);
+            boxes.emplace_back(left, top, static_cast<int>(w * sx), static_cast<int>(h * sy));
+            scores.push_back(confidence);
+            classIds.push_back(bestClass);
+        }
+    }
+
+    void postprocess(int frameIndex, int batchSize, const cv::Size& frameSize, time_t timestamp,
+                     DetectionPair& result) {
+        boxes.clear();
+        scores.clear();
+        classIds.clear();
+        for (const auto& out : outputs) collectCandidates(out, frameIndex, batchSize, frameSize);
+
+        // Class-aware NMS: shift each class into its own coordinate range so
+        // boxes of different classes never suppress each other.
+        int stride = std::max(frameSize.width, frameSize.height) + 1;
+        shiftedBoxes.assign(boxes.begin(), boxes.end());
+        for (size_t i = 0; i < shiftedBoxes.size(); ++i) shiftedBoxes[i].x += classIds[i] * stride;
+        cv::dnn::NMSBoxes(shiftedBoxes, scores, config.confidenceThreshold, config.nmsThreshold, keep);
+
+        result.first.clear();
+        result.second.clear();
+        for (int idx : keep) {
+            DetectionResult detection;
+            bool isMarine = false;
+            if (classIds[idx] < static_cast<int>(classes.size())) {
+                detection.label = classes[classIds[idx]].label;
+                isMarine = classes[classIds[idx]].isMarine;
+            } else {
+                detection.label = "class " + std::to_string(classIds[idx]);
+            }
+            detection.confidence = scores[idx] * 100.0f;
+            detection.size = config.cmPerPixel * std::max(boxes[idx].width, boxes[idx].height);
+            detection.timestamp = timestamp;
+            detection.box = boxes[idx];
+            (isMarine ? result.first : result.second).push_back(std::move(detection));
+        }
+    }
+
+public:
+    bool load(const InferenceConfig& cfg) {
+        std::lock_guard<std::mutex> lock(netMutex);
+        config = cfg;
+        try {
+            net = cv::dnn::readNet(config.modelPath, config.configPath);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Failed to load model " << config.modelPath << ": " << e.what() << std::endl;
+            return false;
+        }
+        if (net.empty()) return false;
+
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        if (config.threads > 0) cv::setNumThreads(config.threads);
+        outputNames = net.getUnconnectedOutLayersNames();
+        if (!config.classNamesPath.empty()) loadClassNames(config.classNamesPath);
+        return true;
+    }
+
+    bool isLoaded() const { return !net.empty(); }
+
+    // Change the network input size between batches (e.g. to save power).
+    void setInputSize(int width, int height) {
+        std::lock_guard<std::mutex> lock(netMutex);
+        config.inputWidth = width;
+        config.inputHeight = height;
+    }
+
+    const InferenceConfig& getConfig() const { return config; }
+
+    // One forward pass over all frames. `results` is resized to match.
+    void detectBatch(const std::vector<cv::Mat>& frames, std::vector<DetectionPair>& results) {
+        results.resize(frames.size());
+        if (frames.empty()) return;
+
+        std::lock_guard<std::mutex> lock(netMutex);
+        auto started = std::chrono::steady_clock::now();
+        time_t timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+        cv::dnn::blobFromImages(frames, inputBlob, config.pixelScale,
+                                cv::Size(config.inputWidth, config.inputHeight), cv::Scalar(), config.swapRB,
+                                false, CV_32F);
+        net.setInput(inputBlob);
+        net.forward(outputs, outputNames);
+
+        int batchSize = static_cast<int>(frames.size());
+        for (int i = 0; i < batchSize; ++i) {
+            postprocess(i, batchSize, frames[i].size(), timestamp, results[i]);
+        }
+
+        stats.record(frames.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    }
+
+    InferenceStats getStats() {
+        std::lock_guard<std::mutex> lock(netMutex);
+        return stats;
+    }
+};
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "detection_types.hpp"
+
+// Fixed-capacity deque of (sequence, value) pairs kept monotonic so the
+// front is always the window's min (Less) or max (Greater). Each sample is
+// pushed and popped at most once, so updates are amortised O(1).
+template <typename Compare>
+class MonotonicWindow {
+private:
+    struct Entry {
+        uint64_t sequence;
+        float value;
+    };
+
+    std::vector<Entry> ring;
+    size_t head = 0;
+    size_t count = 0;
+    Compare better;
+
+    Entry& at(size_t i) { return ring[(head + i) % ring.size()]; }
+
+public:
+    explicit MonotonicWindow(size_t capacity) : ring(std::max<size_t>(capacity, 1)) {}
+
+    void push(uint64_t sequence, float value, uint64_t oldestInWindow) {
+        while (count > 0 && at(0).sequence < oldestInWindow) {
+            head = (head + 1) % ring.size();
+            --count;
+        }
+        while (count > 0 && !better(at(count - 1).value, value)) --count;
+        at(count) = {sequence, value};
+        ++count;
+    }
+
+    float front() const { return count ? ring[head].value : std::numeric_limits<float>::quiet_NaN(); }
+};
+
+struct ChannelSummary {
+    uint64_t samples = 0;
+    float last = 0.0f;
+    float mean = 0.0f;
+    float stddev = 0.0f;
+    float min = 0.0f;
+    float max = 0.0f;
+    float p50 = 0.0f;
+    float p90 = 0.0f;
+    float p99 = 0.0f;
+    float ewma = 0.0f;
+    float zScore = 0.0f; // of the last sample against the EWMA before it
+};
+
+struct ChannelConfig {
+    size_t window = 288;   // samples; a day of 5-minute readings
+    float rangeLow = 0.0f; // quantile histogram range; samples outside are clamped
+    float rangeHigh = 100.0f;
+    size_t bins = 128;
+    float ewmaAlpha = 0.05f;
+};
+
+// Rolling statistics over the last `window` samples of one sensor channel,
+// in constant memory and constant time per sample: Welford mean/variance
+// with removal, monotonic min/max windows, and a fixed-bin histogram for
+// approximate quantiles (accurate to one bin width). The EWMA mean and
+// variance behind the anomaly z-score cover the whole history.
+class RollingChannelStats {
+private:
+    ChannelConfig config;
+    std::vector<float> values;
+    std::vector<uint32_t> histogram;
+    uint64_t total = 0;
+    size_t filled = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    MonotonicWindow<std::less<float>> minWindow;
+    MonotonicWindow<std::greater<float>> maxWindow;
+    double ewmaMean = 0.0;
+    double ewmaVariance = 0.0;
+    float lastValue = 0.0f;
+    float lastZ = 0.0f;
+
+    size_t binOf(float value) const {
+        float position = (value - config.rangeLow) / (config.rangeHigh - config.rangeLow) * config.bins;
+        if (!(position > 0.0f)) return 0;
+        return std::min(config.bins - 1, static_cast<size_t>(position));
+    }
+
+public:
+    explicit RollingChannelStats(const ChannelConfig& cfg = ChannelConfig())
+        : config(cfg), values(std::max<size_t>(cfg.window, 1)), histogram(std::max<size_t>(cfg.bins, 1)),
+          minWindow(cfg.window), maxWindow(cfg.window) {
+        config.window = values.size();
+        config.bins = histogram.size();
+    }
+
+    void add(float value) {
+        size_t slot = total % config.window;
+        if (filled < config.window) {
+            ++filled;
+            double delta = value - mean;
+            mean += delta / filled;
+            m2 += delta * (value - mean);
+        } else {
+            float evicted = values[slot];
+            double newMean = mean + (static_cast<double>(value) - evicted) / filled;
+            m2 += (static_cast<double>(value) - evicted) * (value - newMean + evicted - mean);
+            mean = newMean;
+            --histogram[binOf(evicted)];
+        }
+        m2 = std::max(m2, 0.0);
+        values[slot] = value;
+        ++histogram[binOf(value)];
+
+        uint64_t oldest = total + 1 > config.window ? total + 1 - config.window : 0;
+        minWindow.push(total, value, oldest);
+        maxWindow.push(total, value, oldest);
+
+        if (total == 0) {
+            ewmaMean = value;
+            lastZ = 0.0f;
+        } else {
+            double deviation = std::sqrt(ewmaVariance);
+            lastZ = deviation > 1e-9 ? static_cast<float>((value - ewmaMean) / deviation) : 0.0f;
+            double diff = value - ewmaMean;
+            double increment = config.ewmaAlpha * diff;
+            ewmaMean += increment;
+            ewmaVariance = (1.0 - config.ewmaAlpha) * (ewmaVariance + diff * increment);
+        }
+        lastValue = value;
+        ++total;
+    }
+
+    uint64_t samples() const { return total; }
+    float last() const { return lastValue; }
+    float windowMean() const { return static_cast<float>(mean); }
+    float variance() const { return filled > 1 ? static_cast<float>(m2 / (filled - 1)) : 0.0f; }
+    float zScore() const { return lastZ; }
+
+    // O(bins); meant for reporting, not per sample.
+    float quantile(float q) const {
+        if (filled == 0) return 0.0f;
+        double target = q * filled;
+        double seen = 0.0;
+        float width = (config.rangeHigh - config.rangeLow) / config.bins;
+        for (size_t i = 0; i < config.bins; ++i) {
+            if (histogram[i] == 0) continue;
+            if (seen + histogram[i] >= target) {
+                double within = (target - seen) / histogram[i];
+                return config.rangeLow + width * static_cast<float>(i + within);
+            }
+            seen += histogram[i];
+        }
+        return config.rangeHigh;
+    }
+
+    ChannelSummary summary() const {
+        ChannelSummary s;
+        s.samples = total;
+        s.last = lastValue;
+        s.mean = windowMean();
+        s.stddev = std::sqrt(variance());
+        s.min = minWindow.front();
+        s.max = maxWindow.front();
+        // Bin interpolation can overshoot the exact window extremes.
+        auto bounded = [&s](float q) { return std::min(s.max, std::max(s.min, q)); };
+        s.p50 = bounded(quantile(0.50f));
+        s.p90 = bounded(quantile(0.90f));
+        s.p99 = bounded(quantile(0.99f));
+        s.ewma = static_cast<float>(ewmaMean);
+        s.zScore = lastZ;
+        return s;
+    }
+};
+
+enum class EnvChannel { Temperature, Turbidity, PH, Salinity };
+constexpr size_t kEnvChannelCount = 4;
+
+inline const char* envChannelName(EnvChannel channel) {
+    switch (channel) {
+    case EnvChannel::Temperature: return "temperature";
+    case EnvChannel::Turbidity: return "turbidity";
+    case EnvChannel::PH: return "ph";
+    default: return "salinity";
+    }
+}
+
+// One configurable alert. `metric` picks what is compared with `threshold`:
+// the raw sample, the rolling-window mean, or the absolute EWMA z-score.
+struct AnomalyRule {
+    enum class Metric { Sample, Mean, ZScore };
+    enum class Op { Below, Above };
+
+    EnvChannel channel;
+    Metric metric;
+    Op op;
+    float threshold;
+    uint64_t minSamples = 1; // stay quiet until the statistics have warmed up
+    std::string message;
+};
+
+struct EnvAlert {
+    const AnomalyRule* rule;
+    float value;
+};
+
+// The pH and turbidity limits run() used to hard-code, plus a z-score
+// check on every channel.
+inline std::vector<AnomalyRule> defaultAnomalyRules() {
+    using M = AnomalyRule::Metric;
+    using O = AnomalyRule::Op;
+    std::vector<AnomalyRule> rules = {
+        {EnvChannel::PH, M::Sample, O::Below, 6.5f, 1, "Critical pH level detected!"},
+        {EnvChannel::PH, M::Sample, O::Above, 8.5f, 1, "Critical pH level detected!"},
+        {EnvChannel::Turbidity, M::Sample, O::Above, 50.0f, 1, "High turbidity detected!"},
+    };
+    for (EnvChannel channel : {EnvChannel::Temperature, EnvChannel::Turbidity, EnvChannel::PH, EnvChannel::Salinity}) {
+        rules.push_back({channel, M::ZScore, O::Above, 4.0f, 30, std::string("Unusual ") + envChannelName(channel) +
+                                                                    " reading"});
+    }
+    return rules;
+}
+
+// Rules file, one rule per line:
+//   <channel> <sample|mean|zscore> <below|above> <threshold> [min=<samples>] <message...>
+// e.g. "turbidity mean above 40 min=12 Sustained high turbidity". Blank
+// lines and lines starting with '#' are ignored.
+inline bool loadAnomalyRules(const std::string& path, std::vector<AnomalyRule>& rules, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::vector<AnomalyRule> parsed;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        std::istringstream in(line);
+        std::string channel, metric, op;
+        AnomalyRule rule{};
+        if (!(in >> channel >> metric >> op >> rule.threshold)) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected <channel> <metric> <op> <threshold>";
+            return false;
+        }
+
+        bool known = true;
+        if (channel == "temperature") rule.channel = EnvChannel::Temperature;
+        else if (channel == "turbidity") rule.channel = EnvChannel::Turbidity;
+        else if (channel == "ph") rule.channel = EnvChannel::PH;
+        else if (channel == "salinity") rule.channel = EnvChannel::Salinity;
+        else known = false;
+
+        if (metric == "sample") rule.metric = AnomalyRule::Metric::Sample;
+        else if (metric == "mean") rule.metric = AnomalyRule::Metric::Mean;
+        else if (metric == "zscore") rule.metric = AnomalyRule::Metric::ZScore;
+        else known = false;
+
+        if (op == "below") rule.op = AnomalyRule::Op::Below;
+        else if (op == "above") rule.op = AnomalyRule::Op::Above;
+        else known = false;
+
+        if (!known) {
+            error = path + ":" + std::to_string(lineNumber) + ": unknown channel, metric or op";
+            return false;
+        }
+
+        rule.minSamples = rule.metric == AnomalyRule::Metric::Sample ? 1 : 30;
+        std::string word;
+        std::string message;
+        while (in >> word) {
+            if (message.empty() && word.rfind("min=", 0) == 0) {
+                const char* end = word.data() + word.size();
+                auto result = std::from_chars(word.data() + 4, end, rule.minSamples);
+                if (result.ec != std::errc() || result.ptr != end) {
+                    error = path + ":" + std::to_string(lineNumber) + ": bad " + word;
+                    return false;
+                }
+                continue;
+            }
+            message += (message.empty() ? "" : " ") + word;
+        }
+        rule.message = message.empty() ? channel + " " + metric + " " + op + " threshold" : message;
+        parsed.push_back(std::move(rule));
+    }
+
+    rules = std::move(parsed);
+    return true;
+}
+
+// Rolling statistics for every EnvironmentalData channel plus the rules
+// evaluated against them on each reading.
+class EnvironmentalAnalytics {
+private:
+    std::array<RollingChannelStats, kEnvChannelCount> channels;
+    std::vector<AnomalyRule> rules;
+
+    static float channelValue(const EnvironmentalData& data, EnvChannel channel) {
+        switch (channel) {
+        case EnvChannel::Temperature: return data.temperature;
+        case EnvChannel::Turbidity: return data.turbidity;
+        case EnvChannel::PH: return data.pH;
+        default: return data.salinity;
+        }
+    }
+
+    static ChannelConfig rangeFor(float low, float high) {
+        ChannelConfig config;
+        config.rangeLow = low;
+        config.rangeHigh = high;
+        return config;
+    }
+
+public:
+    EnvironmentalAnalytics()
+        : channels{RollingChannelStats(rangeFor(-5.0f, 45.0f)), RollingChannelStats(rangeFor(0.0f, 200.0f)),
+                   RollingChannelStats(rangeFor(0.0f, 14.0f)), RollingChannelStats(rangeFor(0.0f, 45.0f))},
+          rules(defaultAnomalyRules()) {}
+
+    void setRules(std::vector<AnomalyRule> newRules) { rules = std::move(newRules); }
+    const std::vector<AnomalyRule>& getRules() const { return rules; }
+
+    // O(channels + rules) per reading. Alerts for this reading are
+    // appended to `alerts`.
+    void update(const EnvironmentalData& data, std::vector<EnvAlert>& alerts) {
+        for (size_t i = 0; i < kEnvChannelCount; ++i) {
+            channels[i].add(channelValue(data, static_cast<EnvChannel>(i)));
+        }
+
+        for (const AnomalyRule& rule : rules) {
+            const RollingChannelStats& stats = channels[static_cast<size_t>(rule.channel)];
+            if (stats.samples() < rule.minSamples) continue;
+
+            float value;
+            switch (rule.metric) {
+            case AnomalyRule::Metric::Sample: value = stats.last(); break;
+            case AnomalyRule::Metric::Mean: value = stats.windowMean(); break;
+            default: value = std::fabs(stats.zScore()); break;
+            }
+            bool triggered = rule.op == AnomalyRule::Op::Below ? value < rule.threshold : value > rule.threshold;
+            if (triggered) alerts.push_back({&rule, value});
+        }
+    }
+
+    const RollingChannelStats& channel(EnvChannel which) const { return channels[static_cast<size_t>(which)]; }
+};
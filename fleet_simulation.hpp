@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "columnar_dataset.hpp"
+#include "work_stealing_pool.hpp"
+
+// Per-buoy parameters. The defaults match FloatingAquaticMonitor's
+// hardware: a 0.75 m2 panel at 20%, a 500 Wh battery charging at up to
+// 100 W, a 15 W camera+processing load for 3 minutes per detection, a 2 W
+// sensor read for 36 seconds and a 150 W conveyor run of 2 seconds.
+struct FleetConfig {
+    size_t buoys = 1000;
+    float panelEfficiency = 0.20f;
+    float panelArea = 0.75f;
+    float batteryCapacityWh = 500.0f;
+    float maxChargeRateW = 100.0f;
+    float initialChargeFraction = 0.7f;
+
+    float stepHours = 1.0f / 12.0f;          // solar/battery integration step
+    float detectionIntervalHours = 1.0f / 6.0f;
+    float envReadIntervalHours = 1.0f / 12.0f;
+    float detectionEnergyWh = 15.0f * 0.05f;
+    float sensorEnergyWh = 2.0f * 0.01f;
+    float conveyorEnergyWh = 150.0f * 2.0f / 3600.0f;
+    float shutdownFraction = 0.05f;          // below this a buoy stops detecting
+    float conveyorMinFraction = 0.20f;       // below this waste is logged, not collected
+
+    float longitudeSpreadHours = 6.0f;       // buoys spread over this many time zones
+    size_t blockSize = 256;                  // buoys per kernel task
+    size_t eventBatch = 64;                  // due events per event task
+    uint32_t seed = 42;
+};
+
+struct FleetStats {
+    size_t buoys = 0;
+    double simulatedHours = 0.0;
+    uint64_t steps = 0;
+    uint64_t detections = 0;
+    uint64_t marineSightings = 0;
+    uint64_t wasteDetected = 0;
+    uint64_t wasteCollected = 0;
+    uint64_t envReadings = 0;
+    uint64_t phAlarms = 0;
+    uint64_t turbidityAlarms = 0;
+    uint64_t skippedEvents = 0; // buoy below shutdown level or out of energy
+    double energyHarvestedWh = 0.0;
+    double energyUsedWh = 0.0;
+    size_t buoysDown = 0;       // below shutdown level at the end
+    float minChargePercent = 0.0f;
+    float meanChargePercent = 0.0f;
+    uint64_t tasks = 0;
+    uint64_t steals = 0;
+    double wallSeconds = 0.0;
+
+    double buoyHoursPerSecond() const { return wallSeconds > 0 ? buoys * simulatedHours / wallSeconds : 0.0; }
+};
+
+// Thousands of buoys in one process. Solar and battery state lives in
+// packed per-field arrays and is advanced a block at a time by branch-free
+// loops the compiler can vectorise; detections and sensor reads that fall
+// due in a step become tasks on a work-stealing pool. Detections replay
+// rows of the shared (read-only) datasets when given, otherwise a seeded
+// synthetic model is used.
+class FleetSimulation {
+private:
+    FleetConfig config;
+    const WasteColumns* waste;
+    const MarineColumns* marine;
+
+    // Solar / battery state, one element per buoy.
+    std::vector<float> panelScale;     // area * efficiency
+    std::vector<float> hourOffset;     // local solar time offset
+    std::vector<float> output;         // W
+    std::vector<float> charge;         // Wh
+    std::vector<float> capacity;       // Wh
+    std::vector<float> maxRate;        // W
+    std::vector<float> gained;         // Wh stored in the last step
+
+    // Event state.
+    std::vector<float> nextDetection;  // simulated hours
+    std::vector<float> nextEnvRead;
+    std::vector<uint32_t> rngState;
+    std::vector<uint32_t> cursor;
+
+    // Per-worker accumulators, padded so workers never share a line.
+    struct alignas(64) WorkerTotals {
+        uint64_t detections = 0, marineSightings = 0, wasteDetected = 0, wasteCollected = 0;
+        uint64_t envReadings = 0, phAlarms = 0, turbidityAlarms = 0, skippedEvents = 0;
+        double harvestedWh = 0.0, usedWh = 0.0;
+    };
+    std::vector<WorkerTotals> totals;
+
+    double hoursElapsed = 0.0;
+    uint64_t stepsRun = 0;
+
+    static uint32_t nextRandom(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    static float unitRandom(uint32_t& state) { return (nextRandom(state) >> 8) * (1.0f / 16777216.0f); }
+
+    // Same sun model as SolarPanel::updateAt: daylight 06:00-18:00, 500 W/m2
+    // at the edges rising to 800 W/m2 at noon.
+    void solarKernel(size_t begin, size_t end, float hourOfDay) {
+        const float* scale = panelScale.data();
+        const float* offset = hourOffset.data();
+        float* out = output.data();
+        for (size_t i = begin; i < end; ++i) {
+            float local = hourOfDay + offset[i];
+            local -= 24.0f * std::floor(local * (1.0f / 24.0f));
+            float day = (local >= 6.0f && local < 18.0f) ? 1.0f : 0.0f;
+            float intensity = 500.0f + 300.0f * std::sin((local - 6.0f) * (3.14159265f / 12.0f));
+            out[i] = day * intensity * scale[i];
+        }
+    }
+
+    // Returns the energy actually stored across the block. The update loop
+    // has no reduction in it so it vectorises without -ffast-math.
+    double batteryKernel(size_t begin, size_t end, float hours) {
+        const float* out = output.data();
+        const float* cap = capacity.data();
+        const float* rate = maxRate.data();
+        float* level = charge.data();
+        float* delta = gained.data();
+        for (size_t i = begin; i < end; ++i) {
+            float after = std::min(cap[i], level[i] + std::min(out[i], rate[i]) * hours);
+            delta[i] = after - level[i];
+            level[i] = after;
+        }
+        double harvested = 0.0;
+        for (size_t i = begin; i < end; ++i) harvested += delta[i];
+        return harvested;
+    }
+
+    bool drawEnergy(size_t buoy, float wh, WorkerTotals& t) {
+        if (charge[buoy] < wh) return false;
+        charge[buoy] -= wh;
+        t.usedWh += wh;
+        return true;
+    }
+
+    void detectionEvent(size_t buoy, WorkerTotals& t) {
+        if (charge[buoy] < config.shutdownFraction * capacity[buoy] || !drawEnergy(buoy, config.detectionEnergyWh, t)) {
+            ++t.skippedEvents;
+            return;
+        }
+        ++t.detections;
+
+        bool isMarine = nextRandom(rngState[buoy]) & 1;
+        size_t rows = isMarine ? (marine ? marine->rowCount() : 0) : (waste ? waste->rowCount() : 0);
+        bool found;
+        if (rows > 0) {
+            // Each buoy walks the shared dataset from its own starting row.
+            size_t row = cursor[buoy]++ % rows;
+            float confidence = isMarine ? marine->confidence[row] : waste->confidence[row];
+            found = confidence > 0.0f;
+        } else {
+            found = unitRandom(rngState[buoy]) < 0.6f;
+        }
+        if (!found) return;
+
+        if (isMarine) {
+            ++t.marineSightings;
+            return;
+        }
+        ++t.wasteDetected;
+        if (charge[buoy] > config.conveyorMinFraction * capacity[buoy] && drawEnergy(buoy, config.conveyorEnergyWh, t)) {
+            ++t.wasteCollected;
+        }
+    }
+
+    void envEvent(size_t buoy, WorkerTotals& t) {
+        if (charge[buoy] < config.shutdownFraction * capacity[buoy] || !drawEnergy(buoy, config.sensorEnergyWh, t)) {
+            ++t.skippedEvents;
+            return;
+        }
+        ++t.envReadings;
+
+        float pH, turbidity;
+        if (waste && waste->rowCount() > 0) {
+            size_t row = (cursor[buoy] * 7919u) % waste->rowCount();
+            pH = waste->pH[row];
+            turbidity = waste->turbidity[row];
+        } else {
+            pH = 6.2f + 2.6f * unitRandom(rngState[buoy]);
+            turbidity = 60.0f * unitRandom(rngState[buoy]);
+        }
+        if (pH < 6.5f || pH > 8.5f) ++t.phAlarms;
+        if (turbidity > 50.0f) ++t.turbidityAlarms;
+    }
+
+    // Fire every event due at `now` for buoys in [begin, end), pushing
+    // batches of due buoys back onto the pool so busy blocks get shared.
+    void runEvents(WorkStealingPool& pool, size_t begin, size_t end, float now) {
+        std::vector<uint32_t> due;
+        for (size_t i = begin; i < end; ++i) {
+            if (nextDetection[i] <= now || nextEnvRead[i] <= now) due.push_back(static_cast<uint32_t>(i));
+        }
+
+        for (size_t first = 0; first < due.size(); first += config.eventBatch) {
+            size_t last = std::min(due.size(), first + config.eventBatch);
+            std::vector<uint32_t> batch(due.begin() + first, due.begin() + last);
+            pool.submit([this, &pool, batch = std::move(batch), now]() {
+                WorkerTotals& t = totals[pool.currentWorker()];
+                for (uint32_t buoy : batch) {
+                    if (nextEnvRead[buoy] <= now) {
+                        envEvent(buoy, t);
+                        nextEnvRead[buoy] += config.envReadIntervalHours;
+                    }
+                    if (nextDetection[buoy] <= now) {
+                        detectionEvent(buoy, t);
+                        nextDetection[buoy] += config.detectionIntervalHours;
+                    }
+                }
+            });
+        }
+    }
+
+public:
+    explicit FleetSimulation(const FleetConfig& cfg, const WasteColumns* wasteData = nullptr,
+                             const MarineColumns* marineData = nullptr)
+        : config(cfg), waste(wasteData), marine(marineData) {
+        size_t n = config.buoys;
+        panelScale.assign(n, config.panelArea * config.panelEfficiency);
+        hourOffset.resize(n);
+        output.assign(n, 0.0f);
+        capacity.assign(n, config.batteryCapacityWh);
+        charge.assign(n, config.batteryCapacityWh * config.initialChargeFraction);
+        maxRate.assign(n, config.maxChargeRateW);
+        gained.assign(n, 0.0f);
+        nextDetection.resize(n);
+        nextEnvRead.resize(n);
+        rngState.resize(n);
+        cursor.resize(n);
+
+        uint32_t seed = config.seed ? config.seed : 1;
+        for (size_t i = 0; i < n; ++i) {
+            rngState[i] = seed + static_cast<uint32_t>(i) * 2654435761u;
+            if (rngState[i] == 0) rngState[i] = 1;
+            hourOffset[i] = config.longitudeSpreadHours * unitRandom(rngState[i]);
+            // Stagger first events so the fleet does not fire in lockstep.
+            nextDetection[i] = config.detectionIntervalHours * unitRandom(rngState[i]);
+            nextEnvRead[i] = config.envReadIntervalHours * unitRandom(rngState[i]);
+            cursor[i] = nextRandom(rngState[i]);
+        }
+    }
+
+    // Advance the whole fleet by `hours`, starting at local hour `startHour`
+    // of the first day.
+    FleetStats run(WorkStealingPool& pool, float hours, float startHour = 6.0f) {
+        totals.assign(pool.threadCount() + 1, WorkerTotals());
+        auto wallStart = std::chrono::steady_clock::now();
+
+        size_t n = config.buoys;
+        size_t block = std::max<size_t>(config.blockSize, 1);
+        size_t steps = static_cast<size_t>(std::ceil(hours / config.stepHours));
+
+        for (size_t step = 0; step < steps; ++step) {
+            float now = static_cast<float>(hoursElapsed);
+            float dt = std::min(config.stepHours, hours - step * config.stepHours);
+            float hourOfDay = std::fmod(startHour + now, 24.0f);
+
+            pool.parallelFor(n, block, [&](size_t begin, size_t end) {
+                solarKernel(begin, end, hourOfDay);
+                double harvested = batteryKernel(begin, end, dt);
+                totals[pool.currentWorker()].harvestedWh += harvested;
+                runEvents(pool, begin, end, now);
+            });
+
+            hoursElapsed += dt;
+            ++stepsRun;
+        }
+
+        FleetStats stats;
+        stats.buoys = n;
+        stats.simulatedHours = hours;
+        stats.steps = steps;
+        for (const auto& t : totals) {
+            stats.detections += t.detections;
+            stats.marineSightings += t.marineSightings;
+            stats.wasteDetected += t.wasteDetected;
+            stats.wasteCollected += t.wasteCollected;
+            stats.envReadings += t.envReadings;
+            stats.phAlarms += t.phAlarms;
+            stats.turbidityAlarms += t.turbidityAlarms;
+            stats.skippedEvents += t.skippedEvents;
+            stats.energyHarvestedWh += t.harvestedWh;
+            stats.energyUsedWh += t.usedWh;
+        }
+
+        double chargeSum = 0.0;
+        float minPercent = n ? std::numeric_limits<float>::max() : 0.0f;
+        for (size_t i = 0; i < n; ++i) {
+            float percent = charge[i] / capacity[i] * 100.0f;
+            chargeSum += percent;
+            minPercent = std::min(minPercent, percent);
+            if (charge[i] < config.shutdownFraction * capacity[i]) ++stats.buoysDown;
+        }
+        stats.minChargePercent = minPercent;
+        stats.meanChargePercent = n ? static_cast<float>(chargeSum / n) : 0.0f;
+        stats.tasks = pool.executedCount();
+        stats.steals = pool.stealCount();
+        stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        return stats;
+    }
+
+    double getSimulatedHours() const { return hoursElapsed; }
+};
@@ -0,0 +1,1358 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "aquatic_detector.hpp"
+#include "async_logger.hpp"
+#include "camera_streams.hpp"
+#include "conveyor_belt.hpp"
+#include "dataset_ingest.hpp"
+#include "detection_types.hpp"
+#include "env_stats.hpp"
+#include "frame_archive.hpp"
+#include "log_format.hpp"
+#include "metrics.hpp"
+#include "monitor_trace.hpp"
+#include "motion_gate.hpp"
+#include "object_tracker.hpp"
+#include "pipeline.hpp"
+#include "power_scheduler.hpp"
+#include "power_system.hpp"
+#include "sim_clock.hpp"
+#include "timeseries_store.hpp"
+
+// Cameras, queue sizes, batching and overflow behaviour of the monitor's
+// pipeline stages.
+struct PipelineConfig {
+    std::vector<CameraConfig> cameras{{"camera", CameraFeed::Either}}; // one capture thread each
+    size_t captureQueueCapacity = 4; // raised to two batches if smaller
+    size_t actionQueueCapacity = 16;
+    OverflowPolicy captureOverflow = OverflowPolicy::DropOldest; // stale frames are worthless
+    OverflowPolicy actionOverflow = OverflowPolicy::Block;       // never lose a detection
+    unsigned detectWorkers = 1;
+    size_t maxBatch = 0;                         // frames per detector call; 0 means one per camera
+    std::chrono::milliseconds batchDeadline{50}; // longest the first frame of a batch waits for the rest
+    MotionGateConfig motionGate;                 // per-camera pre-filter; off by default
+    TrackerConfig tracking;                      // per-camera object tracks; off by default
+};
+
+// Receives one frame's detections from a camera, on the action stage's thread.
+using DetectionConsumer = std::function<void(const DetectionPair&)>;
+
+class FloatingAquaticMonitor {
+private:
+    AsyncLogger logger; // first in, last out: other members' threads log through it
+    SolarPanel solarPanel;
+    Battery battery;
+    AquaticDetector detector;
+    ConveyorBelt conveyor;
+    std::atomic<bool> isRunning;
+    std::atomic<float> detectionInterval; // hours; set by the scheduler unless fixed
+
+    // capture -> detect -> act, each stage on its own thread(s)
+    struct CapturedFrame {
+        cv::Mat frame;
+        bool isMarine = false;
+        size_t camera = 0; // index into cameras
+        std::chrono::steady_clock::time_point capturedAt;
+        cv::Rect region;          // the part of `frame` the detector sees; empty for all of it
+        uint64_t sequence = 0;    // the camera's capture count, for traces
+        bool runDetector = true;  // false: the tracker predicts this frame instead
+    };
+
+    struct FrameDetections {
+        DetectionPair detections;
+        bool detected = true; // false: predicted by the tracker
+        cv::Mat frame;        // the camera image, kept only for the archive
+        size_t camera = 0;
+        std::chrono::steady_clock::time_point capturedAt;
+    };
+
+    // Buffers for detectBatchOnce(), one per detect worker (and one for the
+    // simulation cycle), kept between calls so a batch reuses the previous
+    // one's storage instead of allocating.
+    struct DetectScratch {
+        std::vector<cv::Mat> frames;
+        std::vector<DetectionPair> detections; // swapped with the results', so both keep their capacity
+    };
+
+    // One per configured camera, rebuilt by setPipelineConfig().
+    struct CameraStream {
+        CameraConfig config;
+        size_t index = 0;
+        Clock::time_point lastCapture; // guarded by statusMutex
+        std::atomic<uint64_t> frames{0};
+        std::vector<DetectionConsumer> consumers;
+        MotionGate motionGate; // capture thread only
+        uint64_t trackedFrames = 0; // capture thread only
+        ObjectTracker tracker; // action stage only
+
+    };
+
+    PipelineConfig pipelineConfig;
+    std::unique_ptr<BoundedQueue<CapturedFrame>> captureQueue;
+    std::unique_ptr<BoundedQueue<FrameDetections>> actionQueue;
+    PipelineStage captureStage{"capture"};
+    PipelineStage detectStage{"detect"};
+    PipelineStage actionStage{"action"};
+    StageStats endToEndStats;
+    std::vector<std::unique_ptr<CameraStream>> cameras;
+    std::atomic<uint64_t> detectCalls{0};
+    std::vector<CapturedFrame> cycleFrames;     // simulation scratch
+    std::vector<FrameDetections> cycleResults;
+    DetectScratch cycleScratch;
+    DetectionPair newObjects; // action stage scratch: detections that started a track
+
+    // Written by the pipeline stages, read by the control loop.
+    InstrumentedMutex statusMutex;
+    std::chrono::system_clock::time_point lastDetectionTime;
+    DetectionResult lastMarineDetection; // the first of the latest frame's, if any
+    DetectionResult lastWasteDetection;
+    bool haveMarineDetection = false;
+    bool haveWasteDetection = false;
+    SimulationStats simulationStats;
+    PowerScheduler scheduler;
+    PowerPlan currentPlan;
+    bool adaptiveScheduling = true;
+    bool havePlan = false;
+    uint64_t detectionsRun = 0;
+    uint64_t usefulDetections = 0; // frames with at least one detection
+    double motionSavedWh = 0.0;    // processing energy not spent on frames the motion gate skipped
+
+    // Environment readings and detections, appended by the control loop
+    // and the action stage; internally synchronised.
+    TimeSeriesStore history;
+
+    // Control loop only.
+    EnvironmentalAnalytics envAnalytics;
+    std::vector<EnvAlert> envAlerts; // reused per reading
+
+    // Applied by the scheduler, read by the pipeline stages.
+    std::atomic<float> resolutionScale{1.0f};
+    std::atomic<bool> conveyorEnabled{true};
+
+    // Streams rows appended to the dataset CSVs into the detector; null
+    // unless followDatasets() was called.
+    std::unique_ptr<DatasetIngester> ingester;
+
+    // Encodes frames with new detections to disk on its own threads; null
+    // unless archiveFrames() was called.
+    std::unique_ptr<FrameArchive> archive;
+
+    // Inputs of the run written to, or read back from, a trace. The reader
+    // is only used in simulation, on the driver thread.
+    std::unique_ptr<TraceWriter> traceWriter;
+    std::unique_ptr<TraceReader> traceReader;
+    std::string tracePath; // opened by beginRun()
+    uint32_t traceSeed = 0;
+
+    // Wall clock by default; simulate() swaps in a VirtualClock before run().
+    std::unique_ptr<Clock> clock;
+    float simulationHours = 0.0f; // 0 runs until stopped
+
+    // Latency histograms; all null (and skipped) until enableMetrics().
+    struct StageLatencies {
+        LatencyHistogram* iteration = nullptr; // control loop work, excluding the sleep
+        LatencyHistogram* power = nullptr;
+        LatencyHistogram* replan = nullptr;
+        LatencyHistogram* environment = nullptr;
+        LatencyHistogram* status = nullptr;
+        LatencyHistogram* conveyor = nullptr;
+        LatencyHistogram* capture = nullptr;
+        LatencyHistogram* motion = nullptr;
+        LatencyHistogram* track = nullptr;
+        LatencyHistogram* detect = nullptr;
+        LatencyHistogram* action = nullptr;
+        LatencyHistogram* log = nullptr;
+    };
+    MetricsRegistry metrics;
+    StageLatencies latency;
+    std::string metricsPath;
+    std::chrono::steady_clock::duration metricsInterval{};
+    std::chrono::steady_clock::time_point lastMetricsWrite;
+
+    // Control loop state, carried between runIteration() calls.
+    struct RunState {
+        Clock::time_point startTime;
+        Clock::time_point endTime;
+        std::chrono::steady_clock::time_point wallStart;
+        Clock::time_point lastPowerUpdate;
+        Clock::time_point lastEnvReadingTime;
+        Clock::time_point lastStatusTime;
+        Clock::time_point lastReplanTime;
+        EnvironmentalData lastEnvData{};
+    };
+    RunState runState;
+
+    const float CAMERA_POWER = 5.0f;
+    const float PROCESSING_POWER = 10.0f;
+    const float DETECTION_HOURS = 0.05f; // camera and processing time charged per frame
+    const float SENSOR_POWER = 2.0f;
+    const float ENV_READ_INTERVAL_HOURS = 1.0f / 12.0f;
+    const float STATUS_INTERVAL_HOURS = 0.25f;
+    const float POWER_STEP_HOURS = 1.0f / 12.0f;
+    const float REPLAN_INTERVAL_HOURS = 0.25f;
+
+    // Runs on whichever thread pumps the conveyor.
+    void logConveyorRun(const ConveyorRun& run) {
+        LogLine& message = scratchLine();
+        message << "Conveyor " << (run.interrupted ? "halted after " : "deposited ") << run.items.size()
+                << " item(s) in " << fixedFloat(run.seconds, 1) << " s, " << fixedFloat(run.energyWh, 3) << " Wh";
+        if (!run.powered) message << " (battery could not cover the run)";
+        logData(message.view());
+    }
+
+    // Sleep until the camera's detection interval has elapsed. Returns
+    // false if the monitor was stopped while waiting.
+    bool waitForNextCapture(const CameraStream& camera) {
+        while (isRunning) {
+            Clock::duration remaining;
+            {
+                std::lock_guard<InstrumentedMutex> lock(statusMutex);
+                remaining = camera.lastCapture + Clock::fromHours(detectionInterval) - clock->now();
+            }
+            if (remaining <= Clock::duration::zero()) return true;
+            std::this_thread::sleep_for(std::min<Clock::duration>(remaining, std::chrono::milliseconds(100)));
+        }
+        return false;
+    }
+
+    // Stage bodies, shared by the threaded pipeline and the inline
+    // simulation cycle.
+    bool captureOnce(CameraStream& camera, CapturedFrame& captured) {
+        ScopedLatency timer(latency.capture);
+        float scale = resolutionScale.load();
+        // Behind a motion gate or tracker, processing is only paid for in
+        // admitFrame(), once the frame is known to reach the detector.
+        bool deferred = camera.motionGate.isEnabled() || camera.tracker.isEnabled();
+        float processing = deferred ? 0.0f : PROCESSING_POWER * scale * scale;
+        if (!battery.discharge(CAMERA_POWER + processing, DETECTION_HOURS)) {
+            logData("Low battery - skipping detection cycle");
+            return false;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        captured.camera = camera.index;
+        std::string image;
+        if (traceReader) {
+            TraceFrame recorded;
+            if (!traceReader->nextFrame(static_cast<uint32_t>(camera.index), recorded)) {
+                endOfTrace();
+                return false;
+            }
+            // Detections come from the trace too, so a missing image only
+            // matters to the motion gate.
+            captured.isMarine = recorded.isMarine;
+            detector.loadFrame(recorded.image, captured.frame);
+        } else {
+            CameraFeed feed = camera.config.feed;
+            captured.isMarine = feed == CameraFeed::Either ? (rand() % 2 == 0) : feed == CameraFeed::Marine;
+            if (!detector.captureFrame(captured.frame, captured.isMarine, traceWriter ? &image : nullptr)) return false;
+        }
+        captured.capturedAt = std::chrono::steady_clock::now();
+        captureStage.getStats().record(captured.capturedAt - started);
+        captured.sequence = camera.frames.fetch_add(1, std::memory_order_relaxed);
+
+        Clock::time_point now = clock->now();
+        if (traceWriter) {
+            traceWriter->recordFrame({static_cast<uint32_t>(camera.index), captured.sequence, captured.isMarine,
+                                      std::move(image), std::chrono::system_clock::to_time_t(now)});
+        }
+        std::lock_guard<InstrumentedMutex> lock(statusMutex);
+        lastDetectionTime = now;
+        camera.lastCapture = lastDetectionTime;
+        return true;
+    }
+
+    // A replay has run out of recorded input: finish the run.
+    void endOfTrace() {
+        if (isRunning.exchange(false)) logData("End of trace - replay finished");
+    }
+
+    // Between capture and detection. Returns false if the motion gate
+    // finds nothing new (the frame is dropped and its processing energy
+    // saved) or the battery cannot cover processing. Frames between the
+    // tracker's detector frames pass without a detector run or processing
+    // charge. Otherwise charges processing and, behind a motion gate,
+    // narrows the frame to the moving region when it is small.
+    bool admitFrame(CameraStream& camera, CapturedFrame& captured) {
+        MotionGate& gate = camera.motionGate;
+        const ObjectTracker& tracker = camera.tracker;
+        if (!gate.isEnabled() && !tracker.isEnabled()) return true;
+        float scale = resolutionScale.load();
+        float processing = PROCESSING_POWER * scale * scale;
+
+        MotionDecision decision;
+        if (gate.isEnabled()) {
+            {
+                ScopedLatency timer(latency.motion);
+                decision = gate.evaluate(captured.frame);
+            }
+            if (!decision.changed) {
+                captured.frame.release();
+                std::lock_guard<InstrumentedMutex> lock(statusMutex);
+                motionSavedWh += processing * DETECTION_HOURS;
+                return false;
+            }
+        }
+        if (tracker.isEnabled() && camera.trackedFrames++ % tracker.getConfig().detectEvery != 0) {
+            captured.runDetector = false;
+            captured.frame.release();
+            return true;
+        }
+        if (!battery.discharge(processing, DETECTION_HOURS)) {
+            logData("Low battery - skipping detection cycle");
+            return false;
+        }
+        if (gate.isEnabled()) {
+            captured.region = gate.detectorRegion(captured.frame, decision);
+        }
+        return true;
+    }
+
+    // Boxes from a cropped frame, moved back into camera image pixels.
+    static void offsetBoxes(std::vector<DetectionResult>& detections, cv::Point offset) {
+        for (DetectionResult& detection : detections) {
+            if (!detection.box.empty()) detection.box += offset;
+        }
+    }
+
+    // One detector call for the whole batch (a single forward pass on the
+    // dnn backend). Each frame is charged the call's latency. Frames the
+    // tracker predicts skip the call and come out empty, in order.
+    void detectBatchOnce(std::vector<CapturedFrame>& batch, std::vector<FrameDetections>& results,
+                         DetectScratch& scratch) {
+        ScopedLatency timer(latency.detect);
+        auto started = std::chrono::steady_clock::now();
+        std::vector<cv::Mat>& frames = scratch.frames;
+        std::vector<DetectionPair>& detections = scratch.detections;
+        frames.clear();
+        for (const CapturedFrame& captured : batch) {
+            if (!captured.runDetector) continue;
+            frames.push_back(captured.region.empty() ? captured.frame : captured.frame(captured.region));
+        }
+        if (traceReader) {
+            // Recorded detections, already in camera image pixels.
+            detections.resize(frames.size());
+            size_t next = 0;
+            for (const CapturedFrame& captured : batch) {
+                if (!captured.runDetector) continue;
+                traceReader->detectionsFor(static_cast<uint32_t>(captured.camera), captured.sequence,
+                                           detections[next++]);
+            }
+        } else if (!frames.empty()) {
+            detector.detectBatch(frames, detections);
+        }
+
+        results.resize(batch.size());
+        size_t next = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            FrameDetections& result = results[i];
+            result.detected = batch[i].runDetector;
+            if (result.detected) {
+                std::swap(result.detections, detections[next++]);
+                cv::Point offset = batch[i].region.tl();
+                if (offset != cv::Point() && !traceReader) {
+                    offsetBoxes(result.detections.first, offset);
+                    offsetBoxes(result.detections.second, offset);
+                }
+                if (traceWriter) {
+                    traceWriter->recordDetections(static_cast<uint32_t>(batch[i].camera), batch[i].sequence,
+                                                  std::chrono::system_clock::to_time_t(clock->now()),
+                                                  result.detections);
+                }
+            } else {
+                result.detections.first.clear();
+                result.detections.second.clear();
+            }
+            result.camera = batch[i].camera;
+            result.capturedAt = batch[i].capturedAt;
+            if (archive) {
+                result.frame = std::move(batch[i].frame); // shares the pixels; no copy
+            } else {
+                result.frame.release();
+            }
+            batch[i].frame.release();
+        }
+        size_t detected = frames.size();
+        frames.clear(); // drop the references to the frames
+        if (detected == 0) return;
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        for (size_t i = 0; i < detected; ++i) detectStage.getStats().record(elapsed);
+        detectCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t batchLimit() const {
+        return pipelineConfig.maxBatch > 0 ? pipelineConfig.maxBatch : std::max<size_t>(1, cameras.size());
+    }
+
+    // Block for the next frame, then gather more until the batch is full
+    // or batchDeadline has passed since that first frame was captured.
+    // Returns false once the capture queue is closed and drained.
+    bool collectBatch(std::vector<CapturedFrame>& batch) {
+        batch.clear();
+        CapturedFrame captured;
+        if (!captureQueue->pop(captured)) return false;
+        auto deadline = captured.capturedAt + pipelineConfig.batchDeadline;
+        batch.push_back(std::move(captured));
+
+        size_t limit = batchLimit();
+        Backoff backoff;
+        while (batch.size() < limit && std::chrono::steady_clock::now() < deadline) {
+            if (captureQueue->tryPop(captured)) {
+                batch.push_back(std::move(captured));
+                backoff.reset();
+            } else if (captureQueue->isClosed()) {
+                break;
+            } else {
+                backoff.pause();
+            }
+        }
+        return true;
+    }
+
+    // "Waste Detected:", naming the camera when the buoy has several.
+    void logDetectionHeading(const char* what, const CameraStream& camera) {
+        LogLine& heading = scratchLine();
+        heading << what;
+        if (cameras.size() > 1) heading << " (" << camera.config.name << ")";
+        heading << ':';
+        logData(heading.view());
+    }
+
+    void actOnce(FrameDetections& item) {
+        ScopedLatency timer(latency.action);
+        auto started = std::chrono::steady_clock::now();
+        auto& [marineDetections, wasteDetections] = item.detections;
+        CameraStream& camera = *cameras[item.camera];
+
+        // With tracking, only objects seen for the first time are logged,
+        // stored and collected; the rest are already known.
+        DetectionPair* reported = &item.detections;
+        if (camera.tracker.isEnabled()) {
+            ScopedLatency trackTimer(latency.track);
+            if (item.detected) {
+                camera.tracker.update(item.detections, newObjects);
+            } else {
+                camera.tracker.predict(item.detections);
+                newObjects.first.clear();
+                newObjects.second.clear();
+            }
+            reported = &newObjects;
+        }
+        auto& [newMarine, newWaste] = *reported;
+
+        if (clock->isVirtual() || !item.detected) {
+            time_t now = std::chrono::system_clock::to_time_t(clock->now());
+            for (auto& detection : marineDetections) detection.timestamp = now;
+            for (auto& detection : wasteDetections) detection.timestamp = now;
+            for (auto& detection : newMarine) detection.timestamp = now;
+            for (auto& detection : newWaste) detection.timestamp = now;
+        }
+
+        if (!newMarine.empty()) {
+            logDetectionHeading("Marine Life Detected", camera);
+            for (const auto& detection : newMarine) {
+                LogLine& line = scratchLine();
+                line << "-> ";
+                detection.appendTo(line);
+                logData(line.view());
+            }
+        }
+
+        if (!newWaste.empty()) {
+            logDetectionHeading("Waste Detected", camera);
+            for (const auto& waste : newWaste) {
+                LogLine& line = scratchLine();
+                line << "-> ";
+                waste.appendTo(line);
+                logData(line.view());
+
+                if (!conveyorEnabled) {
+                    LogLine& message = scratchLine();
+                    message << "Power plan - conveyor off, not collecting " << waste.label;
+                    logData(message.view());
+                } else if (battery.getChargePercentage() > 20.0f) {
+                    if (!conveyor.processWaste(waste)) {
+                        LogLine& message = scratchLine();
+                        message << "Conveyor queue full - skipping " << waste.label;
+                        logData(message.view());
+                    }
+                } else {
+                    logData("Low battery - skipping waste collection");
+                }
+            }
+        }
+
+        if (marineDetections.empty() && wasteDetections.empty()) {
+            logData("No objects detected");
+        } else if (newMarine.empty() && newWaste.empty()) {
+            LogLine& line = scratchLine();
+            line << "Tracking " << marineDetections.size() + wasteDetections.size() << " known object(s)";
+            logData(line.view());
+        }
+
+        // Evidence of each new object, saved off this thread.
+        if (archive && (!newMarine.empty() || !newWaste.empty())) {
+            archive->submit(item.frame, *reported, camera.config.name,
+                            std::chrono::system_clock::to_time_t(clock->now()));
+        }
+        item.frame.release();
+
+        for (const auto& detection : newMarine) history.appendDetection(detection, true);
+        for (const auto& detection : newWaste) history.appendDetection(detection, false);
+        for (const DetectionConsumer& consumer : camera.consumers) consumer(item.detections);
+
+        {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            haveMarineDetection = !marineDetections.empty();
+            haveWasteDetection = !wasteDetections.empty();
+            if (haveMarineDetection) lastMarineDetection = marineDetections.front(); // reuses the strings' storage
+            if (haveWasteDetection) lastWasteDetection = wasteDetections.front();
+            scheduler.noteDetection(newWaste.size());
+            ++detectionsRun;
+            if (!marineDetections.empty() || !wasteDetections.empty()) ++usefulDetections;
+        }
+
+        auto finished = std::chrono::steady_clock::now();
+        actionStage.getStats().record(finished - started);
+        endToEndStats.record(finished - item.capturedAt);
+    }
+
+    void captureLoop(CameraStream& camera) {
+        while (waitForNextCapture(camera)) {
+            try {
+                CapturedFrame captured;
+                if (!captureOnce(camera, captured)) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+                if (!admitFrame(camera, captured)) continue;
+                captureQueue->push(std::move(captured), pipelineConfig.captureOverflow);
+            } catch (const std::exception& e) {
+                logData("ERROR in capture stage (" + camera.config.name + "): " + e.what());
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+    }
+
+    void detectLoop() {
+        std::vector<CapturedFrame> batch;
+        std::vector<FrameDetections> results;
+        DetectScratch scratch;
+        while (collectBatch(batch)) {
+            try {
+                detectBatchOnce(batch, results, scratch);
+                for (FrameDetections& result : results) {
+                    if (!actionQueue->push(std::move(result), pipelineConfig.actionOverflow)) return;
+                }
+            } catch (const std::exception& e) {
+                logData(std::string("ERROR in detect stage: ") + e.what());
+            }
+        }
+    }
+
+    void actionLoop() {
+        FrameDetections item;
+        while (actionQueue->pop(item)) {
+            try {
+                actOnce(item);
+            } catch (const std::exception& e) {
+                logData(std::string("ERROR in action stage: ") + e.what());
+            }
+        }
+    }
+
+    // Simulation runs the three stages back to back on the driver thread,
+    // so a detection takes no simulated time: every camera captures, all
+    // frames go through one detector call, then each is acted on. A failed
+    // capture is retried at the next interval rather than after a
+    // one-second pause; a frame the motion gate skips waits for it too.
+    void runDetectionCycle() {
+        cycleFrames.clear();
+        for (auto& camera : cameras) {
+            CapturedFrame captured;
+            if (captureOnce(*camera, captured) && admitFrame(*camera, captured)) {
+                cycleFrames.push_back(std::move(captured));
+            }
+        }
+        if (cycleFrames.empty()) {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            lastDetectionTime = clock->now();
+            return;
+        }
+        detectBatchOnce(cycleFrames, cycleResults, cycleScratch);
+        for (FrameDetections& result : cycleResults) actOnce(result);
+    }
+
+    void startPipeline() {
+        size_t captureCapacity = std::max(pipelineConfig.captureQueueCapacity, 2 * batchLimit());
+        captureQueue = std::make_unique<BoundedQueue<CapturedFrame>>(captureCapacity);
+        actionQueue = std::make_unique<BoundedQueue<FrameDetections>>(pipelineConfig.actionQueueCapacity);
+        actionStage.start(1, [this]() { actionLoop(); });
+        detectStage.start(pipelineConfig.detectWorkers, [this]() { detectLoop(); });
+        for (auto& camera : cameras) {
+            CameraStream* stream = camera.get();
+            captureStage.start(1, [this, stream]() { captureLoop(*stream); });
+        }
+    }
+
+    void buildCameras() {
+        cameras.clear();
+        std::vector<CameraConfig> configs = pipelineConfig.cameras;
+        if (configs.empty()) configs = PipelineConfig().cameras;
+        for (CameraConfig& config : configs) {
+            auto stream = std::make_unique<CameraStream>();
+            stream->config = std::move(config);
+            stream->index = cameras.size();
+            stream->motionGate.configure(pipelineConfig.motionGate);
+            TrackerConfig tracking = pipelineConfig.tracking;
+            tracking.detectEvery = std::max(1u, tracking.detectEvery);
+            stream->tracker.configure(tracking);
+            cameras.push_back(std::move(stream));
+        }
+    }
+
+    // Stop upstream first so each stage drains what is already queued.
+    void stopPipeline() {
+        if (!captureQueue) return;
+        captureStage.join();
+        captureQueue->close();
+        detectStage.join();
+        actionQueue->close();
+        actionStage.join();
+    }
+
+    static void describeStage(StatusText& out, const PipelineStage& stage) {
+        const StageStats& stats = stage.getStats();
+        out << "  " << stage.name() << ": " << stats.processedCount() << " items, " << stats.meanLatencyMs()
+            << " ms avg, " << stats.maxLatencyMs() << " ms max";
+    }
+
+    template <typename Queue>
+    static void describeQueue(StatusText& out, const Queue& queue) {
+        out << ", out queue " << queue.size() << "/" << queue.capacity() << " (high " << queue.highWaterMark()
+            << ", dropped " << queue.droppedCount() << ")";
+    }
+
+    MotionGateStats motionGateStats() const {
+        MotionGateStats total;
+        for (const auto& camera : cameras) {
+            MotionGateStats stats = camera->motionGate.getStats();
+            total.frames += stats.frames;
+            total.skipped += stats.skipped;
+            total.cropped += stats.cropped;
+            total.seconds += stats.seconds;
+        }
+        return total;
+    }
+
+    TrackerStats trackerStats() const {
+        TrackerStats total;
+        for (const auto& camera : cameras) {
+            TrackerStats stats = camera->tracker.getStats();
+            total.detectedFrames += stats.detectedFrames;
+            total.predictedFrames += stats.predictedFrames;
+            total.tracksStarted += stats.tracksStarted;
+            total.matches += stats.matches;
+            total.activeTracks += stats.activeTracks;
+            total.seconds += stats.seconds;
+        }
+        return total;
+    }
+
+    void describePipeline(StatusText& out) {
+        out << "Pipeline:\n";
+        describeStage(out, captureStage);
+        if (captureQueue) describeQueue(out, *captureQueue);
+        out << '\n';
+        describeStage(out, detectStage);
+        if (actionQueue) describeQueue(out, *actionQueue);
+        out << '\n';
+        describeStage(out, actionStage);
+        out << '\n';
+        uint64_t frames = 0;
+        out << "  cameras:";
+        for (size_t i = 0; i < cameras.size(); ++i) {
+            uint64_t cameraFrames = cameras[i]->frames.load(std::memory_order_relaxed);
+            frames += cameraFrames;
+            out << (i ? ", " : " ") << cameras[i]->config.name << ' ' << cameraFrames;
+        }
+        MotionGateStats gate = motionGateStats();
+        TrackerStats tracks = trackerStats();
+        uint64_t detected = frames - gate.skipped - tracks.predictedFrames;
+        uint64_t calls = detectCalls.load(std::memory_order_relaxed);
+        out << " frames; " << calls << " detector calls, " << (calls ? static_cast<double>(detected) / calls : 0.0)
+            << " frames/call\n";
+        if (pipelineConfig.motionGate.enabled) {
+            // Detector time saved is estimated from its current per-frame average.
+            double savedSeconds = gate.skipped * detector.getInferenceStats().msPerFrame() / 1000.0;
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            out << "  motion gate: " << gate.skipped << "/" << gate.frames << " frames skipped ("
+                << gate.skippedRatio() * 100.0 << "%), " << gate.cropped << " cropped; ~" << savedSeconds
+                << " s detector time and " << motionSavedWh << " Wh saved for " << gate.seconds << " s gating\n";
+        }
+        if (pipelineConfig.tracking.enabled) {
+            out << "  tracker: " << tracks.tracksStarted << " objects (" << tracks.activeTracks << " tracked), "
+                << tracks.matches << " re-sightings; " << tracks.predictedFrames << "/" << tracks.frames()
+                << " frames predicted instead of detected; " << tracks.msPerFrame() << " ms/frame\n";
+        }
+        if (archive) {
+            ArchiveStats saved = archive->getStats();
+            out << "  archive: " << saved.written << " frames, " << saved.bytesWritten / 1048576.0 << " MiB written ("
+                << saved.files << " files, " << saved.bytesOnDisk / 1048576.0 << " MiB on disk), " << saved.evicted
+                << " evicted, " << saved.dropped << " dropped, " << saved.failed << " failed; queue " << saved.queued
+                << "/" << saved.capacity << " (high " << saved.highWater << "); " << saved.meanEncodeMs()
+                << " ms/encode\n";
+        }
+        out << "  end-to-end: " << endToEndStats.meanLatencyMs() << " ms avg, " << endToEndStats.maxLatencyMs()
+            << " ms max\n";
+    }
+
+    // Re-forecast the power budget and apply the chosen detection tier,
+    // inference resolution and conveyor use. Logs only when the plan changes.
+    void replan(Clock::time_point now) {
+        ScopedLatency timer(latency.replan);
+        PowerSnapshot state;
+        state.now = now;
+        state.chargeWh = battery.getChargeWh();
+        state.capacityWh = battery.getCapacityWh();
+        state.maxChargeRateW = battery.getMaxChargeRate();
+
+        PowerPlan plan;
+        bool changed;
+        {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            if (!adaptiveScheduling) return;
+            plan = scheduler.plan(state, [this](Clock::time_point at) { return solarPanel.expectedOutputAt(at); });
+            changed = !havePlan || plan.tier.name != currentPlan.tier.name ||
+                      plan.conveyorEnabled != currentPlan.conveyorEnabled;
+            currentPlan = plan;
+            havePlan = true;
+        }
+
+        detectionInterval = plan.tier.intervalHours;
+        resolutionScale = plan.tier.resolutionScale;
+        conveyorEnabled = plan.conveyorEnabled;
+        detector.setResolutionScale(plan.tier.resolutionScale);
+
+        if (changed) {
+            LogLine& message = scratchLine();
+            message << "Power plan: " << plan.tier.name << " - detect every " << fixedFloat(plan.tier.intervalHours * 60.0f, 0)
+                    << " min at " << fixedFloat(plan.tier.resolutionScale * 100.0f, 0) << "% input, conveyor "
+                    << (plan.conveyorEnabled ? "on" : "off") << " (charge "
+                    << fixedFloat(state.chargeWh / state.capacityWh * 100.0f, 0) << "%, forecast min "
+                    << fixedFloat(plan.forecastMinFraction * 100.0f, 0) << "%, end "
+                    << fixedFloat(plan.forecastEndFraction * 100.0f, 0) << "%, spill "
+                    << fixedFloat(plan.forecastSpillWh, 0) << " Wh)";
+            logData(message.view());
+        }
+    }
+
+    // Detections per Wh drawn from the battery by every load.
+    float detectionsPerWh() {
+        float drawn = battery.getEnergyDrawnWh();
+        std::lock_guard<InstrumentedMutex> lock(statusMutex);
+        return drawn > 0 ? detectionsRun / drawn : 0.0f;
+    }
+
+    // Charge the battery for the time since the last update at the current
+    // solar output.
+    void updatePower(Clock::time_point now, Clock::time_point& lastPowerUpdate) {
+        ScopedLatency timer(latency.power);
+        solarPanel.updateAt(now);
+        battery.charge(solarPanel.getCurrentOutput(), std::max(0.0f, Clock::hoursBetween(lastPowerUpdate, now)));
+        lastPowerUpdate = now;
+    }
+
+    void readEnvironment(EnvironmentalData& lastEnvData) {
+        ScopedLatency timer(latency.environment);
+        if (!traceReader) {
+            lastEnvData = detector.readEnvironmentalSensors();
+        } else if (!traceReader->nextEnvironment(lastEnvData)) {
+            endOfTrace();
+            return;
+        }
+        lastEnvData.timestamp = std::chrono::system_clock::to_time_t(clock->now());
+        if (traceWriter) traceWriter->recordEnvironment(lastEnvData);
+        LogLine& line = scratchLine();
+        line << "Environmental Data: ";
+        lastEnvData.appendTo(line);
+        logData(line.view());
+        history.appendEnvironment(lastEnvData);
+
+        envAlerts.clear();
+        envAnalytics.update(lastEnvData, envAlerts);
+        for (const EnvAlert& alert : envAlerts) {
+            LogLine& message = scratchLine();
+            message << "WARNING: " << alert.rule->message;
+            if (alert.rule->metric != AnomalyRule::Metric::Sample) {
+                message << " (" << envChannelName(alert.rule->channel)
+                        << (alert.rule->metric == AnomalyRule::Metric::Mean ? " mean " : " z-score ")
+                        << fixedFloat(alert.value, 2) << ")";
+            }
+            logData(message.view());
+        }
+    }
+
+    void describeEnvironment(StatusText& out) {
+        out << "Environment trends (" << envAnalytics.channel(EnvChannel::PH).samples() << " readings, rolling day window):\n";
+        for (size_t i = 0; i < kEnvChannelCount; ++i) {
+            EnvChannel channel = static_cast<EnvChannel>(i);
+            ChannelSummary s = envAnalytics.channel(channel).summary();
+            if (s.samples == 0) continue;
+            out << "  " << envChannelName(channel) << ": mean " << s.mean << " sd " << s.stddev << " range "
+                << s.min << "-" << s.max << " p50/p90/p99 " << s.p50 << "/" << s.p90 << "/" << s.p99
+                << " ewma " << s.ewma << " z " << s.zScore << '\n';
+        }
+    }
+
+    void logStatus(Clock::time_point now, const EnvironmentalData& lastEnvData) {
+        ScopedLatency timer(latency.status);
+        // Reused across calls, so building the block does not allocate.
+        static thread_local StatusText status;
+        status.clear();
+        status << "===== SYSTEM STATUS =====" << '\n';
+        status << "Time: " << formatLocalTimestamp(std::chrono::system_clock::to_time_t(now)) << '\n';
+        status << "Solar Output: " << solarPanel.getCurrentOutput() << " W" << '\n';
+        status << "Battery Level: " << battery.getChargePercentage() << "%" << '\n';
+        status << "Mode: " << (solarPanel.getIsDaytime() ? "Day" : "Night") << '\n';
+
+        {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            if (haveMarineDetection) {
+                status << "Last Marine Detection: " << lastMarineDetection.label
+                       << " (" << lastMarineDetection.confidence << "%)" << '\n';
+            }
+
+            if (haveWasteDetection) {
+                status << "Last Waste Detection: " << lastWasteDetection.label
+                       << " (" << lastWasteDetection.size << " cm)" << '\n';
+            }
+        }
+
+        status << "Environment: " << lastEnvData.temperature << "°C, "
+               << lastEnvData.turbidity << " NTU, pH " << lastEnvData.pH << '\n';
+        describeEnvironment(status);
+
+        InferenceStats inference = detector.getInferenceStats();
+        status << "Detector: " << detector.getBackendName() << ", " << inference.framesPerSecond()
+               << " frames/sec, " << inference.msPerFrame() << " ms/frame" << '\n';
+        describePipeline(status);
+
+        FrameCacheStats cache = detector.getFrameCacheStats();
+        status << "Frame cache: " << cache.entries << " frames, " << cache.bytes / (1024 * 1024)
+               << " MiB, " << cache.hits << " hits / " << cache.misses << " misses ("
+               << cache.hitRate() * 100.0 << "%), " << cache.evictions << " evictions, "
+               << cache.prefetched << " prefetched" << '\n';
+
+        if (ingester) {
+            IngestStats ingest = ingester->getStats();
+            status << "Ingest: " << ingest.rows << " rows (" << ingest.badRows << " bad) in " << ingest.batches
+                   << " batches, " << ingest.rowsPerSecond() << " rows/sec, lag " << ingest.lastLagSeconds * 1000.0
+                   << " ms (max " << ingest.maxLagSeconds * 1000.0 << " ms), " << ingest.reloads << " reloads, "
+                   << (ingest.notifications ? "inotify" : "polling") << '\n';
+        }
+
+        {
+            float perWh = detectionsPerWh();
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            status << "Scheduler: " << (adaptiveScheduling ? std::string_view(currentPlan.tier.name) : std::string_view("fixed")) << ", "
+                   << detectionsRun << " detections (" << usefulDetections << " with objects), " << perWh
+                   << " detections/Wh, " << battery.getEnergyDrawnWh() << " Wh drawn" << '\n';
+        }
+
+        ConveyorStats belt = conveyor.getStats();
+        status << "Conveyor: " << belt.itemsCollected << " items in " << belt.runs << " runs, "
+               << belt.pending << " pending, " << belt.rejected << " rejected, " << belt.energyWh
+               << " Wh over " << belt.busySeconds << " s" << '\n';
+
+        if (history.isOpen()) {
+            TimeSeriesStats stored = history.getStats();
+            time_t to = std::chrono::system_clock::to_time_t(now);
+            QueryCost cost;
+            RangeAggregate ph = history.aggregateEnvironment(to - 24 * 3600, to, EnvChannel::PH, &cost);
+            status << "History: " << stored.points << " points in " << stored.blocks << " blocks ("
+                   << stored.pendingPoints << " pending), " << stored.fileBytes / 1024 << " KiB, "
+                   << stored.compressionRatio() << ":1; 24 h pH mean " << ph.mean() << " from "
+                   << cost.blocksFromIndex << " indexed + " << cost.blocksDecoded << " decoded blocks";
+            if (stored.failedWrites > 0) status << ", " << stored.failedWrites << " failed writes";
+            status << '\n';
+        }
+
+        AsyncLoggerStats logStats = logger.getStats();
+        status << "Logger: " << logStats.written << " written, " << logStats.dropped << " dropped, "
+               << logStats.flushes << " flushes, queue high-water " << logStats.highWater << "/"
+               << logStats.capacity << '\n';
+
+        if (clock->isVirtual()) {
+            SimulationStats sim = getSimulationStats();
+            status << "Simulation: " << sim.simulatedHours << " h simulated in " << sim.wallSeconds << " s ("
+                   << sim.hoursPerWallSecond() << " simulated hours/sec)" << '\n';
+        }
+        status << "========================";
+
+        logData(status.view());
+    }
+
+    void maybeWriteMetrics(bool force) {
+        if (metricsPath.empty()) return;
+        auto now = std::chrono::steady_clock::now();
+        if (!force && now - lastMetricsWrite < metricsInterval) return;
+        lastMetricsWrite = now;
+        if (!metrics.writeFile(metricsPath)) logData("Failed to write metrics to " + metricsPath);
+    }
+
+    void noteSimulationProgress(Clock::time_point start, std::chrono::steady_clock::time_point wallStart) {
+        std::lock_guard<InstrumentedMutex> lock(statusMutex);
+        simulationStats.simulatedHours = Clock::hoursBetween(start, clock->now());
+        simulationStats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        ++simulationStats.events;
+    }
+
+public:
+    FloatingAquaticMonitor()
+        : logger("aquatic_monitor_log.txt"),
+          solarPanel(0.20f, 0.75f),
+          battery(500.0f, 100.0f),
+          conveyor(battery),
+          isRunning(false),
+          detectionInterval(1.0f / 6.0f),
+          clock(std::make_unique<SystemClock>()) {
+        conveyor.setCompletionHandler([this](const ConveyorRun& run) { logConveyorRun(run); });
+        buildCameras();
+    }
+
+    ~FloatingAquaticMonitor() {
+        if (ingester) ingester->stop(); // it logs and updates the detector
+        stop();
+        conveyor.shutdown(); // its completion handler logs through members below
+        logger.stop();
+    }
+
+    bool initialize() {
+        logData("System initialized");
+        return true;
+    }
+
+    // Non-blocking: the record is queued for the logger's writer thread.
+    void logData(std::string_view message) {
+        ScopedLatency timer(latency.log);
+        logger.log(message, std::chrono::system_clock::to_time_t(clock->now()));
+    }
+
+    AquaticDetector& getDetector() { return detector; }
+    AsyncLoggerStats getLoggerStats() const { return logger.getStats(); }
+
+    // Must be called before run(), and before addDetectionConsumer().
+    void setPipelineConfig(const PipelineConfig& config) {
+        pipelineConfig = config;
+        buildCameras();
+    }
+
+    // Also hand every frame `camera` sees to `consumer`, after the
+    // monitor's own logging, collection and history. Must be called before
+    // run(). Returns false if there is no such camera.
+    bool addDetectionConsumer(const std::string& camera, DetectionConsumer consumer) {
+        for (auto& stream : cameras) {
+            if (stream->config.name == camera) {
+                stream->consumers.push_back(std::move(consumer));
+                return true;
+            }
+        }
+        return false;
+    }
+    // Record per-stage latency histograms, lock contention, counters and
+    // gauges, and rewrite `path` in the Prometheus text format every
+    // `intervalSeconds` of wall time and when the run ends. Must be called
+    // before run(). Returns false if metrics were compiled out.
+    bool enableMetrics(const std::string& path, double intervalSeconds = 10.0) {
+#if AQUATIC_METRICS
+        using Type = MetricsRegistry::Type;
+        auto stage = [this](const char* name) {
+            return &metrics.histogram("aquatic_stage_latency_seconds", "Latency of one pass through a monitor stage",
+                                      std::string("stage=\"") + name + "\"");
+        };
+        latency.iteration = stage("iteration");
+        latency.power = stage("power");
+        latency.replan = stage("replan");
+        latency.environment = stage("environment");
+        latency.status = stage("status");
+        latency.conveyor = stage("conveyor");
+        latency.capture = stage("capture");
+        latency.motion = stage("motion_gate");
+        latency.track = stage("track");
+        latency.detect = stage("detect");
+        latency.action = stage("action");
+        latency.log = stage("log");
+        statusMutex.instrument(
+            &metrics.histogram("aquatic_lock_wait_seconds", "Time spent blocked acquiring a lock", "lock=\"status\""),
+            &metrics.counter("aquatic_lock_contended_total", "Lock acquisitions that had to wait", "lock=\"status\""));
+        detector.instrument(metrics);
+
+        metrics.sample("aquatic_battery_percent", "Battery state of charge", Type::Gauge, "",
+                       [this] { return battery.getChargePercentage(); });
+        metrics.sample("aquatic_solar_output_watts", "Current solar panel output", Type::Gauge, "",
+                       [this] { return solarPanel.getCurrentOutput(); });
+        metrics.sample("aquatic_energy_drawn_wh_total", "Energy drawn from the battery", Type::Counter, "",
+                       [this] { return battery.getEnergyDrawnWh(); });
+        metrics.sample("aquatic_queue_depth", "Items waiting in a pipeline queue", Type::Gauge, "queue=\"capture\"",
+                       [this] { return captureQueue ? static_cast<double>(captureQueue->size()) : 0.0; });
+        metrics.sample("aquatic_queue_depth", "Items waiting in a pipeline queue", Type::Gauge, "queue=\"action\"",
+                       [this] { return actionQueue ? static_cast<double>(actionQueue->size()) : 0.0; });
+        metrics.sample("aquatic_queue_depth", "Items waiting in a pipeline queue", Type::Gauge, "queue=\"conveyor\"",
+                       [this] { return static_cast<double>(conveyor.getStats().pending); });
+        metrics.sample("aquatic_detections_total", "Detection cycles completed", Type::Counter, "", [this] {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            return static_cast<double>(detectionsRun);
+        });
+        metrics.sample("aquatic_motion_skipped_total", "Frames the motion gate kept from the detector", Type::Counter,
+                       "", [this] { return static_cast<double>(motionGateStats().skipped); });
+        metrics.sample("aquatic_motion_saved_wh_total", "Processing energy saved by the motion gate", Type::Counter, "",
+                       [this] {
+                           std::lock_guard<InstrumentedMutex> lock(statusMutex);
+                           return motionSavedWh;
+                       });
+        metrics.sample("aquatic_tracker_predicted_frames_total",
+                       "Frames the tracker predicted instead of running the detector", Type::Counter, "",
+                       [this] { return static_cast<double>(trackerStats().predictedFrames); });
+        metrics.sample("aquatic_tracks_started_total", "Objects seen for the first time", Type::Counter, "",
+                       [this] { return static_cast<double>(trackerStats().tracksStarted); });
+        metrics.sample("aquatic_detector_calls_total", "Batched detector calls; frames per call is the batch size",
+                       Type::Counter, "", [this] { return static_cast<double>(detectCalls.load()); });
+        metrics.sample("aquatic_waste_collected_total", "Waste items collected by the conveyor", Type::Counter, "",
+                       [this] { return static_cast<double>(conveyor.getStats().itemsCollected); });
+        metrics.sample("aquatic_log_records_total", "Log records written", Type::Counter, "",
+                       [this] { return static_cast<double>(logger.getStats().written); });
+        metrics.sample("aquatic_log_dropped_total", "Log records dropped on a full queue", Type::Counter, "",
+                       [this] { return static_cast<double>(logger.getStats().dropped); });
+        metrics.sample("aquatic_detection_interval_hours", "Current interval between detections", Type::Gauge, "",
+                       [this] { return detectionInterval.load(); });
+
+        metricsPath = path;
+        metricsInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(intervalSeconds));
+        lastMetricsWrite = std::chrono::steady_clock::now();
+        return true;
+#else
+        (void)path;
+        (void)intervalSeconds;
+        logData("Metrics requested but compiled out (AQUATIC_METRICS=0)");
+        return false;
+#endif
+    }
+
+    // Pick up rows appended to the dataset CSVs while running, without a
+    // restart. Call after enableMetrics() to export ingestion metrics.
+    void followDatasets(const IngestConfig& config = IngestConfig()) {
+        if (ingester) return;
+        ingester = std::make_unique<DatasetIngester>(detector, config);
+        ingester->setLogHandler([this](std::string_view message) { logData(message); });
+        if (!metricsPath.empty()) ingester->instrument(metrics);
+        ingester->start();
+
+        LogLine& message = scratchLine();
+        message << "Following " << detector.getWastePath() << " and " << detector.getMarinePath() << " for new rows ("
+                << (ingester->getStats().notifications ? "inotify" : "polling") << ")";
+        logData(message.view());
+    }
+
+    // Save the camera image of every detection of a new object as a JPEG
+    // under config.directory, within its disk budget. Encoding runs on the
+    // archive's own threads; a full queue drops the oldest frame rather
+    // than hold up the pipeline (in simulation it waits instead). Call
+    // before run(), after enableMetrics() to export archive metrics.
+    // Returns false if the directory cannot be created.
+    bool archiveFrames(const ArchiveConfig& config) {
+        auto frames = std::make_unique<FrameArchive>();
+        if (!metricsPath.empty()) frames->instrument(metrics);
+        if (!frames->start(config)) {
+            logData("ERROR: cannot create frame archive " + config.directory);
+            return false;
+        }
+        archive = std::move(frames);
+
+        ArchiveStats existing = archive->getStats();
+        LogLine& message = scratchLine();
+        message << "Archiving detection frames to " << config.directory << " (JPEG quality " << config.jpegQuality
+                << (config.cropToDetections ? ", cropped" : "") << ", budget "
+                << fixedFloat(config.budgetBytes / 1048576.0f, 0) << " MiB, " << existing.files
+                << " files already there)";
+        logData(message.view());
+        return true;
+    }
+
+    // Open (or create) the compressed history at `path`, discarding any
+    // block torn by an earlier crash. Must be called before run().
+    bool openHistory(const std::string& path) {
+        if (!history.open(path)) {
+            logData("Failed to open history store " + path);
+            return false;
+        }
+        TimeSeriesStats stored = history.getStats();
+        std::stringstream message;
+        message << "History store " << path << ": " << stored.blocks << " blocks, " << stored.points << " points";
+        if (stored.recoveredBytes > 0) message << ", discarded " << stored.recoveredBytes << " bytes of torn tail";
+        logData(message.str());
+        return true;
+    }
+
+    // Replace the environmental alert rules (see env_stats.hpp for the
+    // file format). Must be called before run().
+    bool loadAlertRules(const std::string& path) {
+        std::vector<AnomalyRule> rules;
+        std::string error;
+        if (!loadAnomalyRules(path, rules, error)) {
+            std::cerr << "Failed to load alert rules: " << error << std::endl;
+            return false;
+        }
+        envAnalytics.setRules(std::move(rules));
+        return true;
+    }
+
+    // A fixed interval turns the adaptive scheduler off.
+    void setDetectionInterval(float hours) {
+        setAdaptiveScheduling(false);
+        detectionInterval = hours;
+    }
+
+    // Adaptive (default): a PowerScheduler picks interval, resolution and
+    // conveyor use from a charge forecast. Off: fixed 1/6 h at full input.
+    void setAdaptiveScheduling(bool enabled) {
+        {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            adaptiveScheduling = enabled;
+            havePlan = false;
+        }
+        if (!enabled) {
+            detectionInterval = 1.0f / 6.0f;
+            resolutionScale = 1.0f;
+            conveyorEnabled = true;
+            detector.setResolutionScale(1.0f);
+        }
+    }
+    void setConsoleLogging(bool enabled) { logger.setConsoleMirroring(enabled); }
+
+    // Drive run() from a discrete-event virtual clock starting at `start`,
+    // jumping between scheduled events, and return after `hours` of
+    // simulated time. Must be called before run().
+    void simulate(float hours, Clock::time_point start = std::chrono::system_clock::now()) {
+        clock = std::make_unique<VirtualClock>(start);
+        simulationHours = hours;
+        logger.setBlockWhenFull(true); // time is virtual, so backpressure costs nothing
+    }
+
+    // Write this run's inputs to a trace at `path`, seeding rand() with
+    // `seed` so the camera feed choices can be reproduced. Call before run().
+    void recordTrace(const std::string& path, uint32_t seed) {
+        tracePath = path;
+        traceSeed = seed;
+        srand(seed);
+    }
+
+    // Take sensor samples, frames and detections from a recorded trace
+    // instead of the sensors, datasets and detector, on a virtual clock
+    // from the recorded start with the recorded seed, so the run repeats
+    // the recorded one as fast as the pipeline goes. Use instead of
+    // simulate(). Returns false if the trace cannot be read.
+    bool replayTrace(const std::string& path) {
+        auto reader = std::make_unique<TraceReader>();
+        if (!reader->open(path)) return false;
+        const TraceHeader& header = reader->getHeader();
+        srand(header.seed);
+        float hours = header.hours;
+        if (hours <= 0) {
+            time_t start = std::chrono::system_clock::to_time_t(header.start);
+            hours = static_cast<float>(reader->endTime() - start + 1) / 3600.0f;
+        }
+        simulate(hours, header.start);
+        traceReader = std::move(reader);
+        return true;
+    }
+
+    ArchiveStats getArchiveStats() const { return archive ? archive->getStats() : ArchiveStats(); }
+
+    // Records written so far, or consumed so far when replaying.
+    TraceStats getTraceStats() const {
+        if (traceWriter) return traceWriter->getStats();
+        return traceReader ? traceReader->getConsumed() : TraceStats();
+    }
+
+    SimulationStats getSimulationStats() {
+        std::lock_guard<InstrumentedMutex> lock(statusMutex);
+        return simulationStats;
+    }
+
+    // run() is beginRun(), runIteration() until it returns false, then
+    // endRun(); the pieces are public so a single iteration can be driven
+    // (and timed) on its own.
+    void run() {
+        beginRun();
+        while (runIteration()) {
+        }
+        endRun();
+    }
+
+    void beginRun() {
+        isRunning = true;
+        logData("Starting marine life and waste monitoring system");
+
+        RunState& s = runState;
+        s.startTime = clock->now();
+        s.wallStart = std::chrono::steady_clock::now();
+        s.endTime = simulationHours > 0 ? s.startTime + Clock::fromHours(simulationHours) : Clock::time_point::max();
+        if (!tracePath.empty() && !traceWriter) {
+            TraceHeader header;
+            header.seed = traceSeed;
+            header.start = s.startTime;
+            header.hours = simulationHours;
+            traceWriter = std::make_unique<TraceWriter>();
+            if (!traceWriter->open(tracePath, header)) {
+                logData("Failed to open trace " + tracePath);
+                traceWriter.reset();
+            }
+        }
+        {
+            std::lock_guard<InstrumentedMutex> lock(statusMutex);
+            lastDetectionTime = s.startTime;
+            for (auto& camera : cameras) camera->lastCapture = s.startTime;
+            simulationStats = SimulationStats();
+        }
+        s.lastPowerUpdate = s.startTime;
+        s.lastEnvReadingTime = s.startTime;
+        s.lastStatusTime = s.startTime;
+        s.lastReplanTime = s.startTime;
+        s.lastEnvData = EnvironmentalData();
+
+        solarPanel.updateAt(s.startTime);
+        replan(s.startTime);
+
+        if (archive && clock->isVirtual()) archive->setBlockWhenFull(true); // time is virtual; never drop evidence
+
+        // In simulation everything runs on this thread between clock jumps.
+        if (!clock->isVirtual()) {
+            conveyor.start();
+            startPipeline();
+        }
+    }
+
+    // One pass of the control loop: power, planning, sensors, status and,
+    // in simulation, the detection and conveyor events that are due, then
+    // sleep (or jump the virtual clock) to the next event. Returns false
+    // once the run is over.
+    bool runIteration() {
+        if (!isRunning || battery.getChargePercentage() <= 5.0f) return false;
+
+        RunState& s = runState;
+        const bool simulated = clock->isVirtual();
+        try {
+            auto currentTime = clock->now();
+            if (currentTime >= s.endTime) return false;
+
+            Clock::time_point nextDetection;
+            {
+                ScopedLatency iterationTimer(latency.iteration);
+                updatePower(currentTime, s.lastPowerUpdate);
+
+                if (Clock::hoursBetween(s.lastReplanTime, currentTime) >= REPLAN_INTERVAL_HOURS) {
+                    replan(currentTime);
+                    s.lastReplanTime = currentTime;
+                }
+
+                if (Clock::hoursBetween(s.lastEnvReadingTime, currentTime) >= ENV_READ_INTERVAL_HOURS) {
+                    if (battery.discharge(SENSOR_POWER, 0.01f)) {
+                        readEnvironment(s.lastEnvData);
+                        s.lastEnvReadingTime = currentTime;
+                    }
+                }
+
+                if (simulated) {
+                    {
+                        std::lock_guard<InstrumentedMutex> lock(statusMutex);
+                        nextDetection = lastDetectionTime + Clock::fromHours(detectionInterval);
+                    }
+                    if (currentTime >= nextDetection) {
+                        runDetectionCycle();
+                        nextDetection = currentTime + Clock::fromHours(detectionInterval);
+                    }
+                    ScopedLatency conveyorTimer(latency.conveyor);
+                    conveyor.pump(currentTime);
+                }
+
+                if (Clock::hoursBetween(s.lastStatusTime, currentTime) >= STATUS_INTERVAL_HOURS) {
+                    logStatus(currentTime, s.lastEnvData);
+                    s.lastStatusTime = currentTime;
+                }
+            }
+            maybeWriteMetrics(false);
+
+            if (simulated) {
+                noteSimulationProgress(s.startTime, s.wallStart);
+                // Jump to the earliest scheduled event. Solar output is
+                // resampled at least every POWER_STEP_HOURS.
+                auto next = std::min({nextDetection, s.lastEnvReadingTime + Clock::fromHours(ENV_READ_INTERVAL_HOURS),
+                                      s.lastStatusTime + Clock::fromHours(STATUS_INTERVAL_HOURS),
+                                      s.lastReplanTime + Clock::fromHours(REPLAN_INTERVAL_HOURS),
+                                      conveyor.nextEventTime(), currentTime + Clock::fromHours(POWER_STEP_HOURS),
+                                      s.endTime});
+                clock->sleepUntil(std::max(next, currentTime + std::chrono::milliseconds(1)));
+            } else {
+                clock->sleepFor(std::chrono::seconds(1));
+            }
+        } catch (const std::exception& e) {
+            logData(std::string("ERROR in main loop: ") + e.what());
+            clock->sleepFor(std::chrono::seconds(1)); // Prevent tight error loop
+        }
+        return true;
+    }
+
+    void endRun() {
+        isRunning = false;
+        if (!history.flush()) {
+            LogLine& message = scratchLine();
+            message << "Failed to write history store, " << history.getStats().pendingPoints << " points not saved";
+            logData(message.view());
+        }
+        if (traceWriter) traceWriter->flush();
+        if (clock->isVirtual()) {
+            noteSimulationProgress(runState.startTime, runState.wallStart);
+            SimulationStats sim = getSimulationStats();
+            std::stringstream summary;
+            summary << "Simulation finished: " << sim.simulatedHours << " h in " << sim.wallSeconds << " s wall, "
+                    << sim.hoursPerWallSecond() << " simulated hours/sec, " << sim.events << " events, "
+                    << detectionsPerWh() << " detections/Wh";
+            logData(summary.str());
+        } else {
+            stopPipeline();
+        }
+        if (archive) archive->stop(); // writes out what is still queued
+
+        if (battery.getChargePercentage() <= 5.0f) {
+            logData("CRITICAL: Battery level below 5% - initiating shutdown");
+        }
+        maybeWriteMetrics(true);
+    }
+
+    void stop() {
+        isRunning = false;
+        conveyor.stop();
+        logData("System shutdown complete");
+    }
+};
+
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "dnn_detector.hpp" // DetectionPair
+#include "log_format.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+
+struct ArchiveConfig {
+    std::string directory = "archive";
+    int jpegQuality = 90;
+    bool cropToDetections = false; // save the detections' boxes (padded) rather than the whole frame
+    double cropPadding = 0.2;      // added around the boxes, as a share of their size per side
+    uint64_t budgetBytes = 512ull * 1024 * 1024; // oldest files are deleted beyond this
+    unsigned encoders = 2;
+    size_t queueCapacity = 32;
+    OverflowPolicy overflow = OverflowPolicy::DropOldest; // never stall the caller
+};
+
+struct ArchiveStats {
+    uint64_t submitted = 0;
+    uint64_t written = 0;
+    uint64_t failed = 0;
+    uint64_t dropped = 0; // queue full
+    uint64_t evicted = 0; // deleted to stay within budget
+    uint64_t bytesWritten = 0;
+    uint64_t bytesOnDisk = 0;
+    uint64_t files = 0;
+    size_t queued = 0;
+    size_t highWater = 0;
+    size_t capacity = 0;
+    double encodeSeconds = 0.0; // JPEG encoding only, summed over encoders
+
+    double meanEncodeMs() const { return written ? encodeSeconds * 1000.0 / written : 0.0; }
+};
+
+// Saves evidence frames as JPEGs off the caller's thread. submit() only
+// queues a reference to the frame (cv::Mat shares its pixels), so the
+// caller must not write to it afterwards; frames from the frame cache are
+// read-only anyway. A pool of encoder threads compresses and writes each
+// file (to a temporary name, then renamed, so the directory never holds a
+// half-written image) and keeps the directory under budgetBytes by
+// deleting the oldest files, including those left by earlier runs.
+class FrameArchive {
+private:
+    struct Job {
+        cv::Mat frame;
+        cv::Rect crop; // empty: the whole frame
+        std::string camera;
+        time_t when = 0;
+    };
+
+    struct StoredFile {
+        std::filesystem::path path;
+        uint64_t bytes = 0;
+    };
+
+    ArchiveConfig config;
+    std::unique_ptr<BoundedQueue<Job>> queue;
+    PipelineStage encoders{"archive"};
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> evicted{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> encodeNanoseconds{0};
+    std::atomic<uint64_t> sequence{0};
+    LatencyHistogram* encodeLatency = nullptr;
+
+    mutable std::mutex filesMutex;
+    std::deque<StoredFile> files; // oldest first
+    uint64_t bytesOnDisk = 0;
+
+    // Existing archive, oldest first by modification time.
+    void scanDirectory() {
+        namespace fs = std::filesystem;
+        std::vector<std::pair<fs::file_time_type, StoredFile>> found;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(config.directory, ec)) {
+            if (!entry.is_regular_file(ec) || entry.path().extension() != ".jpg") continue;
+            StoredFile file{entry.path(), entry.file_size(ec)};
+            found.emplace_back(entry.last_write_time(ec), std::move(file));
+        }
+        std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : a.second.path < b.second.path;
+        });
+        std::lock_guard<std::mutex> lock(filesMutex);
+        files.clear();
+        bytesOnDisk = 0;
+        for (auto& [time, file] : found) {
+            bytesOnDisk += file.bytes;
+            files.push_back(std::move(file));
+        }
+    }
+
+    // Caller holds filesMutex. The newest file always stays.
+    void enforceBudget() {
+        while (bytesOnDisk > config.budgetBytes && files.size() > 1) {
+            std::error_code ec;
+            std::filesystem::remove(files.front().path, ec);
+            bytesOnDisk -= std::min(bytesOnDisk, files.front().bytes);
+            files.pop_front();
+            evicted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // A name no file in the directory has yet. A replay or a repeated
+    // simulation reuses the same times, and the sequence restarts with
+    // each run, so skip past files left by earlier runs rather than
+    // overwrite them (files would then count one path twice). Sequence
+    // numbers are unique within a run, so encoders cannot collide.
+    std::filesystem::path fileNameFor(const Job& job) {
+        for (;;) {
+            LogLine name;
+            name << formatLocalTimestamp(job.when) << '_' << job.camera << '_'
+                 << sequence.fetch_add(1, std::memory_order_relaxed) << ".jpg";
+            std::string text(name.view());
+            std::replace(text.begin(), text.end(), ' ', '_');
+            std::replace(text.begin(), text.end(), ':', '-');
+            std::filesystem::path path = std::filesystem::path(config.directory) / text;
+            std::error_code ec;
+            if (!std::filesystem::exists(path, ec)) return path;
+        }
+    }
+
+    void encodeOne(const Job& job, std::vector<unsigned char>& buffer, const std::vector<int>& params) {
+        bool encoded;
+        {
+            ScopedLatency timer(encodeLatency);
+            auto started = std::chrono::steady_clock::now();
+            encoded = cv::imencode(".jpg", job.crop.empty() ? job.frame : job.frame(job.crop), buffer, params);
+            encodeNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            std::chrono::steady_clock::now() - started).count()),
+                                        std::memory_order_relaxed);
+        }
+        std::filesystem::path target = fileNameFor(job);
+        std::filesystem::path temporary = target;
+        temporary += ".part";
+        if (encoded) {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            out.close();
+            std::error_code ec;
+            if (out) std::filesystem::rename(temporary, target, ec);
+            encoded = out && !ec;
+            if (!encoded) std::filesystem::remove(temporary, ec);
+        }
+        if (!encoded) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        written.fetch_add(1, std::memory_order_relaxed);
+        bytesWritten.fetch_add(buffer.size(), std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(filesMutex);
+        files.push_back({std::move(target), buffer.size()});
+        bytesOnDisk += buffer.size();
+        enforceBudget();
+    }
+
+    void encodeLoop() {
+        std::vector<unsigned char> buffer; // reused, so steady state does not allocate per frame
+        std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, config.jpegQuality};
+        Job job;
+        while (queue->pop(job)) {
+            encodeOne(job, buffer, params);
+            job.frame.release();
+        }
+    }
+
+    // Union of the detections' boxes, padded and clipped to the frame;
+    // empty (the whole frame) if none has a box.
+    cv::Rect cropFor(const cv::Mat& frame, const DetectionPair& detections) const {
+        cv::Rect bounds;
+        for (const auto* list : {&detections.first, &detections.second}) {
+            for (const DetectionResult& detection : *list) bounds = bounds | detection.box;
+        }
+        if (bounds.empty()) return cv::Rect();
+        int padX = static_cast<int>(bounds.width * config.cropPadding);
+        int padY = static_cast<int>(bounds.height * config.cropPadding);
+        cv::Rect padded(bounds.x - padX, bounds.y - padY, bounds.width + 2 * padX, bounds.height + 2 * padY);
+        return padded & cv::Rect(0, 0, frame.cols, frame.rows);
+    }
+
+public:
+    ~FrameArchive() { stop(); }
+
+    // Create the directory, account for what it already holds and start
+    // the encoders. Returns false if the directory cannot be created.
+    bool start(const ArchiveConfig& cfg) {
+        stop();
+        config = cfg;
+        std::error_code ec;
+        std::filesystem::create_directories(config.directory, ec);
+        if (ec) return false;
+        scanDirectory();
+        {
+            std::lock_guard<std::mutex> lock(filesMutex);
+            enforceBudget();
+        }
+        queue = std::make_unique<BoundedQueue<Job>>(config.queueCapacity);
+        running = true;
+        encoders.start(config.encoders, [this]() { encodeLoop(); });
+        return true;
+    }
+
+    // Finish what is queued, then stop the encoders.
+    void stop() {
+        if (!running.exchange(false)) return;
+        queue->close();
+        encoders.join();
+    }
+
+    bool isRunning() const { return running.load(); }
+    const ArchiveConfig& getConfig() const { return config; }
+
+    // Block instead of dropping when the queue is full; for simulation,
+    // where the caller's time is virtual.
+    void setBlockWhenFull(bool block) { config.overflow = block ? OverflowPolicy::Block : OverflowPolicy::DropOldest; }
+
+    // Queue `frame` for saving; returns without waiting for the encoders.
+    // `detections` are only used for the crop.
+    void submit(const cv::Mat& frame, const DetectionPair& detections, const std::string& camera, time_t when) {
+        if (!running || frame.empty()) return;
+        Job job;
+        job.frame = frame;
+        if (config.cropToDetections) job.crop = cropFor(frame, detections);
+        job.camera = camera;
+        job.when = when;
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        queue->push(std::move(job), config.overflow);
+    }
+
+    void instrument(MetricsRegistry& metrics) {
+        using Type = MetricsRegistry::Type;
+        encodeLatency = &metrics.histogram("aquatic_archive_encode_seconds", "Time to JPEG-encode one archived frame");
+        metrics.sample("aquatic_queue_depth", "Items waiting in a pipeline queue", Type::Gauge, "queue=\"archive\"",
+                       [this] { return queue ? static_cast<double>(queue->size()) : 0.0; });
+        metrics.sample("aquatic_archive_frames_total", "Frames written to the archive", Type::Counter, "",
+                       [this] { return static_cast<double>(written.load()); });
+        metrics.sample("aquatic_archive_bytes_total", "Bytes written to the archive", Type::Counter, "",
+                       [this] { return static_cast<double>(bytesWritten.load()); });
+        metrics.sample("aquatic_archive_dropped_total", "Frames dropped on a full archive queue", Type::Counter, "",
+                       [this] { return queue ? static_cast<double>(queue->droppedCount()) : 0.0; });
+        metrics.sample("aquatic_archive_evicted_total", "Archived frames deleted to stay within budget",
+                       Type::Counter, "", [this] { return static_cast<double>(evicted.load()); });
+        metrics.sample("aquatic_archive_disk_bytes", "Bytes the archive occupies", Type::Gauge, "",
+                       [this] { return static_cast<double>(getStats().bytesOnDisk); });
+    }
+
+    ArchiveStats getStats() const {
+        ArchiveStats stats;
+        stats.submitted = submitted.load(std::memory_order_relaxed);
+        stats.written = written.load(std::memory_order_relaxed);
+        stats.failed = failed.load(std::memory_order_relaxed);
+        stats.evicted = evicted.load(std::memory_order_relaxed);
+        stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+        stats.encodeSeconds = encodeNanoseconds.load(std::memory_order_relaxed) / 1e9;
+        if (queue) {
+            stats.dropped = queue->droppedCount();
+            stats.queued = queue->size();
+            stats.highWater = queue->highWaterMark();
+            stats.capacity = queue->capacity();
+        }
+        std::lock_guard<std::mutex> lock(filesMutex);
+        stats.bytesOnDisk = bytesOnDisk;
+        stats.files = files.size();
+        return stats;
+    }
+};
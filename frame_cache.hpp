@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+struct FrameCacheConfig {
+    size_t byteBudget = 64 * 1024 * 1024;
+    int maxWidth = 0;  // frames wider or taller than this are downscaled
+    int maxHeight = 0; // on insert; 0 keeps the decoded size
+    size_t prefetchDepth = 4;
+};
+
+struct FrameCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t prefetched = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    double hitRate() const { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+};
+
+// Thread-safe LRU cache of decoded images, keyed by path and mtime so an
+// image rewritten on disk is decoded again. Cached Mats are shared, not
+// copied: callers must treat the returned frame as read-only. A background
+// thread decodes prefetch requests so capture becomes a cache lookup.
+class FrameCache {
+private:
+    struct Entry {
+        std::string path;
+        int64_t mtime;
+        cv::Mat frame;
+        size_t bytes;
+    };
+
+    FrameCacheConfig config;
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    std::unordered_set<std::string> inFlight;
+    size_t usedBytes = 0;
+    FrameCacheStats stats;
+    mutable std::mutex cacheMutex;
+    std::condition_variable decodeDone;
+
+    // Pending prefetch paths, a ring of two prefetch runs (one per
+    // dataset). Slots keep their strings' storage between requests.
+    std::vector<std::string> prefetchQueue;
+    size_t prefetchHead = 0;
+    size_t prefetchCount = 0;
+    std::condition_variable prefetchReady;
+    std::thread prefetchThread;
+    bool stopping = false;
+
+    static int64_t modificationTime(const std::string& path) {
+        std::error_code ec;
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        return ec ? -1 : static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+
+    static cv::Mat decode(const std::string& path, int maxWidth, int maxHeight) {
+        cv::Mat frame = cv::imread(path, cv::IMREAD_COLOR);
+        if (frame.empty()) return frame;
+
+        if ((maxWidth > 0 && frame.cols > maxWidth) || (maxHeight > 0 && frame.rows > maxHeight)) {
+            double sx = maxWidth > 0 ? static_cast<double>(maxWidth) / frame.cols : 1.0;
+            double sy = maxHeight > 0 ? static_cast<double>(maxHeight) / frame.rows : 1.0;
+            double scale = std::min(sx, sy);
+            cv::Mat scaled;
+            cv::resize(frame, scaled,
+                       cv::Size(std::max(1, static_cast<int>(frame.cols * scale)),
+                                std::max(1, static_cast<int>(frame.rows * scale))),
+                       0, 0, cv::INTER_AREA);
+            frame = scaled;
+        }
+        return frame;
+    }
+
+    // Caller holds cacheMutex.
+    bool lookupLocked(const std::string& path, int64_t mtime, cv::Mat& out) {
+        auto it = index.find(path);
+        if (it == index.end()) return false;
+        if (it->second->mtime != mtime) {
+            usedBytes -= it->second->bytes;
+            lru.erase(it->second);
+            index.erase(it);
+            return false;
+        }
+        lru.splice(lru.begin(), lru, it->second);
+        out = it->second->frame;
+        return true;
+    }
+
+    // Caller holds cacheMutex.
+    void insertLocked(const std::string& path, int64_t mtime, const cv::Mat& frame) {
+        size_t bytes = frame.total() * frame.elemSize();
+        if (bytes > config.byteBudget) return;
+
+        auto existing = index.find(path);
+        if (existing != index.end()) {
+            usedBytes -= existing->second->bytes;
+            lru.erase(existing->second);
+            index.erase(existing);
+        }
+
+        while (usedBytes + bytes > config.byteBudget && !lru.empty()) {
+            usedBytes -= lru.back().bytes;
+            index.erase(lru.back().path);
+            lru.pop_back();
+            ++stats.evictions;
+        }
+
+        lru.push_front({path, mtime, frame, bytes});
+        index[path] = lru.begin();
+        usedBytes += bytes;
+    }
+
+    // Caller holds cacheMutex.
+    void resizePrefetchQueueLocked() {
+        prefetchQueue.resize(std::max<size_t>(config.prefetchDepth, 1) * 2);
+        prefetchHead = 0;
+        prefetchCount = 0;
+    }
+
+    // Caller holds cacheMutex. A full ring drops its oldest request, which
+    // the cursor has already moved past.
+    void queuePrefetchLocked(const std::string& path) {
+        for (size_t i = 0; i < prefetchCount; ++i) {
+            if (prefetchQueue[(prefetchHead + i) % prefetchQueue.size()] == path) return;
+        }
+        if (prefetchCount == prefetchQueue.size()) {
+            prefetchHead = (prefetchHead + 1) % prefetchQueue.size();
+            --prefetchCount;
+        }
+        prefetchQueue[(prefetchHead + prefetchCount) % prefetchQueue.size()].assign(path);
+        ++prefetchCount;
+    }
+
+    void prefetchLoop() {
+        std::string path;
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        while (true) {
+            prefetchReady.wait(lock, [this]() { return stopping || prefetchCount > 0; });
+            if (stopping) return;
+
+            path.swap(prefetchQueue[prefetchHead]); // the slot gets this thread's old buffer back
+            prefetchHead = (prefetchHead + 1) % prefetchQueue.size();
+            --prefetchCount;
+            if (index.count(path) || inFlight.count(path)) continue;
+
+            inFlight.insert(path);
+            int maxWidth = config.maxWidth, maxHeight = config.maxHeight;
+            lock.unlock();
+            int64_t mtime = modificationTime(path);
+            cv::Mat frame = decode(path, maxWidth, maxHeight);
+            lock.lock();
+
+            inFlight.erase(path);
+            if (!frame.empty()) {
+                insertLocked(path, mtime, frame);
+                ++stats.prefetched;
+            }
+            decodeDone.notify_all();
+        }
+    }
+
+public:
+    explicit FrameCache(const FrameCacheConfig& cfg = FrameCacheConfig()) : config(cfg) {
+        resizePrefetchQueueLocked();
+        prefetchThread = std::thread([this]() { prefetchLoop(); });
+    }
+
+    ~FrameCache() {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            stopping = true;
+        }
+        prefetchReady.notify_all();
+        if (prefetchThread.joinable()) prefetchThread.join();
+    }
+
+    FrameCache(const FrameCache&) = delete;
+    FrameCache& operator=(const FrameCache&) = delete;
+
+    void configure(const FrameCacheConfig& cfg) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        config = cfg;
+        resizePrefetchQueueLocked();
+        while (usedBytes > config.byteBudget && !lru.empty()) {
+            usedBytes -= lru.back().bytes;
+            index.erase(lru.back().path);
+            lru.pop_back();
+            ++stats.evictions;
+        }
+    }
+
+    size_t getPrefetchDepth() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return config.prefetchDepth;
+    }
+
+    // Return the decoded frame for `path`, decoding it on a miss. If the
+    // prefetcher is already decoding it, wait for that instead of decoding twice.
+    bool get(const std::string& path, cv::Mat& out) {
+        int64_t mtime = modificationTime(path);
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        decodeDone.wait(lock, [&]() { return inFlight.count(path) == 0; });
+
+        if (lookupLocked(path, mtime, out)) {
+            ++stats.hits;
+            return true;
+        }
+        ++stats.misses;
+
+        inFlight.insert(path);
+        int maxWidth = config.maxWidth, maxHeight = config.maxHeight;
+        lock.unlock();
+        cv::Mat frame = decode(path, maxWidth, maxHeight);
+        lock.lock();
+        inFlight.erase(path);
+        if (!frame.empty()) insertLocked(path, mtime, frame);
+        decodeDone.notify_all();
+
+        out = frame;
+        return !out.empty();
+    }
+
+    // Queue paths for background decoding. The pending queue holds two
+    // prefetch runs (one per dataset); older requests fall off the front
+    // since the cursor has already moved past them.
+    void prefetch(const std::vector<std::string>& paths) {
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            for (const auto& path : paths) {
+                if (index.count(path) || inFlight.count(path)) continue;
+                queuePrefetchLocked(path);
+            }
+        }
+        prefetchReady.notify_one();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        lru.clear();
+        index.clear();
+        usedBytes = 0;
+    }
+
+    FrameCacheStats getStats() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        FrameCacheStats snapshot = stats;
+        snapshot.entries = lru.size();
+        snapshot.bytes = usedBytes;
+        return snapshot;
+    }
+};
@@ -0,0 +1,81 @@
+// Counting replacements for the global operator new and delete; see
+// heap_audit.hpp. Link into an executable to enable the counters.
+
+#include <cstdlib>
+#include <new>
+
+#include "heap_audit.hpp"
+
+using namespace std;
+
+namespace {
+
+const bool installedAtStartup = (heap_audit::installed = true);
+
+void* allocate(size_t bytes, size_t alignment) {
+    heap_audit::allocations.fetch_add(1, memory_order_relaxed);
+    heap_audit::allocatedBytes.fetch_add(bytes, memory_order_relaxed);
+    ++heap_audit::threadAllocations;
+    if (heap_audit::reportAllocations) heap_audit::unexpectedAllocation(bytes);
+
+    if (bytes == 0) bytes = 1;
+    void* memory;
+    if (alignment <= alignof(max_align_t)) {
+        memory = malloc(bytes);
+    } else {
+        bytes = (bytes + alignment - 1) / alignment * alignment; // aligned_alloc needs a multiple
+        memory = aligned_alloc(alignment, bytes);
+    }
+    return memory;
+}
+
+void* allocateOrThrow(size_t bytes, size_t alignment) {
+    for (;;) {
+        if (void* memory = allocate(bytes, alignment)) return memory;
+        new_handler handler = get_new_handler();
+        if (!handler) throw bad_alloc();
+        handler();
+    }
+}
+
+} // namespace
+
+namespace heap_audit {
+
+// Out of line and with a side effect the optimiser must keep, so a
+// debugger can stop here.
+__attribute__((noinline)) void unexpectedAllocation(size_t bytes) {
+    asm volatile("" : : "r"(bytes) : "memory");
+}
+
+} // namespace heap_audit
+
+void* operator new(size_t bytes) { return allocateOrThrow(bytes, 0); }
+void* operator new[](size_t bytes) { return allocateOrThrow(bytes, 0); }
+void* operator new(size_t bytes, align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t bytes, align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<size_t>(alignment));
+}
+void* operator new(size_t bytes, const nothrow_t&) noexcept { return allocate(bytes, 0); }
+void* operator new[](size_t bytes, const nothrow_t&) noexcept { return allocate(bytes, 0); }
+void* operator new(size_t bytes, align_val_t alignment, const nothrow_t&) noexcept {
+    return allocate(bytes, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t bytes, align_val_t alignment, const nothrow_t&) noexcept {
+    return allocate(bytes, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t, align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete(void* memory, align_val_t, const nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, align_val_t, const nothrow_t&) noexcept { free(memory); }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Counts of global operator new calls, for checking that the monitoring
+// loop does not allocate once warmed up. The counting operator new lives
+// in heap_audit.cpp and only runs in executables that link it
+// (aquatic_monitor, monitor_bench); elsewhere the counters stay at zero
+// and isInstalled() is false.
+//
+// Only operator new is seen: cv::Mat buffers come from cv::fastMalloc,
+// so the loop keeps those allocation-free by reusing Mats instead.
+namespace heap_audit {
+
+inline std::atomic<bool> installed{false};
+inline std::atomic<uint64_t> allocations{0}; // every thread
+inline std::atomic<uint64_t> allocatedBytes{0};
+inline thread_local uint64_t threadAllocations = 0;
+inline thread_local bool reportAllocations = false; // see Guard
+
+inline bool isInstalled() { return installed.load(std::memory_order_relaxed); }
+
+// Called for each allocation on a thread inside a Guard; a breakpoint
+// here shows who allocated.
+void unexpectedAllocation(std::size_t bytes);
+
+// Allocations made by the current thread while in scope.
+class Guard {
+private:
+    uint64_t startCount;
+    bool wasReporting;
+
+public:
+    Guard() : startCount(threadAllocations), wasReporting(reportAllocations) { reportAllocations = true; }
+    ~Guard() { reportAllocations = wasReporting; }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    uint64_t allocations() const { return threadAllocations - startCount; }
+};
+
+} // namespace heap_audit
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+// Log and status text is built in fixed-capacity buffers instead of by
+// std::string concatenation or stringstreams, so formatting a record costs
+// no heap allocations. Numbers are written with std::to_chars or, for
+// fixed-point values in the common range, a direct integer conversion.
+
+// Appends `value` with `precision` decimals, like printf("%.*f").
+struct FixedFloat {
+    double value;
+    int precision;
+};
+
+inline FixedFloat fixedFloat(double value, int precision) { return FixedFloat{value, precision}; }
+
+// Text builder over inline storage. Floats without fixedFloat() are
+// written like an ostream's default (6 significant digits, %g). Appends
+// that do not fit are dropped and flagged rather than reallocating.
+template <size_t Capacity>
+class FormatBuffer {
+private:
+    char text[Capacity];
+    size_t length = 0;
+    bool overflowed = false;
+
+    void commit(std::to_chars_result result) {
+        if (result.ec == std::errc()) {
+            length = static_cast<size_t>(result.ptr - text);
+        } else {
+            overflowed = true;
+        }
+    }
+
+    void appendFloat(double value, std::chars_format format, int precision) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        commit(std::to_chars(text + length, text + Capacity, value, format, precision));
+#else
+        int written = std::snprintf(text + length, Capacity - length,
+                                    format == std::chars_format::fixed ? "%.*f" : "%.*g", precision, value);
+        if (written < 0 || static_cast<size_t>(written) >= Capacity - length) {
+            overflowed = true;
+        } else {
+            length += static_cast<size_t>(written);
+        }
+#endif
+    }
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    void clear() {
+        length = 0;
+        overflowed = false;
+    }
+
+    size_t size() const { return length; }
+    bool truncated() const { return overflowed; }
+    std::string_view view() const { return std::string_view(text, length); }
+    std::string str() const { return std::string(text, length); }
+
+    FormatBuffer& append(const char* data, size_t count) {
+        if (count > Capacity - length) {
+            count = Capacity - length;
+            overflowed = true;
+        }
+        std::memcpy(text + length, data, count);
+        length += count;
+        return *this;
+    }
+
+    FormatBuffer& operator<<(std::string_view value) { return append(value.data(), value.size()); }
+    FormatBuffer& operator<<(const std::string& value) { return append(value.data(), value.size()); }
+    FormatBuffer& operator<<(const char* value) { return append(value, std::strlen(value)); }
+
+    FormatBuffer& operator<<(char value) { return append(&value, 1); }
+
+    template <typename Int, typename std::enable_if<std::is_integral<Int>::value && !std::is_same<Int, char>::value &&
+                                                        !std::is_same<Int, bool>::value,
+                                                    int>::type = 0>
+    FormatBuffer& operator<<(Int value) {
+        commit(std::to_chars(text + length, text + Capacity, value));
+        return *this;
+    }
+
+    FormatBuffer& operator<<(double value) {
+        appendFloat(value, std::chars_format::general, 6);
+        return *this;
+    }
+
+    FormatBuffer& operator<<(float value) { return *this << static_cast<double>(value); }
+
+    // Small values are scaled to an integer and printed digit by digit.
+    // For float inputs at up to 6 decimals the scaling is exact and
+    // nearbyint() rounds ties to even, so the text matches printf.
+    FormatBuffer& operator<<(FixedFloat value) {
+        static constexpr double kPowers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+        if (value.precision < 0 || value.precision > 9 || !(std::fabs(value.value) < 1e9)) {
+            appendFloat(value.value, std::chars_format::fixed, value.precision);
+            return *this;
+        }
+        double scaled = std::nearbyint(value.value * kPowers[value.precision]);
+        bool negative = std::signbit(value.value);
+        uint64_t units = static_cast<uint64_t>(std::fabs(scaled));
+
+        char digits[32];
+        char* end = digits + sizeof(digits);
+        char* first = end;
+        for (int i = 0; i < value.precision; ++i) {
+            *--first = static_cast<char>('0' + units % 10);
+            units /= 10;
+        }
+        if (value.precision > 0) *--first = '.';
+        do {
+            *--first = static_cast<char>('0' + units % 10);
+            units /= 10;
+        } while (units > 0);
+        if (negative) *--first = '-';
+        return append(first, static_cast<size_t>(end - first));
+    }
+};
+
+using LogLine = FormatBuffer<1024>;
+using StatusText = FormatBuffer<16 * 1024>;
+
+// The calling thread's scratch line, cleared. For building a record that
+// is handed straight to a logger (which copies it); do not hold it across
+// a call that may build another line.
+inline LogLine& scratchLine() {
+    static thread_local LogLine line;
+    line.clear();
+    return line;
+}
+
+// Local time as "YYYY-MM-DD HH:MM:SS", or an empty view if it cannot be
+// converted. Uses localtime_r, and only when the second changes: the
+// cache is per thread, so any thread may call this. The view stays valid
+// until the calling thread's next call.
+inline std::string_view formatLocalTimestamp(time_t when) {
+    struct Cache {
+        time_t second = 0;
+        bool valid = false;
+        char text[32];
+        size_t length = 0;
+    };
+    static thread_local Cache cache;
+
+    if (!cache.valid || cache.second != when) {
+        tm local;
+#ifdef _WIN32
+        bool converted = localtime_s(&local, &when) == 0;
+#else
+        bool converted = localtime_r(&when, &local) != nullptr;
+#endif
+        cache.length = converted ? strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &local) : 0;
+        cache.second = when;
+        cache.valid = true;
+    }
+    return std::string_view(cache.text, cache.length);
+}
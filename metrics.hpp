@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Build with AQUATIC_METRICS=0 to compile the instrumentation out: the
+// timers and instrumented locks below then reduce to their plain
+// equivalents and never read the clock.
+#ifndef AQUATIC_METRICS
+#define AQUATIC_METRICS 1
+#endif
+
+// Log-linear latency histogram in the style of HdrHistogram: every power
+// of two of nanoseconds is split into 16 sub-buckets, so any recorded
+// value is reported within 1/16 (6.25%) of its true value, from 1 ns to
+// ~18 minutes, in a fixed 10 KiB of counters. Recording is one relaxed
+// atomic increment per counter; any thread may record.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMagnitudes = 40;
+    static constexpr size_t kBuckets = static_cast<size_t>(kMagnitudes + 1) * kSubBuckets;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sumNs = 0;
+        uint64_t maxNs = 0;
+        std::vector<uint64_t> buckets;
+
+        // Upper bound of the bucket holding the q-quantile, in ns.
+        uint64_t quantileNs(double q) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen >= rank) return std::min(bucketUpperNs(i), maxNs);
+            }
+            return maxNs;
+        }
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumNs{0};
+    std::atomic<uint64_t> maxNs{0};
+
+    static int highestBit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(v);
+#else
+        int bit = 0;
+        while (v >>= 1) ++bit;
+        return bit;
+#endif
+    }
+
+public:
+    static size_t bucketFor(uint64_t ns) {
+        if (ns < static_cast<uint64_t>(kSubBuckets)) return static_cast<size_t>(ns);
+        int shift = highestBit(ns) - kSubBucketBits;
+        size_t index = (static_cast<size_t>(shift) + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets);
+        return std::min(index, kBuckets - 1);
+    }
+
+    static uint64_t bucketUpperNs(size_t index) {
+        if (index < static_cast<size_t>(kSubBuckets)) return index;
+        int shift = static_cast<int>(index / kSubBuckets) - 1;
+        uint64_t sub = index % kSubBuckets;
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t ns) {
+        buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = maxNs.load(std::memory_order_relaxed);
+        while (ns > seen && !maxNs.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    void record(std::chrono::steady_clock::duration elapsed) {
+        record(static_cast<uint64_t>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())));
+    }
+
+    // Not an atomic cut across counters; good enough for monitoring.
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.count = count.load(std::memory_order_relaxed);
+        s.sumNs = sumNs.load(std::memory_order_relaxed);
+        s.maxNs = maxNs.load(std::memory_order_relaxed);
+        s.buckets.resize(kBuckets);
+        for (size_t i = 0; i < kBuckets; ++i) s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+struct MetricCounter {
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+};
+
+// Records the lifetime of the scope into a histogram; a null histogram
+// (metrics not enabled) costs one branch and no clock reads.
+class ScopedLatency {
+#if AQUATIC_METRICS
+private:
+    LatencyHistogram* histogram;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    explicit ScopedLatency(LatencyHistogram* h)
+        : histogram(h), started(h ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+    ~ScopedLatency() {
+        if (histogram) histogram->record(std::chrono::steady_clock::now() - started);
+    }
+#else
+public:
+    explicit ScopedLatency(LatencyHistogram*) {}
+#endif
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+};
+
+// std::mutex that, once instrumented, measures how long lockers wait for
+// it. The uncontended path is a single try_lock, so only lockers that
+// actually block pay for reading the clock.
+class InstrumentedMutex {
+private:
+    std::mutex mutex;
+#if AQUATIC_METRICS
+    LatencyHistogram* waits = nullptr;
+    MetricCounter* contended = nullptr;
+#endif
+
+public:
+    // Call before other threads use the mutex.
+    void instrument(LatencyHistogram* waitHistogram, MetricCounter* contendedCounter) {
+#if AQUATIC_METRICS
+        waits = waitHistogram;
+        contended = contendedCounter;
+#else
+        (void)waitHistogram;
+        (void)contendedCounter;
+#endif
+    }
+
+    void lock() {
+#if AQUATIC_METRICS
+        if (waits) {
+            if (mutex.try_lock()) return;
+            auto started = std::chrono::steady_clock::now();
+            mutex.lock();
+            waits->record(std::chrono::steady_clock::now() - started);
+            if (contended) contended->add();
+            return;
+        }
+#endif
+        mutex.lock();
+    }
+
+    bool try_lock() { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+};
+
+// Named counters, gauges and latency histograms, rendered in the
+// Prometheus text exposition format. Histograms are exported as summaries
+// (quantiles from the HDR buckets, plus _sum and _count) with a companion
+// _max gauge. Sampled metrics read an existing statistic through a
+// callback at export time, so their sources pay nothing per update.
+// Register everything before recording starts; registration is not
+// synchronised with export.
+class MetricsRegistry {
+public:
+    enum class Type { Counter, Gauge, Summary };
+    using Sampler = std::function<double()>;
+
+private:
+    struct Series {
+        std::string name;
+        std::string help;
+        Type type;
+        std::string labels; // e.g. stage="capture"; empty for none
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<LatencyHistogram> histogram;
+        Sampler sampler;
+    };
+
+    std::vector<Series> series;
+
+    static const char* typeName(Type type) {
+        switch (type) {
+        case Type::Counter: return "counter";
+        case Type::Gauge: return "gauge";
+        default: return "summary";
+        }
+    }
+
+    static std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "") {
+        std::string all = labels;
+        if (!extra.empty()) all += (all.empty() ? "" : ",") + extra;
+        return all.empty() ? name : name + "{" + all + "}";
+    }
+
+    Series& add(const std::string& name, const std::string& help, Type type, const std::string& labels) {
+        series.push_back(Series{name, help, type, labels, nullptr, nullptr, nullptr});
+        return series.back();
+    }
+
+public:
+    MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        Series& s = add(name, help, Type::Counter, labels);
+        s.counter = std::make_unique<MetricCounter>();
+        return *s.counter;
+    }
+
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "") {
+        Series& s = add(name, help, Type::Summary, labels);
+        s.histogram = std::make_unique<LatencyHistogram>();
+        return *s.histogram;
+    }
+
+    // A counter or gauge whose value is read from `sampler` at export.
+    void sample(const std::string& name, const std::string& help, Type type, const std::string& labels,
+                Sampler sampler) {
+        add(name, help, type, labels).sampler = std::move(sampler);
+    }
+
+    std::string renderPrometheus() const {
+        std::ostringstream out;
+        out << std::setprecision(9);
+        std::vector<std::string> described;
+        auto describe = [&](const std::string& name, const std::string& help, const char* type) {
+            if (std::find(described.begin(), described.end(), name) != described.end()) return;
+            described.push_back(name);
+            out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+        };
+
+        // Families must be contiguous, so emit series grouped by name in
+        // registration order.
+        std::vector<std::string> names;
+        for (const Series& s : series) {
+            if (std::find(names.begin(), names.end(), s.name) == names.end()) names.push_back(s.name);
+        }
+        for (const std::string& name : names) {
+            for (const Series& s : series) {
+                if (s.name != name) continue;
+                describe(s.name, s.help, typeName(s.type));
+                if (s.counter) {
+                    out << withLabels(s.name, s.labels) << ' ' << s.counter->value.load(std::memory_order_relaxed)
+                        << '\n';
+                } else if (s.sampler) {
+                    out << withLabels(s.name, s.labels) << ' ' << s.sampler() << '\n';
+                } else if (s.histogram) {
+                    LatencyHistogram::Snapshot snap = s.histogram->snapshot();
+                    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+                        std::ostringstream quantile;
+                        quantile << "quantile=\"" << q << "\"";
+                        out << withLabels(s.name, s.labels, quantile.str()) << ' ' << snap.quantileNs(q) * 1e-9
+                            << '\n';
+                    }
+                    out << withLabels(s.name + "_sum", s.labels) << ' ' << snap.sumNs * 1e-9 << '\n';
+                    out << withLabels(s.name + "_count", s.labels) << ' ' << snap.count << '\n';
+                }
+            }
+        }
+
+        for (const std::string& name : names) {
+            for (const Series& s : series) {
+                if (s.name != name || !s.histogram) continue;
+                describe(s.name + "_max", "Largest observation of " + s.name, "gauge");
+                out << withLabels(s.name + "_max", s.labels) << ' ' << s.histogram->snapshot().maxNs * 1e-9 << '\n';
+            }
+        }
+        return out.str();
+    }
+
+    // Write atomically (temp file + rename), so a scraper such as the
+    // node_exporter textfile collector never reads a partial file.
+    bool writeFile(const std::string& path) const {
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            if (!out) return false;
+            out << renderPrometheus();
+            if (!out) return false;
+        }
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+};
@@ -0,0 +1,313 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "fleet_simulation.hpp"
+#include "floating_monitor.hpp"
+#include "heap_audit.hpp"
+#include "monitor_app.hpp"
+#include "work_stealing_pool.hpp"
+
+using namespace std;
+
+bool parseArguments(int argc, char** argv, CommandLineOptions& options) {
+    InferenceConfig& config = options.inference;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        string value = argv[++i];
+
+        if (arg == "--backend") {
+            options.useDnn = value == "dnn";
+            if (!options.useDnn && value != "dataset") {
+                cerr << "Unknown backend: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--model") {
+            config.modelPath = value;
+        } else if (arg == "--config") {
+            config.configPath = value;
+        } else if (arg == "--classes") {
+            config.classNamesPath = value;
+        } else if (arg == "--input") {
+            if (sscanf(value.c_str(), "%dx%d", &config.inputWidth, &config.inputHeight) != 2) {
+                cerr << "Invalid input size: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--conf") {
+            config.confidenceThreshold = stof(value);
+        } else if (arg == "--nms") {
+            config.nmsThreshold = stof(value);
+        } else if (arg == "--console") {
+            options.consoleLogging = value != "off";
+        } else if (arg == "--simulate") {
+            options.simulateHours = stof(value);
+        } else if (arg == "--fleet") {
+            options.fleetBuoys = stoul(value);
+        } else if (arg == "--threads") {
+            options.threads = static_cast<unsigned>(stoul(value));
+        } else if (arg == "--alerts") {
+            options.alertRulesPath = value;
+        } else if (arg == "--metrics") {
+            options.metricsPath = value;
+        } else if (arg == "--cameras") {
+            string error;
+            if (!parseCameraList(value, options.cameras, error)) {
+                cerr << "Invalid --cameras: " << error << endl;
+                return false;
+            }
+        } else if (arg == "--follow-datasets") {
+            options.followDatasets = value == "on";
+        } else if (arg == "--batch-deadline") {
+            options.batchDeadline = chrono::milliseconds(stoi(value));
+        } else if (arg == "--motion-gate") {
+            if (value == "off") {
+                options.motionGate.enabled = false;
+            } else if (!parseMotionSensitivity(value == "on" ? "medium" : value, options.motionGate)) {
+                cerr << "Unknown motion gate sensitivity: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--track") {
+            options.tracking.enabled = value != "off";
+            if (options.tracking.enabled) {
+                options.tracking.detectEvery = static_cast<unsigned>(stoul(value));
+                if (options.tracking.detectEvery == 0) {
+                    cerr << "--track needs a detector interval of at least 1" << endl;
+                    return false;
+                }
+            }
+        } else if (arg == "--record") {
+            options.recordPath = value;
+        } else if (arg == "--replay") {
+            options.replayPath = value;
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(stoul(value));
+            options.haveSeed = true;
+        } else if (arg == "--archive") {
+            options.archiveFrames = value != "off";
+            if (options.archiveFrames) options.archive.directory = value;
+        } else if (arg == "--archive-quality") {
+            options.archive.jpegQuality = stoi(value);
+            if (options.archive.jpegQuality < 1 || options.archive.jpegQuality > 100) {
+                cerr << "--archive-quality must be 1-100" << endl;
+                return false;
+            }
+        } else if (arg == "--archive-crop") {
+            options.archive.cropToDetections = value == "on";
+        } else if (arg == "--archive-budget") {
+            options.archive.budgetBytes = stoull(value) * 1024 * 1024;
+        } else if (arg == "--assert-no-alloc") {
+            options.assertNoAllocations = true;
+            options.allocationWarmup = static_cast<unsigned>(stoul(value));
+        } else if (arg == "--history") {
+            options.historyPath = value == "off" ? "" : value;
+        } else if (arg == "--replay-waste" || arg == "--replay-marine") {
+            string error;
+            if (!parseDatasetFilter(value, arg == "--replay-waste" ? options.wasteFilter : options.marineFilter, error)) {
+                cerr << "Invalid filter for " << arg << ": " << error << endl;
+                return false;
+            }
+        } else if (arg == "--scheduler") {
+            options.adaptiveScheduling = value != "fixed";
+            if (options.adaptiveScheduling && value != "adaptive") {
+                cerr << "Unknown scheduler: " << value << endl;
+                return false;
+            }
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return false;
+        }
+    }
+    // Replay decodes the trace on the control loop, which allocates.
+    if (options.assertNoAllocations &&
+        (options.fleetBuoys > 0 || options.simulateHours <= 0 || !options.replayPath.empty())) {
+        cerr << "--assert-no-alloc needs --simulate (and no --fleet or --replay)" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Fleet mode shares one copy of the datasets between all buoys.
+int runFleet(const CommandLineOptions& options) {
+    AquaticDetector detector;
+    FleetConfig config;
+    config.buoys = options.fleetBuoys;
+    float hours = options.simulateHours > 0 ? options.simulateHours : 168.0f;
+
+    WorkStealingPool pool(options.threads);
+    auto waste = detector.getWasteDataset();
+    auto marine = detector.getMarineDataset();
+    FleetSimulation fleet(config, waste.get(), marine.get());
+    FleetStats stats = fleet.run(pool, hours);
+
+    cout << fixed << setprecision(1);
+    cout << "Fleet: " << stats.buoys << " buoys, " << stats.simulatedHours << " h on " << pool.threadCount()
+         << " threads in " << stats.wallSeconds << " s (" << stats.buoyHoursPerSecond() << " buoy-hours/sec)" << endl;
+    cout << "  detections " << stats.detections << ", marine " << stats.marineSightings << ", waste "
+         << stats.wasteCollected << "/" << stats.wasteDetected << " collected, skipped " << stats.skippedEvents
+         << endl;
+    cout << "  sensor reads " << stats.envReadings << ", pH alarms " << stats.phAlarms << ", turbidity alarms "
+         << stats.turbidityAlarms << endl;
+    cout << "  energy harvested " << stats.energyHarvestedWh / 1000.0 << " kWh, used "
+         << stats.energyUsedWh / 1000.0 << " kWh" << endl;
+    cout << "  battery mean " << stats.meanChargePercent << "%, min " << stats.minChargePercent << "%, "
+         << stats.buoysDown << " buoys down" << endl;
+    cout << "  " << stats.tasks << " tasks, " << stats.steals << " stolen" << endl;
+    return 0;
+}
+
+// run() with the iterations after the first `warmup` counted for heap
+// allocations on this thread, which in simulation does all the capture,
+// detection and action work. Returns false if there were any.
+static bool runAllocationCheck(FloatingAquaticMonitor& monitor, unsigned warmup) {
+    if (!heap_audit::isInstalled()) {
+        cerr << "--assert-no-alloc: heap counting is not linked into this executable" << endl;
+        return false;
+    }
+    uint64_t iterations = 0, checked = 0, allocations = 0, firstIteration = 0;
+    monitor.beginRun();
+    for (bool more = true; more; ++iterations) {
+        if (iterations < warmup) {
+            more = monitor.runIteration();
+            continue;
+        }
+        heap_audit::Guard guard;
+        more = monitor.runIteration();
+        if (guard.allocations() && !allocations) firstIteration = iterations;
+        allocations += guard.allocations();
+        ++checked;
+    }
+    monitor.endRun();
+
+    cout << "Heap: " << allocations << " allocations in " << checked << " iterations after " << warmup
+         << " warm-up iterations";
+    if (allocations) cout << " (first in iteration " << firstIteration << ")";
+    cout << endl;
+    return allocations == 0;
+}
+
+int runMonitor(const CommandLineOptions& options) {
+    FloatingAquaticMonitor monitor;
+    monitor.setConsoleLogging(options.consoleLogging);
+    monitor.setAdaptiveScheduling(options.adaptiveScheduling);
+
+    PipelineConfig pipeline;
+    if (!options.cameras.empty()) pipeline.cameras = options.cameras;
+    pipeline.batchDeadline = options.batchDeadline;
+    pipeline.motionGate = options.motionGate;
+    pipeline.tracking = options.tracking;
+    monitor.setPipelineConfig(pipeline);
+    if (!options.alertRulesPath.empty() && !monitor.loadAlertRules(options.alertRulesPath)) {
+        return 1;
+    }
+
+    if (!options.metricsPath.empty()) {
+        monitor.enableMetrics(options.metricsPath);
+    }
+
+    if (options.followDatasets) {
+        monitor.followDatasets();
+    }
+
+    if (options.archiveFrames && !monitor.archiveFrames(options.archive)) {
+        return 1;
+    }
+
+    if (!options.historyPath.empty()) {
+        monitor.openHistory(options.historyPath); // optional: monitoring continues without it
+    }
+
+    {
+        AquaticDetector& detector = monitor.getDetector();
+        string error;
+        if (!detector.setWasteReplayFilter(options.wasteFilter, error) ||
+            !detector.setMarineReplayFilter(options.marineFilter, error)) {
+            cerr << "Replay filter: " << error << endl;
+            return 1;
+        }
+        if (!options.wasteFilter.empty() || !options.marineFilter.empty()) {
+            cout << "Replaying " << detector.getWasteReplaySize() << " waste and "
+                 << detector.getMarineReplaySize() << " marine rows" << endl;
+        }
+    }
+
+    if (options.useDnn && !monitor.getDetector().useDnnBackend(options.inference)) {
+        return 1;
+    }
+
+    if (!options.recordPath.empty()) {
+        uint32_t seed = options.haveSeed ? options.seed : static_cast<uint32_t>(time(nullptr));
+        monitor.recordTrace(options.recordPath, seed);
+    }
+    if (!options.replayPath.empty() && !monitor.replayTrace(options.replayPath)) {
+        cerr << "Cannot read trace " << options.replayPath << endl;
+        return 1;
+    }
+
+    if (!monitor.initialize()) {
+        cerr << "Failed to initialize monitoring system" << endl;
+        return 1;
+    }
+
+    if (options.simulateHours > 0 || !options.replayPath.empty()) {
+        if (options.replayPath.empty()) monitor.simulate(options.simulateHours);
+        if (options.assertNoAllocations) {
+            if (!runAllocationCheck(monitor, options.allocationWarmup)) return 1;
+        } else {
+            monitor.run();
+        }
+        SimulationStats sim = monitor.getSimulationStats();
+        cout << fixed << setprecision(1) << "Simulated " << sim.simulatedHours << " h in " << sim.wallSeconds << " s ("
+             << sim.hoursPerWallSecond() << " simulated hours/sec)" << endl;
+        if (!options.replayPath.empty()) {
+            TraceStats replayed = monitor.getTraceStats();
+            double seconds = max(sim.wallSeconds, 1e-9);
+            cout << "Replayed " << replayed.records() << " records (" << replayed.environment << " sensor samples, "
+                 << replayed.frames << " frames, " << replayed.detections << " detection sets): "
+                 << replayed.frames / seconds << " frames/sec" << endl;
+        }
+    } else {
+        thread monitorThread([&monitor]() {
+            try {
+                monitor.run();
+            } catch (const exception& e) {
+                cerr << "Monitor thread exception: " << e.what() << endl;
+            }
+        });
+
+        this_thread::sleep_for(chrono::minutes(5));
+
+        monitor.stop();
+        if (monitorThread.joinable()) {
+            monitorThread.join();
+        }
+    }
+
+    if (!options.recordPath.empty()) {
+        TraceStats recorded = monitor.getTraceStats();
+        cout << "Recorded " << recorded.records() << " records (" << recorded.environment << " sensor samples, "
+             << recorded.frames << " frames, " << recorded.detections << " detection sets) to "
+             << options.recordPath << ", " << recorded.bytes / 1024 << " KiB" << endl;
+    }
+
+    if (options.archiveFrames) {
+        ArchiveStats archived = monitor.getArchiveStats();
+        cout << "Archived " << archived.written << " frames to " << options.archive.directory << " ("
+             << archived.bytesWritten / 1024 << " KiB, " << archived.evicted << " evicted, " << archived.dropped
+             << " dropped, " << archived.failed << " failed)" << endl;
+    }
+
+    InferenceStats inference = monitor.getDetector().getInferenceStats();
+    cout << "Detector backend " << monitor.getDetector().getBackendName() << ": " << inference.frames
+         << " frames, " << inference.framesPerSecond() << " frames/sec, " << inference.msPerFrame()
+         << " ms/frame" << endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camera_streams.hpp"
+#include "dataset_index.hpp"
+#include "dnn_detector.hpp"
+#include "frame_archive.hpp"
+#include "motion_gate.hpp"
+#include "object_tracker.hpp"
+
+// Entry points behind the aquatic_monitor executable, kept in the library
+// so benchmarks and other tools can drive the same code paths.
+
+struct CommandLineOptions {
+    bool useDnn = false;
+    InferenceConfig inference;
+    bool consoleLogging = true;
+    float simulateHours = 0.0f;
+    size_t fleetBuoys = 0;
+    unsigned threads = 0;
+    bool adaptiveScheduling = true;
+    std::string alertRulesPath;
+    std::string historyPath = "aquatic_history.aqts";
+    std::string metricsPath;
+    bool followDatasets = false;
+    std::vector<CameraConfig> cameras; // empty: one camera, as before
+    std::chrono::milliseconds batchDeadline{50};
+    MotionGateConfig motionGate;
+    TrackerConfig tracking;
+    std::string recordPath;
+    std::string replayPath;
+    uint32_t seed = 0;
+    bool haveSeed = false;
+    bool archiveFrames = false;
+    ArchiveConfig archive;
+    bool assertNoAllocations = false;
+    unsigned allocationWarmup = 0; // control loop iterations
+    DatasetFilter wasteFilter;
+    DatasetFilter marineFilter;
+};
+
+// Command-line options:
+//   --backend dataset|dnn   detection engine (default: dataset replay)
+//   --model PATH            ONNX model, or Darknet weights with --config
+//   --config PATH           Darknet .cfg
+//   --classes PATH          class names, one per line, "marine:"/"waste:" prefixed
+//   --input WxH             network input resolution (default 640x640)
+//   --conf VALUE            confidence threshold (default 0.5)
+//   --nms VALUE             NMS IoU threshold (default 0.45)
+//   --console on|off        mirror log records to stdout (default on)
+//   --simulate HOURS        run HOURS of simulated time on a virtual clock, then exit
+//   --fleet N               simulate N buoys instead of one (default 168 h)
+//   --threads N             fleet worker threads (default: one per core)
+//   --scheduler adaptive|fixed  power-aware detection scheduling (default adaptive)
+//   --alerts PATH           environmental alert rules (default: pH 6.5-8.5, turbidity 50, z-score 4)
+//   --history PATH|off      compressed environment/detection history (default aquatic_history.aqts)
+//   --replay-waste FILTER   replay only matching waste rows, e.g. "wasteType=Plastic,locationType=River"
+//   --replay-marine FILTER  replay only matching marine rows, e.g. "animalSpecies=Tuna,confidence>=80"
+//   --metrics PATH          write Prometheus-format metrics to PATH every 10 s (default: off)
+//   --cameras LIST|buoy     capture streams as name:marine|waste|either,...; "buoy" for
+//                           above-water, below-water and conveyor-inlet (default: one camera)
+//   --batch-deadline MS     longest a frame waits to share a detector call (default 50)
+//   --follow-datasets on|off  ingest rows appended to the dataset CSVs while running (default off)
+//   --motion-gate off|on|low|medium|high  skip detection on frames without motion; "on" is
+//                           medium sensitivity (default off)
+//   --track N|off           track objects across frames, running the detector on every Nth
+//                           frame and predicting the rest; each object is logged and
+//                           collected once (default off)
+//   --record PATH           write the run's sensor samples, frames and detections to a trace
+//   --seed N                rand() seed for a recorded run (default: the time)
+//   --replay PATH           rerun a recorded trace on a virtual clock, as fast as possible
+//   --archive DIR|off       save frames with newly detected objects as JPEGs under DIR (default off)
+//   --archive-quality Q     JPEG quality 1-100 (default 90)
+//   --archive-crop on|off   save only the detections' region of the frame (default off)
+//   --archive-budget MB     delete the oldest archived frames beyond MB (default 512)
+//   --assert-no-alloc N     with --simulate: fail if the control loop allocates from the
+//                           heap after N warm-up iterations
+bool parseArguments(int argc, char** argv, CommandLineOptions& options);
+
+// Simulate options.fleetBuoys buoys and print the fleet summary.
+int runFleet(const CommandLineOptions& options);
+
+// Run one monitor: options.simulateHours on a virtual clock, or five
+// minutes in real time. Returns the process exit code.
+int runMonitor(const CommandLineOptions& options);
@@ -0,0 +1,570 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dataset_snapshot.hpp" // Checksum64
+#include "detection_types.hpp"
+#include "dnn_detector.hpp"     // DetectionPair
+#include "timeseries_store.hpp" // tsz::zigzag
+
+// Everything a monitor run took from the outside world, in the order it
+// happened: sensor samples, which image each camera captured (and whether
+// as a marine or waste frame), and what the detector found in it, plus
+// the RNG seed and start time. Replaying a trace reproduces the run
+// without the datasets' cursors, the sensors or the detector.
+
+struct TraceHeader {
+    uint32_t seed = 0;
+    std::chrono::system_clock::time_point start;
+    float hours = 0.0f; // simulated length of the run; 0 for a live run
+};
+
+struct TraceFrame {
+    uint32_t camera = 0;
+    uint64_t sequence = 0; // per camera, counting every capture
+    bool isMarine = false;
+    std::string image;
+    int64_t time = 0;
+};
+
+struct TraceDetections {
+    uint32_t camera = 0;
+    uint64_t sequence = 0; // of the frame they were found in
+    DetectionPair detections;
+};
+
+struct TraceStats {
+    uint64_t environment = 0;
+    uint64_t frames = 0;
+    uint64_t detections = 0; // frames' worth
+    uint64_t blocks = 0;
+    uint64_t bytes = 0;
+
+    uint64_t records() const { return environment + frames + detections; }
+};
+
+namespace trace {
+
+enum class RecordType : uint8_t { Environment = 1, Frame = 2, Detections = 3 };
+
+constexpr char kFileMagic[4] = {'A', 'Q', 'T', 'R'};
+constexpr char kBlockMagic[4] = {'A', 'Q', 'T', 'K'};
+constexpr uint8_t kVersion = 1;
+
+struct FileHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t seed;
+    float hours;
+    int64_t startNanos; // since the epoch
+    uint64_t checksum;   // over every byte before this field
+};
+
+// Records are appended to a block until it reaches blockBytes, then the
+// block is written in one go behind this header. Strings are interned per
+// block, so every block decodes on its own and a reader can start at any.
+struct BlockHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t recordCount;
+    uint32_t payloadBytes;
+    int64_t firstTime; // seconds; record times are deltas from here
+    int64_t lastTime;
+    uint64_t payloadChecksum;
+    uint64_t headerChecksum; // over every byte before this field
+};
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline void putFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits = tsz::floatBits(value);
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+}
+
+// Bounds-checked cursor over one block's payload; a short read sets `ok`
+// to false and yields zeros.
+struct Cursor {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    uint8_t byte() {
+        if (pos >= size) return ok = false, 0;
+        return data[pos++];
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    float number() {
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) bits |= static_cast<uint32_t>(byte()) << (8 * i);
+        return tsz::bitsFloat(bits);
+    }
+
+    std::string text(size_t length) {
+        if (length > size - std::min(pos, size)) return ok = false, std::string();
+        std::string s(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return s;
+    }
+};
+
+template <typename Header>
+uint64_t headerChecksum(const Header& header) {
+    return Checksum64::of(&header, offsetof(Header, checksum));
+}
+
+inline uint64_t headerChecksum(const BlockHeader& header) {
+    return Checksum64::of(&header, offsetof(BlockHeader, headerChecksum));
+}
+
+} // namespace trace
+
+// Appends records to a trace file. Thread-safe: capture, detect and the
+// control loop each record from their own thread in a live run. A crash
+// loses at most the unsealed block; readers skip a torn tail.
+class TraceWriter {
+private:
+    FILE* file = nullptr;
+    size_t blockBytes = 64 * 1024;
+    std::vector<uint8_t> payload;
+    std::unordered_map<std::string, uint32_t> strings; // this block's
+    uint32_t recordCount = 0;
+    int64_t firstTime = 0;
+    int64_t lastTime = 0;
+    int64_t previousTime = 0;
+    TraceStats stats;
+    mutable std::mutex writerMutex;
+
+    // Caller holds writerMutex.
+    void beginRecord(trace::RecordType type, int64_t time) {
+        if (recordCount == 0) firstTime = previousTime = lastTime = time;
+        payload.push_back(static_cast<uint8_t>(type));
+        trace::putVarint(payload, tsz::zigzag(time - previousTime));
+        previousTime = time;
+        lastTime = std::max(lastTime, time);
+    }
+
+    void putString(const std::string& s) {
+        auto it = strings.find(s);
+        if (it != strings.end()) {
+            trace::putVarint(payload, it->second);
+            return;
+        }
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        strings.emplace(s, id);
+        trace::putVarint(payload, id);
+        trace::putVarint(payload, s.size());
+        payload.insert(payload.end(), s.begin(), s.end());
+    }
+
+    void putDetections(const std::vector<DetectionResult>& detections, int64_t time) {
+        trace::putVarint(payload, detections.size());
+        for (const DetectionResult& detection : detections) {
+            putString(detection.label);
+            putString(detection.activity);
+            trace::putFloat(payload, detection.confidence);
+            trace::putFloat(payload, detection.size);
+            trace::putVarint(payload, tsz::zigzag(static_cast<int64_t>(detection.timestamp) - time));
+            trace::putVarint(payload, tsz::zigzag(detection.box.x));
+            trace::putVarint(payload, tsz::zigzag(detection.box.y));
+            trace::putVarint(payload, tsz::zigzag(detection.box.width));
+            trace::putVarint(payload, tsz::zigzag(detection.box.height));
+        }
+    }
+
+    void endRecord() {
+        ++recordCount;
+        if (payload.size() >= blockBytes) seal();
+    }
+
+    // Caller holds writerMutex.
+    bool seal() {
+        if (!file || recordCount == 0) return true;
+        trace::BlockHeader header;
+        std::memset(static_cast<void*>(&header), 0, sizeof(header)); // padding too: it is checksummed
+        std::memcpy(header.magic, trace::kBlockMagic, sizeof(header.magic));
+        header.version = trace::kVersion;
+        header.recordCount = recordCount;
+        header.payloadBytes = static_cast<uint32_t>(payload.size());
+        header.firstTime = firstTime;
+        header.lastTime = lastTime;
+        header.payloadChecksum = Checksum64::of(payload.data(), payload.size());
+        header.headerChecksum = trace::headerChecksum(header);
+
+        payload.insert(payload.begin(), reinterpret_cast<const uint8_t*>(&header),
+                       reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+        bool ok = std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() && std::fflush(file) == 0;
+        if (ok) {
+            stats.bytes += payload.size();
+            ++stats.blocks;
+        }
+        payload.clear();
+        strings.clear();
+        recordCount = 0;
+        return ok;
+    }
+
+public:
+    TraceWriter() = default;
+    ~TraceWriter() { close(); }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Truncates `path`. blockBytes trades seek granularity for overhead.
+    bool open(const std::string& path, const TraceHeader& header, size_t blockSize = 64 * 1024) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        blockBytes = blockSize;
+        stats = TraceStats();
+
+        trace::FileHeader fileHeader;
+        std::memset(static_cast<void*>(&fileHeader), 0, sizeof(fileHeader));
+        std::memcpy(fileHeader.magic, trace::kFileMagic, sizeof(fileHeader.magic));
+        fileHeader.version = trace::kVersion;
+        fileHeader.seed = header.seed;
+        fileHeader.hours = header.hours;
+        fileHeader.startNanos =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(header.start.time_since_epoch()).count();
+        fileHeader.checksum = trace::headerChecksum(fileHeader);
+        stats.bytes = sizeof(fileHeader);
+        return std::fwrite(&fileHeader, sizeof(fileHeader), 1, file) == 1;
+    }
+
+    bool isOpen() const {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return file != nullptr;
+    }
+
+    void recordEnvironment(const EnvironmentalData& data) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!file) return;
+        beginRecord(trace::RecordType::Environment, data.timestamp);
+        trace::putFloat(payload, data.temperature);
+        trace::putFloat(payload, data.turbidity);
+        trace::putFloat(payload, data.pH);
+        trace::putFloat(payload, data.salinity);
+        ++stats.environment;
+        endRecord();
+    }
+
+    void recordFrame(const TraceFrame& frame) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!file) return;
+        beginRecord(trace::RecordType::Frame, frame.time);
+        trace::putVarint(payload, frame.camera);
+        trace::putVarint(payload, frame.sequence);
+        payload.push_back(frame.isMarine ? 1 : 0);
+        putString(frame.image);
+        ++stats.frames;
+        endRecord();
+    }
+
+    void recordDetections(uint32_t camera, uint64_t sequence, int64_t time, const DetectionPair& detections) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!file) return;
+        beginRecord(trace::RecordType::Detections, time);
+        trace::putVarint(payload, camera);
+        trace::putVarint(payload, sequence);
+        putDetections(detections.first, time);
+        putDetections(detections.second, time);
+        ++stats.detections;
+        endRecord();
+    }
+
+    // Seal the current block without closing.
+    bool flush() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return seal();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!file) return;
+        seal();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    TraceStats getStats() const {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        TraceStats current = stats;
+        current.bytes += payload.size(); // not yet sealed
+        return current;
+    }
+};
+
+// Reads a trace back one block at a time. open() only walks the block
+// headers, so seek() can jump to any time without decoding what precedes
+// it. Each kind of record is queued separately (frames and detections per
+// camera), which lets a replay consume them in a different interleaving
+// than a threaded live run wrote them. Not thread-safe.
+class TraceReader {
+private:
+    struct BlockInfo {
+        trace::BlockHeader header;
+        uint64_t payloadOffset;
+    };
+
+    FILE* file = nullptr;
+    TraceHeader header;
+    std::vector<BlockInfo> blocks;
+    size_t nextBlock = 0;
+    std::vector<uint8_t> payload;
+    std::vector<std::string> strings;
+    std::deque<EnvironmentalData> environment;
+    std::vector<std::deque<TraceFrame>> frames;          // by camera
+    std::vector<std::deque<TraceDetections>> detections; // by camera
+    TraceStats consumed;
+    uint64_t corruptBlocks = 0;
+
+    // Detect workers record a camera's detections as they finish, so with
+    // several workers the records can be this many frames out of order.
+    static constexpr uint64_t kReorderWindow = 256;
+
+    template <typename T>
+    static std::deque<T>& forCamera(std::vector<std::deque<T>>& queues, uint32_t camera) {
+        if (queues.size() <= camera) queues.resize(camera + 1);
+        return queues[camera];
+    }
+
+    bool readString(trace::Cursor& in, std::string& out) {
+        uint64_t id = in.varint();
+        if (id < strings.size()) {
+            out = strings[id];
+        } else if (id == strings.size()) {
+            out = in.text(in.varint());
+            strings.push_back(out);
+        } else {
+            in.ok = false;
+        }
+        return in.ok;
+    }
+
+    void readDetections(trace::Cursor& in, int64_t time, std::vector<DetectionResult>& out) {
+        uint64_t count = in.varint();
+        for (uint64_t i = 0; i < count && in.ok; ++i) {
+            DetectionResult detection;
+            readString(in, detection.label);
+            readString(in, detection.activity);
+            detection.confidence = in.number();
+            detection.size = in.number();
+            detection.timestamp = static_cast<time_t>(time + tsz::unzigzag(in.varint()));
+            detection.box.x = static_cast<int>(tsz::unzigzag(in.varint()));
+            detection.box.y = static_cast<int>(tsz::unzigzag(in.varint()));
+            detection.box.width = static_cast<int>(tsz::unzigzag(in.varint()));
+            detection.box.height = static_cast<int>(tsz::unzigzag(in.varint()));
+            out.push_back(std::move(detection));
+        }
+    }
+
+    // Decode the next block into the queues. False at the end of the
+    // trace, or at a block whose payload fails its checksum.
+    bool loadNextBlock() {
+        if (!file || nextBlock >= blocks.size()) return false;
+        const BlockInfo& block = blocks[nextBlock++];
+        payload.resize(block.header.payloadBytes);
+        if (std::fseek(file, static_cast<long>(block.payloadOffset), SEEK_SET) != 0 ||
+            std::fread(payload.data(), 1, payload.size(), file) != payload.size() ||
+            Checksum64::of(payload.data(), payload.size()) != block.header.payloadChecksum) {
+            ++corruptBlocks;
+            nextBlock = blocks.size();
+            return false;
+        }
+
+        strings.clear();
+        trace::Cursor in{payload.data(), payload.size()};
+        int64_t time = block.header.firstTime;
+        for (uint32_t r = 0; r < block.header.recordCount && in.ok; ++r) {
+            auto type = static_cast<trace::RecordType>(in.byte());
+            time += tsz::unzigzag(in.varint());
+            if (type == trace::RecordType::Environment) {
+                EnvironmentalData data;
+                data.temperature = in.number();
+                data.turbidity = in.number();
+                data.pH = in.number();
+                data.salinity = in.number();
+                data.timestamp = static_cast<time_t>(time);
+                environment.push_back(data);
+            } else if (type == trace::RecordType::Frame) {
+                TraceFrame frame;
+                frame.camera = static_cast<uint32_t>(in.varint());
+                frame.sequence = in.varint();
+                frame.isMarine = in.byte() != 0;
+                readString(in, frame.image);
+                frame.time = time;
+                forCamera(frames, frame.camera).push_back(std::move(frame));
+            } else if (type == trace::RecordType::Detections) {
+                TraceDetections found;
+                found.camera = static_cast<uint32_t>(in.varint());
+                found.sequence = in.varint();
+                readDetections(in, time, found.detections.first);
+                readDetections(in, time, found.detections.second);
+                forCamera(detections, found.camera).push_back(std::move(found));
+            } else {
+                in.ok = false;
+            }
+        }
+        if (!in.ok) ++corruptBlocks;
+        return true;
+    }
+
+public:
+    TraceReader() = default;
+    ~TraceReader() { close(); }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+
+        trace::FileHeader fileHeader;
+        if (std::fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 ||
+            std::memcmp(fileHeader.magic, trace::kFileMagic, sizeof(fileHeader.magic)) != 0 ||
+            fileHeader.version != trace::kVersion || trace::headerChecksum(fileHeader) != fileHeader.checksum) {
+            close();
+            return false;
+        }
+        header.seed = fileHeader.seed;
+        header.hours = fileHeader.hours;
+        header.start = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(fileHeader.startNanos)));
+
+        // Hop from header to header; stop at the first torn or foreign one.
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        uint64_t offset = sizeof(fileHeader);
+        while (offset + sizeof(trace::BlockHeader) <= size) {
+            trace::BlockHeader block;
+            if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0 ||
+                std::fread(&block, sizeof(block), 1, file) != 1 ||
+                std::memcmp(block.magic, trace::kBlockMagic, sizeof(block.magic)) != 0 ||
+                block.version != trace::kVersion || trace::headerChecksum(block) != block.headerChecksum) {
+                break;
+            }
+            uint64_t end = offset + sizeof(block) + block.payloadBytes;
+            if (end > size) break;
+            blocks.push_back({block, offset + sizeof(block)});
+            offset = end;
+        }
+        return true;
+    }
+
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+        blocks.clear();
+        seek(std::numeric_limits<int64_t>::min());
+        consumed = TraceStats();
+    }
+
+    bool isOpen() const { return file != nullptr; }
+    const TraceHeader& getHeader() const { return header; }
+    size_t blockCount() const { return blocks.size(); }
+    uint64_t getCorruptBlocks() const { return corruptBlocks; }
+
+    // Time of the last record, in seconds; from the block index alone.
+    int64_t endTime() const {
+        return blocks.empty() ? std::chrono::system_clock::to_time_t(header.start) : blocks.back().header.lastTime;
+    }
+
+    uint64_t recordCount() const {
+        uint64_t total = 0;
+        for (const BlockInfo& block : blocks) total += block.header.recordCount;
+        return total;
+    }
+
+    // Drop anything queued and continue from the first block holding
+    // records at or after `time` (seconds since the epoch).
+    void seek(int64_t time) {
+        environment.clear();
+        frames.clear();
+        detections.clear();
+        nextBlock = 0;
+        while (nextBlock < blocks.size() && blocks[nextBlock].header.lastTime < time) ++nextBlock;
+    }
+
+    bool nextEnvironment(EnvironmentalData& out) {
+        while (environment.empty()) {
+            if (!loadNextBlock()) return false;
+        }
+        out = environment.front();
+        environment.pop_front();
+        ++consumed.environment;
+        return true;
+    }
+
+    bool nextFrame(uint32_t camera, TraceFrame& out) {
+        while (forCamera(frames, camera).empty()) {
+            if (!loadNextBlock()) return false;
+        }
+        out = std::move(frames[camera].front());
+        frames[camera].pop_front();
+        ++consumed.frames;
+        return true;
+    }
+
+    // What the detector found in `camera`'s frame `sequence`. False if the
+    // trace has nothing for that frame (say the live run dropped it from a
+    // full queue); `out` is then left empty. Records need not be in
+    // sequence order, only within kReorderWindow of it.
+    bool detectionsFor(uint32_t camera, uint64_t sequence, DetectionPair& out) {
+        out.first.clear();
+        out.second.clear();
+        auto& queue = forCamera(detections, camera);
+        for (;;) {
+            // Too far behind to be asked for any more.
+            while (!queue.empty() && queue.front().sequence + kReorderWindow < sequence) queue.pop_front();
+            auto found = std::find_if(queue.begin(), queue.end(),
+                                      [&](const TraceDetections& d) { return d.sequence == sequence; });
+            if (found != queue.end()) {
+                out = std::move(found->detections);
+                queue.erase(found);
+                ++consumed.detections;
+                return true;
+            }
+            // Past the window: the record would have been queued by now.
+            if (!queue.empty() && queue.back().sequence > sequence + kReorderWindow) return false;
+            if (!loadNextBlock()) return false;
+        }
+    }
+
+    // Records handed out so far.
+    TraceStats getConsumed() const { return consumed; }
+};
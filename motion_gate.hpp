@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+// When a captured frame is worth running the detector on. Frames are
+// compared against a slowly updated background at analysisWidth pixels
+// wide, in greyscale.
+struct MotionGateConfig {
+    bool enabled = false;
+    int analysisWidth = 160;           // height follows the frame's aspect ratio
+    double pixelThreshold = 25.0;      // grey-level change for a pixel to count as moving
+    double minChangedFraction = 0.005; // share of moving pixels that makes the frame "changed"
+    double backgroundRate = 0.05;      // how quickly a lasting change becomes background
+    unsigned refreshEvery = 12;        // detect anyway after this many skips in a row (0: never)
+    bool cropToMotion = true;          // send only the moving region when it is small
+    double roiPadding = 0.15;          // added around the region, as a share of its size per side
+    double maxRoiFraction = 0.5;       // crop only if the padded region is at most this much of the frame
+};
+
+// Sensitivity presets for the command line: "low" only reacts to large
+// changes, "high" to a few pixels of movement. Returns false (and leaves
+// `config` alone) for anything else.
+inline bool parseMotionSensitivity(const std::string& text, MotionGateConfig& config) {
+    if (text == "low") {
+        config.pixelThreshold = 40.0;
+        config.minChangedFraction = 0.02;
+    } else if (text == "medium") {
+        config.pixelThreshold = 25.0;
+        config.minChangedFraction = 0.005;
+    } else if (text == "high") {
+        config.pixelThreshold = 12.0;
+        config.minChangedFraction = 0.001;
+    } else {
+        return false;
+    }
+    config.enabled = true;
+    return true;
+}
+
+struct MotionDecision {
+    bool changed = true;
+    double changedFraction = 1.0;
+    cv::Rect region; // what moved, in frame pixels; the whole frame when unknown
+};
+
+struct MotionGateStats {
+    uint64_t frames = 0;
+    uint64_t skipped = 0;
+    uint64_t cropped = 0;
+    double seconds = 0.0; // spent in evaluate()
+
+    double skippedRatio() const { return frames ? static_cast<double>(skipped) / frames : 0.0; }
+};
+
+// Cheap pre-filter in front of the detector, one per camera. Each frame is
+// shrunk (INTER_AREA), converted to grey, blurred and differenced against
+// a running-average background; resize, cvtColor, GaussianBlur, absdiff,
+// threshold, countNonZero and addWeighted all run on OpenCV's vectorised
+// 8-bit paths, so a frame costs a small fraction of a detector pass.
+// evaluate() is for the camera's own capture thread; getStats() may be
+// called from any thread.
+class MotionGate {
+private:
+    MotionGateConfig config;
+    cv::Mat small, grey, diff, mask, background;
+    unsigned skippedInRow = 0;
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> cropped{0};
+    std::atomic<uint64_t> nanoseconds{0};
+
+    // Scale a box found on the small copy back to frame pixels and pad it.
+    cv::Rect toFrame(const cv::Rect& box, const cv::Mat& frame) const {
+        double scaleX = static_cast<double>(frame.cols) / small.cols;
+        double scaleY = static_cast<double>(frame.rows) / small.rows;
+        double padX = box.width * config.roiPadding;
+        double padY = box.height * config.roiPadding;
+        int x0 = static_cast<int>((box.x - padX) * scaleX);
+        int y0 = static_cast<int>((box.y - padY) * scaleY);
+        int x1 = static_cast<int>((box.x + box.width + padX) * scaleX + 0.5);
+        int y1 = static_cast<int>((box.y + box.height + padY) * scaleY + 0.5);
+        return cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, frame.cols, frame.rows);
+    }
+
+public:
+    // Resets the background, so the next frame always counts as changed.
+    void configure(const MotionGateConfig& cfg) {
+        config = cfg;
+        background.release();
+        skippedInRow = 0;
+    }
+
+    const MotionGateConfig& getConfig() const { return config; }
+    bool isEnabled() const { return config.enabled; }
+
+    MotionDecision evaluate(const cv::Mat& frame) {
+        auto started = std::chrono::steady_clock::now();
+        MotionDecision decision;
+        decision.region = cv::Rect(0, 0, frame.cols, frame.rows);
+        if (frame.empty()) return decision;
+
+        int width = std::max(1, std::min(config.analysisWidth, frame.cols));
+        int height = std::max(1, frame.rows * width / frame.cols);
+        cv::resize(frame, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+        if (small.channels() == 3) {
+            cv::cvtColor(small, grey, cv::COLOR_BGR2GRAY);
+        } else {
+            grey = small;
+        }
+        cv::GaussianBlur(grey, grey, cv::Size(3, 3), 0);
+
+        if (background.empty() || background.size() != grey.size()) {
+            background = grey.clone(); // nothing to compare with yet
+        } else {
+            cv::absdiff(grey, background, diff);
+            cv::threshold(diff, mask, config.pixelThreshold, 255, cv::THRESH_BINARY);
+            int moving = cv::countNonZero(mask);
+            decision.changedFraction = static_cast<double>(moving) / mask.total();
+            decision.changed = decision.changedFraction >= config.minChangedFraction;
+            if (decision.changed) decision.region = toFrame(cv::boundingRect(mask), frame);
+            cv::addWeighted(background, 1.0 - config.backgroundRate, grey, config.backgroundRate, 0.0, background);
+        }
+
+        // Slow drift can hide inside the background; look properly now and then.
+        if (decision.changed) {
+            skippedInRow = 0;
+        } else if (config.refreshEvery > 0 && skippedInRow >= config.refreshEvery) {
+            decision.changed = true;
+            skippedInRow = 0;
+        } else {
+            ++skippedInRow;
+            skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+        frames.fetch_add(1, std::memory_order_relaxed);
+        nanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - started).count()),
+                              std::memory_order_relaxed);
+        return decision;
+    }
+
+    // The part of a changed frame to hand the detector: the padded moving
+    // region if cropping is on and it is small enough, else the whole
+    // frame. Boxes found in a crop are relative to its top-left corner.
+    cv::Rect detectorRegion(const cv::Mat& frame, const MotionDecision& decision) {
+        cv::Rect whole(0, 0, frame.cols, frame.rows);
+        double area = static_cast<double>(frame.cols) * frame.rows;
+        if (!config.cropToMotion || decision.region.empty() || decision.region.area() > config.maxRoiFraction * area) {
+            return whole;
+        }
+        cropped.fetch_add(1, std::memory_order_relaxed);
+        return decision.region;
+    }
+
+    MotionGateStats getStats() const {
+        MotionGateStats stats;
+        stats.frames = frames.load(std::memory_order_relaxed);
+        stats.skipped = skipped.load(std::memory_order_relaxed);
+        stats.cropped = cropped.load(std::memory_order_relaxed);
+        stats.seconds = nanoseconds.load(std::memory_order_relaxed) / 1e9;
+        return stats;
+    }
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "detection_types.hpp"
+#include "dnn_detector.hpp"
+
+struct TrackerConfig {
+    bool enabled = false;
+    unsigned detectEvery = 1;   // run the detector on every Nth frame, predict tracks on the rest
+    double iouThreshold = 0.3;  // predicted and detected box must overlap this much to match
+    unsigned maxMissed = 2;     // detector frames a track survives without a match
+};
+
+struct TrackerStats {
+    uint64_t detectedFrames = 0;
+    uint64_t predictedFrames = 0; // detector calls saved
+    uint64_t tracksStarted = 0;
+    uint64_t matches = 0;
+    uint64_t activeTracks = 0;
+    double seconds = 0.0; // association, filtering and propagation
+
+    uint64_t frames() const { return detectedFrames + predictedFrames; }
+    double msPerFrame() const { return frames() ? seconds * 1000.0 / frames() : 0.0; }
+};
+
+// Constant-velocity Kalman filter for one box coordinate. The four axes
+// of a box (centre x/y, width, height) are filtered independently, which
+// keeps each step to a handful of multiplies and no matrix library.
+struct AxisFilter {
+    float x = 0.0f;   // position
+    float v = 0.0f;   // velocity per frame
+    float p00 = 0.0f; // covariance
+    float p01 = 0.0f;
+    float p11 = 0.0f;
+
+    void reset(float z, float measurementVar) {
+        x = z;
+        v = 0.0f;
+        p00 = measurementVar;
+        p01 = 0.0f;
+        p11 = 10.0f * measurementVar; // velocity unknown until the second sighting
+    }
+
+    void predict(float processVar) {
+        x += v;
+        p00 += 2.0f * p01 + p11 + 0.25f * processVar;
+        p01 += p11 + 0.5f * processVar;
+        p11 += processVar;
+    }
+
+    void update(float z, float measurementVar) {
+        float s = p00 + measurementVar;
+        float k0 = p00 / s;
+        float k1 = p01 / s;
+        float residual = z - x;
+        x += k0 * residual;
+        v += k1 * residual;
+        p11 -= k1 * p01;
+        p01 *= 1.0f - k0;
+        p00 *= 1.0f - k0;
+    }
+};
+
+// Gives detections stable IDs across one camera's frames so a floating
+// object is reported, and collected, once. Detections are associated with
+// the tracks' predicted boxes greedily by IoU, marine and waste kept apart.
+// Detections without a box (dataset replay) cannot be associated: each
+// gets a fresh ID and is reported as new. Not thread-safe; the monitor
+// drives it from the action stage, and getStats() may be called anywhere.
+class ObjectTracker {
+private:
+    struct Track {
+        uint32_t id = 0;
+        bool marine = false;
+        AxisFilter cx, cy, w, h;
+        float processVar = 1.0f;
+        float measurementVar = 1.0f;
+        unsigned missed = 0;
+        DetectionResult last;
+
+        cv::Rect box() const {
+            float width = std::max(1.0f, w.x), height = std::max(1.0f, h.x);
+            return cv::Rect(static_cast<int>(cx.x - width / 2), static_cast<int>(cy.x - height / 2),
+                            static_cast<int>(width), static_cast<int>(height));
+        }
+    };
+
+    TrackerConfig config;
+    std::vector<Track> tracks;
+    uint32_t nextId = 1;
+    std::vector<std::tuple<double, size_t, size_t>> candidates; // iou, track, detection
+    std::vector<char> trackMatched, detectionMatched;
+
+    std::atomic<uint64_t> detectedFrames{0};
+    std::atomic<uint64_t> predictedFrames{0};
+    std::atomic<uint64_t> tracksStarted{0};
+    std::atomic<uint64_t> matches{0};
+    std::atomic<uint64_t> activeTracks{0};
+    std::atomic<uint64_t> nanoseconds{0};
+
+    static double iou(const cv::Rect& a, const cv::Rect& b) {
+        double overlap = (a & b).area();
+        double combined = static_cast<double>(a.area()) + b.area() - overlap;
+        return combined > 0 ? overlap / combined : 0.0;
+    }
+
+    void startTrack(DetectionResult& detection, bool marine) {
+        detection.trackId = nextId++;
+        tracksStarted.fetch_add(1, std::memory_order_relaxed);
+        if (detection.box.empty()) return; // nothing to follow
+
+        Track track;
+        track.id = detection.trackId;
+        track.marine = marine;
+        // Noise scales with the box: a few percent of its diagonal.
+        float diagonal = std::hypot(static_cast<float>(detection.box.width), static_cast<float>(detection.box.height));
+        track.measurementVar = std::max(1.0f, 0.05f * diagonal * 0.05f * diagonal);
+        track.processVar = std::max(0.25f, 0.02f * diagonal * 0.02f * diagonal);
+        track.cx.reset(detection.box.x + detection.box.width / 2.0f, track.measurementVar);
+        track.cy.reset(detection.box.y + detection.box.height / 2.0f, track.measurementVar);
+        track.w.reset(static_cast<float>(detection.box.width), track.measurementVar);
+        track.h.reset(static_cast<float>(detection.box.height), track.measurementVar);
+        track.last = detection;
+        tracks.push_back(std::move(track));
+    }
+
+    void associate(std::vector<DetectionResult>& detections, bool marine, std::vector<DetectionResult>& fresh) {
+        candidates.clear();
+        for (size_t t = 0; t < tracks.size(); ++t) {
+            if (tracks[t].marine != marine) continue;
+            cv::Rect predicted = tracks[t].box();
+            for (size_t d = 0; d < detections.size(); ++d) {
+                if (detections[d].box.empty()) continue;
+                double overlap = iou(predicted, detections[d].box);
+                if (overlap >= config.iouThreshold) candidates.emplace_back(overlap, t, d);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+
+        detectionMatched.assign(detections.size(), 0);
+        for (const auto& [overlap, t, d] : candidates) {
+            if (trackMatched[t] || detectionMatched[d]) continue;
+            trackMatched[t] = detectionMatched[d] = 1;
+            Track& track = tracks[t];
+            const cv::Rect& box = detections[d].box;
+            track.cx.update(box.x + box.width / 2.0f, track.measurementVar);
+            track.cy.update(box.y + box.height / 2.0f, track.measurementVar);
+            track.w.update(static_cast<float>(box.width), track.measurementVar);
+            track.h.update(static_cast<float>(box.height), track.measurementVar);
+            track.missed = 0;
+            detections[d].trackId = track.id;
+            track.last = detections[d];
+            matches.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (size_t d = 0; d < detections.size(); ++d) {
+            if (detectionMatched[d]) continue;
+            startTrack(detections[d], marine);
+            fresh.push_back(detections[d]);
+        }
+    }
+
+    void predictAll() {
+        for (Track& track : tracks) {
+            track.cx.predict(track.processVar);
+            track.cy.predict(track.processVar);
+            track.w.predict(track.processVar);
+            track.h.predict(track.processVar);
+        }
+    }
+
+    void addTiming(std::chrono::steady_clock::time_point started) {
+        activeTracks.store(tracks.size(), std::memory_order_relaxed);
+        nanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - started).count()),
+                              std::memory_order_relaxed);
+    }
+
+public:
+    void configure(const TrackerConfig& cfg) {
+        config = cfg;
+        tracks.clear();
+    }
+
+    const TrackerConfig& getConfig() const { return config; }
+    bool isEnabled() const { return config.enabled; }
+
+    // A frame the detector ran on. Every detection gets a track ID;
+    // those that started a new track are also copied to `fresh`. Tracks
+    // unmatched for more than maxMissed detector frames are dropped.
+    void update(DetectionPair& detections, DetectionPair& fresh) {
+        auto started = std::chrono::steady_clock::now();
+        fresh.first.clear();
+        fresh.second.clear();
+        predictAll();
+        trackMatched.assign(tracks.size(), 0);
+        size_t existing = tracks.size(); // new tracks are appended past this
+        associate(detections.first, true, fresh.first);
+        associate(detections.second, false, fresh.second);
+
+        size_t kept = 0;
+        for (size_t t = 0; t < tracks.size(); ++t) {
+            if (t < existing && !trackMatched[t] && ++tracks[t].missed > config.maxMissed) continue;
+            if (kept != t) tracks[kept] = std::move(tracks[t]);
+            ++kept;
+        }
+        tracks.resize(kept);
+        detectedFrames.fetch_add(1, std::memory_order_relaxed);
+        addTiming(started);
+    }
+
+    // A frame the detector skipped: `detections` becomes every live
+    // track at its predicted position. Nothing is fresh.
+    void predict(DetectionPair& detections) {
+        auto started = std::chrono::steady_clock::now();
+        predictAll();
+        detections.first.clear();
+        detections.second.clear();
+        for (const Track& track : tracks) {
+            DetectionResult estimate = track.last;
+            estimate.box = track.box();
+            (track.marine ? detections.first : detections.second).push_back(std::move(estimate));
+        }
+        predictedFrames.fetch_add(1, std::memory_order_relaxed);
+        addTiming(started);
+    }
+
+    TrackerStats getStats() const {
+        TrackerStats stats;
+        stats.detectedFrames = detectedFrames.load(std::memory_order_relaxed);
+        stats.predictedFrames = predictedFrames.load(std::memory_order_relaxed);
+        stats.tracksStarted = tracksStarted.load(std::memory_order_relaxed);
+        stats.matches = matches.load(std::memory_order_relaxed);
+        stats.activeTracks = activeTracks.load(std::memory_order_relaxed);
+        stats.seconds = nanoseconds.load(std::memory_order_relaxed) / 1e9;
+        return stats;
+    }
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What a producer does when the next stage's queue is full.
+enum class OverflowPolicy {
+    Block,      // wait for space (backpressure onto the producer)
+    DropOldest  // evict the oldest queued item so the newest always gets in
+};
+
+// Spin, then yield, then sleep: waiting costs almost nothing when the other
+// side answers within microseconds. For waits that may last minutes, stop
+// pausing once spinning() is false and block instead (see BoundedQueue).
+class Backoff {
+private:
+    unsigned attempt = 0;
+
+public:
+    void pause() {
+        if (attempt < 64) {
+            ++attempt;
+        } else if (attempt < 128) {
+            ++attempt;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    void reset() { attempt = 0; }
+
+    // Still in the spin or yield phase.
+    bool spinning() const { return attempt < 128; }
+};
+
+// Bounded lock-free multi-producer/multi-consumer ring buffer (Vyukov's
+// sequence-number design). Capacity is rounded up to a power of two. Any
+// thread may pop, which is what lets a producer evict under DropOldest.
+template <typename T>
+class BoundedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static constexpr size_t kCacheLine = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(kCacheLine) std::atomic<size_t> enqueuePos{0};
+    alignas(kCacheLine) std::atomic<size_t> dequeuePos{0};
+    alignas(kCacheLine) std::atomic<bool> closed{false};
+    std::atomic<size_t> highWater{0};
+    std::atomic<uint64_t> dropped{0};
+
+    // Waiters that have finished spinning park here. Pushes and pops only
+    // take waitMutex when someone is parked.
+    std::mutex waitMutex;
+    std::condition_variable itemAvailable;
+    std::condition_variable spaceAvailable;
+    std::atomic<unsigned> parkedConsumers{0};
+    std::atomic<unsigned> parkedProducers{0};
+
+    static size_t roundUp(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    void noteDepth() {
+        size_t depth = size();
+        size_t seen = highWater.load(std::memory_order_relaxed);
+        while (depth > seen && !highWater.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {}
+    }
+
+    // The fence pairs with the one in park(): either the waiter sees the
+    // change when it rechecks, or we see it parked and notify.
+    void wake(std::atomic<unsigned>& parked, std::condition_variable& waiters, bool all = false) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed) == 0) return;
+        { std::lock_guard<std::mutex> lock(waitMutex); }
+        if (all) {
+            waiters.notify_all();
+        } else {
+            waiters.notify_one();
+        }
+    }
+
+    template <typename Ready>
+    void park(std::atomic<unsigned>& parked, std::condition_variable& waiters, Ready ready) {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        parked.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        waiters.wait(lock, ready);
+        parked.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+public:
+    explicit BoundedQueue(size_t capacity) : cells(new Cell[roundUp(capacity)]), mask(roundUp(capacity) - 1) {
+        for (size_t i = 0; i <= mask; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool tryPush(T&& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    noteDepth();
+                    wake(parkedConsumers, itemAvailable);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    wake(parkedProducers, spaceAvailable);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Enqueue according to `policy`. Returns false only if the queue was
+    // closed while a blocking push was waiting for space.
+    bool push(T value, OverflowPolicy policy) {
+        Backoff backoff;
+        while (!tryPush(std::move(value))) {
+            if (policy == OverflowPolicy::DropOldest) {
+                T evicted;
+                if (tryPop(evicted)) dropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                if (closed.load(std::memory_order_acquire)) return false;
+                if (backoff.spinning()) {
+                    backoff.pause();
+                } else {
+                    park(parkedProducers, spaceAvailable, [this] { return size() < capacity() || isClosed(); });
+                }
+            }
+        }
+        return true;
+    }
+
+    // Block until an item arrives. Returns false once the queue is closed
+    // and fully drained.
+    bool pop(T& out) {
+        Backoff backoff;
+        while (!tryPop(out)) {
+            if (closed.load(std::memory_order_acquire) && empty()) return false;
+            if (backoff.spinning()) {
+                backoff.pause();
+            } else {
+                park(parkedConsumers, itemAvailable, [this] { return !empty() || isClosed(); });
+            }
+        }
+        return true;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        wake(parkedConsumers, itemAvailable, true);
+        wake(parkedProducers, spaceAvailable, true);
+    }
+    void reopen() { closed.store(false, std::memory_order_release); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+    size_t size() const {
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask + 1; }
+    size_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+// Per-stage counters, updated by the stage's own thread(s) and read by the
+// status reporter. Latency is the stage's processing time per item.
+class StageStats {
+private:
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> totalLatencyNs{0};
+    std::atomic<uint64_t> maxLatencyNs{0};
+
+public:
+    void record(std::chrono::steady_clock::duration latency) {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        processed.fetch_add(1, std::memory_order_relaxed);
+        totalLatencyNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = maxLatencyNs.load(std::memory_order_relaxed);
+        while (ns > seen && !maxLatencyNs.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t processedCount() const { return processed.load(std::memory_order_relaxed); }
+
+    double meanLatencyMs() const {
+        uint64_t n = processedCount();
+        return n ? totalLatencyNs.load(std::memory_order_relaxed) / 1e6 / n : 0.0;
+    }
+
+    double maxLatencyMs() const { return maxLatencyNs.load(std::memory_order_relaxed) / 1e6; }
+};
+
+// A named group of worker threads running the same stage loop.
+class PipelineStage {
+private:
+    std::string stageName;
+    std::vector<std::thread> workers;
+    StageStats stats;
+
+public:
+    explicit PipelineStage(std::string name) : stageName(std::move(name)) {}
+    ~PipelineStage() { join(); }
+
+    void start(unsigned workerCount, const std::function<void()>& loop) {
+        for (unsigned i = 0; i < std::max(1u, workerCount); ++i) workers.emplace_back(loop);
+    }
+
+    void join() {
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+        workers.clear();
+    }
+
+    const std::string& name() const { return stageName; }
+    StageStats& getStats() { return stats; }
+    const StageStats& getStats() const { return stats; }
+};
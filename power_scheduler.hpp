@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "sim_clock.hpp"
+
+// One operating point for the detection loop. Processing power scales
+// with input area, so a half-resolution frame costs a quarter of the
+// processing energy.
+struct DetectionTier {
+    std::string name;
+    float intervalHours;
+    float resolutionScale; // fraction of the configured inference input size
+    bool surplusOnly;      // only worth running when the battery would otherwise spill
+};
+
+struct PowerSchedulerConfig {
+    float horizonHours = 24.0f;
+    float stepHours = 0.25f;
+    float reserveFraction = 0.30f;    // forecast charge must never drop below this
+    float cameraPowerW = 5.0f;
+    float processingPowerW = 10.0f;   // at full resolution
+    float detectionHours = 0.05f;     // camera + processing on-time per detection
+    float sensorEnergyWh = 2.0f * 0.01f;
+    float envReadIntervalHours = 1.0f / 12.0f;
+    float conveyorEnergyWh = 150.0f * 2.0f / 3600.0f; // per collected item
+    float wasteRateSmoothing = 0.1f;  // EWMA weight of the latest detection
+
+    // Most to least energy per hour. Lowering resolution comes before
+    // lowering frequency because it is the cheaper way to save energy.
+    std::vector<DetectionTier> tiers = {
+        {"surplus", 1.0f / 12.0f, 1.0f, true},
+        {"normal", 1.0f / 6.0f, 1.0f, false},
+        {"efficient", 1.0f / 6.0f, 0.5f, false},
+        {"economy", 1.0f / 3.0f, 0.5f, false},
+        {"survival", 1.0f, 0.5f, false},
+    };
+};
+
+// State of the power system the plan starts from.
+struct PowerSnapshot {
+    Clock::time_point now;
+    float chargeWh = 0.0f;
+    float capacityWh = 0.0f;
+    float maxChargeRateW = 0.0f;
+};
+
+struct PowerPlan {
+    DetectionTier tier;
+    bool conveyorEnabled = true;
+    float forecastMinFraction = 0.0f; // lowest charge over the horizon
+    float forecastEndFraction = 0.0f;
+    float forecastSpillWh = 0.0f;     // solar energy lost to a full battery
+};
+
+// Chooses the detection tier and conveyor use for the next stretch of time
+// by forecasting the battery over the horizon with each candidate's load
+// and the panel's expected output. The most useful candidate whose
+// forecast stays above the reserve wins. Collecting waste is the buoy's
+// job, so every tier is tried with the conveyor on before any tier is
+// tried without it.
+class PowerScheduler {
+public:
+    using SolarForecast = std::function<float(Clock::time_point)>; // expected panel output in W
+
+private:
+    PowerSchedulerConfig config;
+    float wastePerDetection = 0.5f;
+
+    struct Forecast {
+        float minFraction;
+        float endFraction;
+        float spillWh;
+    };
+
+    Forecast forecast(const PowerSnapshot& state, const SolarForecast& solar, const DetectionTier& tier,
+                      bool conveyor) const {
+        float loadW = detectionEnergyWh(tier) / tier.intervalHours + config.sensorEnergyWh / config.envReadIntervalHours;
+        if (conveyor) loadW += wastePerDetection * config.conveyorEnergyWh / tier.intervalHours;
+
+        float charge = state.chargeWh;
+        Forecast result{charge / state.capacityWh, 0.0f, 0.0f};
+        int steps = static_cast<int>(std::ceil(config.horizonHours / config.stepHours));
+        for (int i = 0; i < steps; ++i) {
+            Clock::time_point at = state.now + Clock::fromHours((i + 0.5f) * config.stepHours);
+            float inW = std::min(solar(at), state.maxChargeRateW);
+            charge += (inW - loadW) * config.stepHours;
+            if (charge > state.capacityWh) {
+                result.spillWh += charge - state.capacityWh;
+                charge = state.capacityWh;
+            }
+            charge = std::max(charge, 0.0f);
+            result.minFraction = std::min(result.minFraction, charge / state.capacityWh);
+        }
+        result.endFraction = charge / state.capacityWh;
+        return result;
+    }
+
+public:
+    explicit PowerScheduler(const PowerSchedulerConfig& cfg = PowerSchedulerConfig()) : config(cfg) {}
+
+    const PowerSchedulerConfig& getConfig() const { return config; }
+
+    float detectionEnergyWh(const DetectionTier& tier) const {
+        float scale = tier.resolutionScale * tier.resolutionScale;
+        return (config.cameraPowerW + config.processingPowerW * scale) * config.detectionHours;
+    }
+
+    // Feed back how many waste items each detection produced, so the
+    // conveyor's share of the forecast follows what the buoy actually sees.
+    void noteDetection(size_t wasteItems) {
+        wastePerDetection += config.wasteRateSmoothing * (static_cast<float>(wasteItems) - wastePerDetection);
+    }
+
+    float getWastePerDetection() const { return wastePerDetection; }
+
+    PowerPlan plan(const PowerSnapshot& state, const SolarForecast& solar) const {
+        const auto& tiers = config.tiers;
+        PowerPlan best;
+        best.tier = tiers.back();
+        best.conveyorEnabled = false;
+
+        for (bool conveyor : {true, false}) {
+            for (size_t i = 0; i < tiers.size(); ++i) {
+                const DetectionTier& tier = tiers[i];
+                Forecast f = forecast(state, solar, tier, conveyor);
+                if (f.minFraction < config.reserveFraction) continue;
+                if (tier.surplusOnly) {
+                    // Only spend energy the next tier down would waste anyway.
+                    size_t next = std::min(i + 1, tiers.size() - 1);
+                    Forecast baseline = forecast(state, solar, tiers[next], conveyor);
+                    float extraWh = (detectionEnergyWh(tier) / tier.intervalHours -
+                                     detectionEnergyWh(tiers[next]) / tiers[next].intervalHours) *
+                                    config.horizonHours;
+                    if (baseline.spillWh < extraWh) continue;
+                }
+                best.tier = tier;
+                best.conveyorEnabled = conveyor;
+                best.forecastMinFraction = f.minFraction;
+                best.forecastEndFraction = f.endFraction;
+                best.forecastSpillWh = f.spillWh;
+                return best;
+            }
+        }
+
+        // Nothing keeps the reserve: run the cheapest tier and report its forecast.
+        Forecast f = forecast(state, solar, best.tier, false);
+        best.forecastMinFraction = f.minFraction;
+        best.forecastEndFraction = f.endFraction;
+        best.forecastSpillWh = f.spillWh;
+        return best;
+    }
+};
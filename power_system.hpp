@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <mutex>
+
+#include "sim_clock.hpp"
+
+class SolarPanel {
+private:
+    static constexpr float kPi = 3.14159265f;
+
+    float efficiency;
+    float area;
+    float currentOutput;
+    bool isDaytime;
+
+public:
+    SolarPanel(float eff, float a) : efficiency(eff), area(a), currentOutput(0), isDaytime(true) {}
+
+    void update(float sunlightIntensity) {
+        currentOutput = isDaytime ? sunlightIntensity * area * efficiency : 0;
+    }
+
+    // Day from 06:00 to 18:00 local time, intensity peaking at noon.
+    static float sunlightAt(Clock::time_point when, bool& daytime) {
+        time_t t = std::chrono::system_clock::to_time_t(when);
+        tm localTime;
+#ifdef _WIN32
+        localtime_s(&localTime, &t);
+#else
+        localtime_r(&t, &localTime);
+#endif
+        float hour = localTime.tm_hour + localTime.tm_min / 60.0f;
+        daytime = hour >= 6.0f && hour < 18.0f;
+        return daytime ? 500.0f + 300.0f * std::sin((hour - 6.0f) * kPi / 12.0f) : 0.0f;
+    }
+
+    void updateAt(Clock::time_point when) {
+        bool daytime;
+        float intensity = sunlightAt(when, daytime);
+        setDaytime(daytime);
+        update(intensity);
+    }
+
+    // Clear-sky output at `when`, for forecasting.
+    float expectedOutputAt(Clock::time_point when) const {
+        bool daytime;
+        return sunlightAt(when, daytime) * area * efficiency;
+    }
+
+    float getCurrentOutput() const { return currentOutput; }
+    void setDaytime(bool daytime) { isDaytime = daytime; }
+    bool getIsDaytime() const { return isDaytime; }
+};
+
+class Battery {
+private:
+    float capacity;
+    float currentCharge;
+    float maxChargeRate;
+    float energyDrawn = 0.0f; // Wh delivered to loads since startup
+    mutable std::mutex batteryMutex; // shared by the control loop and the pipeline stages
+
+public:
+    Battery(float cap, float maxRate) : capacity(cap), currentCharge(cap * 0.7f), maxChargeRate(maxRate) {}
+
+    void charge(float power, float hours) {
+        std::lock_guard<std::mutex> lock(batteryMutex);
+        float energy = std::min(power, maxChargeRate) * hours;
+        currentCharge = std::min(capacity, currentCharge + energy);
+    }
+
+    bool discharge(float power, float hours) {
+        std::lock_guard<std::mutex> lock(batteryMutex);
+        float energyNeeded = power * hours;
+        if (energyNeeded <= currentCharge) {
+            currentCharge -= energyNeeded;
+            energyDrawn += energyNeeded;
+            return true;
+        }
+        return false;
+    }
+
+    float getChargePercentage() const {
+        std::lock_guard<std::mutex> lock(batteryMutex);
+        return (currentCharge / capacity) * 100.0f;
+    }
+
+    float getChargeWh() const {
+        std::lock_guard<std::mutex> lock(batteryMutex);
+        return currentCharge;
+    }
+
+    float getEnergyDrawnWh() const {
+        std::lock_guard<std::mutex> lock(batteryMutex);
+        return energyDrawn;
+    }
+
+    float getCapacityWh() const { return capacity; }
+    float getMaxChargeRate() const { return maxChargeRate; }
+};
+
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Time source for everything on the buoy that depends on time of day or
+// elapsed hours: solar output, battery integration and the detection /
+// sensor cadences. Time points are system_clock based so calendar logic
+// (day/night, log timestamps) works the same on either clock.
+class Clock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+    using duration = std::chrono::system_clock::duration;
+
+    virtual ~Clock() = default;
+
+    virtual time_point now() const = 0;
+
+    // Block until `deadline`. A virtual clock jumps there instead.
+    virtual void sleepUntil(time_point deadline) = 0;
+
+    virtual bool isVirtual() const = 0;
+
+    void sleepFor(duration d) { sleepUntil(now() + d); }
+
+    static float hoursBetween(time_point from, time_point to) {
+        return std::chrono::duration<float, std::ratio<3600>>(to - from).count();
+    }
+
+    static duration fromHours(float hours) {
+        return std::chrono::duration_cast<duration>(std::chrono::duration<float, std::ratio<3600>>(hours));
+    }
+};
+
+class SystemClock : public Clock {
+public:
+    time_point now() const override { return std::chrono::system_clock::now(); }
+    void sleepUntil(time_point deadline) override { std::this_thread::sleep_until(deadline); }
+    bool isVirtual() const override { return false; }
+};
+
+// Discrete-event clock: time only moves when the simulation driver sleeps,
+// and sleeping is an instant jump to the deadline. Only one thread (the
+// driver) should advance it; any thread may read it.
+class VirtualClock : public Clock {
+private:
+    std::atomic<int64_t> ticks; // system_clock ticks since the epoch
+
+public:
+    explicit VirtualClock(time_point start = std::chrono::system_clock::now())
+        : ticks(start.time_since_epoch().count()) {}
+
+    time_point now() const override { return time_point(duration(ticks.load(std::memory_order_acquire))); }
+
+    void sleepUntil(time_point deadline) override { advanceTo(deadline); }
+
+    bool isVirtual() const override { return true; }
+
+    // Time never runs backwards; an earlier deadline is a no-op.
+    void advanceTo(time_point t) {
+        int64_t target = t.time_since_epoch().count();
+        int64_t seen = ticks.load(std::memory_order_relaxed);
+        while (target > seen && !ticks.compare_exchange_weak(seen, target, std::memory_order_acq_rel)) {}
+    }
+};
+
+// Throughput of a simulation run.
+struct SimulationStats {
+    double simulatedHours = 0.0;
+    double wallSeconds = 0.0;
+    uint64_t events = 0;
+
+    double hoursPerWallSecond() const { return wallSeconds > 0 ? simulatedHours / wallSeconds : 0.0; }
+};
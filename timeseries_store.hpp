@@ -0,0 +1,948 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "dataset_snapshot.hpp" // Checksum64
+#include "detection_types.hpp"
+#include "env_stats.hpp"        // EnvChannel
+
+// Gorilla-style compression primitives (Pelkonen et al., VLDB 2015):
+// delta-of-delta timestamps and XOR-encoded floats, packed MSB-first.
+namespace tsz {
+
+class BitWriter {
+private:
+    std::vector<uint8_t> bytes;
+    uint8_t current = 0;
+    int filled = 0;
+
+public:
+    void write(uint64_t value, int bits) {
+        while (bits > 0) {
+            int space = 8 - filled;
+            int take = std::min(space, bits);
+            uint8_t chunk = static_cast<uint8_t>((value >> (bits - take)) & ((1u << take) - 1));
+            current |= static_cast<uint8_t>(chunk << (space - take));
+            filled += take;
+            bits -= take;
+            if (filled == 8) {
+                bytes.push_back(current);
+                current = 0;
+                filled = 0;
+            }
+        }
+    }
+
+    void writeBit(bool bit) { write(bit ? 1 : 0, 1); }
+
+    void reserve(size_t byteCount) { bytes.reserve(byteCount); }
+
+    // Start a new stream, keeping the buffer's capacity.
+    void clear() {
+        bytes.clear();
+        current = 0;
+        filled = 0;
+    }
+
+    // Pads the last byte with zeros and returns the packed stream.
+    const std::vector<uint8_t>& finish() {
+        if (filled > 0) {
+            bytes.push_back(current);
+            current = 0;
+            filled = 0;
+        }
+        return bytes;
+    }
+};
+
+class BitReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitPos = 0;
+
+public:
+    BitReader(const uint8_t* bytes, size_t length) : data(bytes), size(length) {}
+
+    uint64_t read(int bits) {
+        uint64_t value = 0;
+        while (bits > 0) {
+            size_t byte = bitPos >> 3;
+            int offset = static_cast<int>(bitPos & 7);
+            int available = 8 - offset;
+            int take = std::min(available, bits);
+            uint8_t source = byte < size ? data[byte] : 0;
+            uint8_t chunk = static_cast<uint8_t>((source >> (available - take)) & ((1u << take) - 1));
+            value = (value << take) | chunk;
+            bitPos += take;
+            bits -= take;
+        }
+        return value;
+    }
+
+    bool readBit() { return read(1) != 0; }
+};
+
+inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+// '0' for an unchanged delta, then 7/9/12-bit buckets, else 64 raw bits.
+class TimestampEncoder {
+private:
+    bool started = false;
+    int64_t previous = 0;
+    int64_t previousDelta = 0;
+
+public:
+    void encode(BitWriter& out, int64_t timestamp) {
+        if (!started) {
+            out.write(static_cast<uint64_t>(timestamp), 64);
+            previous = timestamp;
+            started = true;
+            return;
+        }
+        int64_t delta = timestamp - previous;
+        uint64_t dod = zigzag(delta - previousDelta);
+        if (dod == 0) {
+            out.writeBit(false);
+        } else if (dod < (1u << 7)) {
+            out.write(0b10, 2);
+            out.write(dod, 7);
+        } else if (dod < (1u << 9)) {
+            out.write(0b110, 3);
+            out.write(dod, 9);
+        } else if (dod < (1u << 12)) {
+            out.write(0b1110, 4);
+            out.write(dod, 12);
+        } else {
+            out.write(0b1111, 4);
+            out.write(dod, 64);
+        }
+        previousDelta = delta;
+        previous = timestamp;
+    }
+};
+
+class TimestampDecoder {
+private:
+    bool started = false;
+    int64_t previous = 0;
+    int64_t previousDelta = 0;
+
+public:
+    int64_t decode(BitReader& in) {
+        if (!started) {
+            previous = static_cast<int64_t>(in.read(64));
+            started = true;
+            return previous;
+        }
+        uint64_t dod = 0;
+        if (in.readBit()) {
+            int width = 64;
+            if (!in.readBit()) width = 7;
+            else if (!in.readBit()) width = 9;
+            else if (!in.readBit()) width = 12;
+            dod = in.read(width);
+        }
+        previousDelta += unzigzag(dod);
+        previous += previousDelta;
+        return previous;
+    }
+};
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline int leadingZeros32(uint32_t v) {
+    int n = 0;
+    for (uint32_t mask = 0x80000000u; mask && !(v & mask); mask >>= 1) ++n;
+    return n;
+}
+
+inline int trailingZeros32(uint32_t v) {
+    int n = 0;
+    for (uint32_t mask = 1u; mask && !(v & mask); mask <<= 1) ++n;
+    return n;
+}
+
+// XOR with the previous value: '0' if identical; '10' + bits if the
+// meaningful bits fit the previous leading/trailing-zero window; otherwise
+// '11' + 5-bit leading zeros + 5-bit length-1 + the meaningful bits.
+class FloatEncoder {
+private:
+    bool started = false;
+    uint32_t previous = 0;
+    int previousLeading = -1;
+    int previousTrailing = 0;
+
+public:
+    void encode(BitWriter& out, float value) {
+        uint32_t bits = floatBits(value);
+        if (!started) {
+            out.write(bits, 32);
+            previous = bits;
+            started = true;
+            return;
+        }
+        uint32_t x = bits ^ previous;
+        previous = bits;
+        if (x == 0) {
+            out.writeBit(false);
+            return;
+        }
+        out.writeBit(true);
+        int leading = std::min(leadingZeros32(x), 31);
+        int trailing = trailingZeros32(x);
+        if (previousLeading >= 0 && leading >= previousLeading && trailing >= previousTrailing) {
+            out.writeBit(false);
+            out.write(x >> previousTrailing, 32 - previousLeading - previousTrailing);
+            return;
+        }
+        int meaningful = 32 - leading - trailing;
+        out.writeBit(true);
+        out.write(static_cast<uint64_t>(leading), 5);
+        out.write(static_cast<uint64_t>(meaningful - 1), 5);
+        out.write(x >> trailing, meaningful);
+        previousLeading = leading;
+        previousTrailing = trailing;
+    }
+};
+
+class FloatDecoder {
+private:
+    bool started = false;
+    uint32_t previous = 0;
+    int previousLeading = 0;
+    int previousTrailing = 0;
+
+public:
+    float decode(BitReader& in) {
+        if (!started) {
+            previous = static_cast<uint32_t>(in.read(32));
+            started = true;
+            return bitsFloat(previous);
+        }
+        if (!in.readBit()) return bitsFloat(previous);
+        if (in.readBit()) {
+            previousLeading = static_cast<int>(in.read(5));
+            int meaningful = static_cast<int>(in.read(5)) + 1;
+            previousTrailing = 32 - previousLeading - meaningful;
+        }
+        int meaningful = 32 - previousLeading - previousTrailing;
+        uint32_t x = static_cast<uint32_t>(in.read(meaningful)) << previousTrailing;
+        previous ^= x;
+        return bitsFloat(previous);
+    }
+};
+
+inline int bitsFor(size_t distinctValues) {
+    int bits = 0;
+    while ((size_t{1} << bits) < distinctValues) ++bits;
+    return bits;
+}
+
+} // namespace tsz
+
+// min/max/sum over one float column, kept in every block header so that a
+// block wholly inside a query range is answered without decompressing it.
+struct RangeAggregate {
+    uint64_t count = 0;
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    double sum = 0.0;
+
+    void add(float value) {
+        ++count;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+    }
+
+    void merge(const RangeAggregate& other) {
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+    }
+
+    double mean() const { return count ? sum / count : 0.0; }
+};
+
+struct DetectionAggregate {
+    uint64_t marine = 0;
+    uint64_t waste = 0;
+    RangeAggregate confidence;
+    RangeAggregate size;
+};
+
+// How much of the store a query touched.
+struct QueryCost {
+    uint64_t blocksSkipped = 0;   // outside the range
+    uint64_t blocksFromIndex = 0; // answered from header aggregates
+    uint64_t blocksDecoded = 0;   // partially overlapping, decompressed
+};
+
+struct TimeSeriesConfig {
+    size_t blockPoints = 1024; // points per sealed block, per series
+    // Also seal a series once its oldest pending point is this many seconds
+    // older than the newest point appended; 0 seals full blocks only. At a
+    // 5-minute sensor cadence a full block takes 3.5 days, so this bounds
+    // what a crash loses.
+    int64_t maxPendingSeconds = 6 * 3600;
+    bool syncOnSeal = false;   // fsync each sealed block (slower, survives power loss)
+};
+
+struct TimeSeriesStats {
+    uint64_t blocks = 0;
+    uint64_t points = 0;
+    uint64_t pendingPoints = 0; // buffered, not yet sealed
+    uint64_t fileBytes = 0;
+    uint64_t rawBytes = 0;      // the same points as fixed-width records
+    uint64_t recoveredBytes = 0; // torn tail discarded by the last open()
+    uint64_t failedWrites = 0;   // blocks that could not be written; their points stay pending
+
+    double compressionRatio() const { return fileBytes ? static_cast<double>(rawBytes) / fileBytes : 0.0; }
+};
+
+// Append-only, block-structured history of EnvironmentalData and
+// DetectionResult records. Each series buffers up to blockPoints records,
+// then seals them into one compressed block: a fixed header (time range,
+// per-column aggregates, column sizes, checksums) followed by one packed
+// bit stream per column. Blocks are appended with a single write and a
+// flush, and open() drops any torn or corrupt tail, so a crash loses at
+// most the unsealed points (no more than maxPendingSeconds' worth) and
+// never leaves an unreadable file. Range
+// queries use the in-memory block index and only decompress blocks that
+// straddle the range, and only the columns they need.
+class TimeSeriesStore {
+private:
+    enum class SeriesKind : uint8_t { Environment = 1, Detection = 2 };
+
+    static constexpr char kMagic[4] = {'A', 'Q', 'T', 'B'};
+    static constexpr uint8_t kVersion = 1;
+    static constexpr size_t kMaxColumns = 8;
+    static constexpr size_t kEnvRawBytes = sizeof(int64_t) + 4 * sizeof(float);
+    static constexpr size_t kDetectionRawBytes = sizeof(int64_t) + 1 + 2 * sizeof(uint32_t) + 2 * sizeof(float);
+    static constexpr size_t kMaxBitsPerPoint = 68; // a raw timestamp delta and its prefix; floats take at most 44
+    static inline const std::string kNoLabel;
+
+    // Environment columns: time, temperature, turbidity, pH, salinity.
+    // Detection columns: time, kind bit, label id, activity id, confidence,
+    // size, dictionary.
+    struct BlockHeader {
+        char magic[4];
+        uint8_t kind;
+        uint8_t version;
+        uint16_t columnCount;
+        uint32_t pointCount;
+        int64_t minTime;
+        int64_t maxTime;
+        uint32_t columnBytes[kMaxColumns];
+        RangeAggregate aggregates[4]; // env: the four channels; detection: confidence, size
+        uint32_t marineCount;
+        uint32_t wasteCount;
+        uint64_t payloadChecksum;
+        uint64_t headerChecksum; // over every byte before this field
+    };
+
+    struct BlockInfo {
+        BlockHeader header;
+        uint64_t payloadOffset;
+    };
+
+    struct EnvPoint {
+        int64_t time;
+        float values[4];
+    };
+
+    struct DetectionPoint {
+        int64_t time;
+        bool isMarine;
+        const std::string* label; // interned (see intern()) or in a decoded block's dictionary
+        const std::string* activity;
+        float confidence;
+        float size;
+    };
+
+    // Per-block dictionary entry; `block` tells whether `id` belongs to the
+    // block being sealed.
+    struct DictionaryId {
+        uint64_t block = 0;
+        uint32_t id = 0;
+    };
+
+    TimeSeriesConfig config;
+    std::string path;
+    FILE* file = nullptr;
+    std::vector<BlockInfo> index;
+    std::vector<EnvPoint> pendingEnv;
+    std::vector<DetectionPoint> pendingDetections;
+    int64_t envRetryAt = 0; // after a failed time-bound seal, not before this
+    int64_t detectionRetryAt = 0;
+
+    // Reused by every seal, so steady appends do not allocate once the
+    // buffers have grown to a block's size.
+    tsz::BitWriter sealColumns[kMaxColumns];
+    std::vector<uint8_t> sealRecord;
+    std::unordered_map<std::string, DictionaryId> dictionaryIds; // every label and activity appended
+    std::vector<const std::string*> sealDictionary;              // this block's, by id
+    std::vector<uint32_t> sealLabelIds, sealActivityIds;
+    uint64_t sealedDetectionBlocks = 0;
+
+    // Kept open for queries, and their buffers reused, so a status query
+    // that decodes a block does not allocate either.
+    mutable FILE* readFile = nullptr;
+    mutable std::vector<uint8_t> readBytes;
+    mutable std::vector<size_t> readOffsets;
+    uint64_t fileBytes = 0;
+    uint64_t sealedPoints = 0;
+    uint64_t rawBytes = 0;
+    uint64_t recoveredBytes = 0;
+    uint64_t failedWrites = 0;
+    mutable std::mutex storeMutex;
+
+    static uint64_t headerChecksum(const BlockHeader& header) {
+        return Checksum64::of(&header, offsetof(BlockHeader, headerChecksum));
+    }
+
+    static bool validHeader(const BlockHeader& header) {
+        return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+               header.columnCount <= kMaxColumns && headerChecksum(header) == header.headerChecksum;
+    }
+
+    static uint64_t payloadSize(const BlockHeader& header) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < header.columnCount; ++i) total += header.columnBytes[i];
+        return total;
+    }
+
+    static BlockHeader newHeader(SeriesKind kind, size_t columns, size_t points) {
+        BlockHeader header;
+        std::memset(static_cast<void*>(&header), 0, sizeof(header)); // padding too: it is checksummed
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.kind = static_cast<uint8_t>(kind);
+        header.version = kVersion;
+        header.columnCount = static_cast<uint16_t>(columns);
+        header.pointCount = static_cast<uint32_t>(points);
+        header.minTime = std::numeric_limits<int64_t>::max();
+        header.maxTime = std::numeric_limits<int64_t>::min();
+        for (auto& aggregate : header.aggregates) aggregate = RangeAggregate();
+        return header;
+    }
+
+    // Write sealColumns[0, header.columnCount) as one block. Caller holds
+    // storeMutex.
+    bool writeBlock(BlockHeader header) {
+        if (!file) return false;
+        Checksum64 sum;
+        for (size_t i = 0; i < header.columnCount; ++i) {
+            const std::vector<uint8_t>& column = sealColumns[i].finish();
+            header.columnBytes[i] = static_cast<uint32_t>(column.size());
+            sum.update(column.data(), column.size());
+        }
+        header.payloadChecksum = sum.digest();
+        header.headerChecksum = headerChecksum(header);
+
+        std::vector<uint8_t>& record = sealRecord;
+        record.resize(sizeof(header));
+        std::memcpy(record.data(), &header, sizeof(header));
+        for (size_t i = 0; i < header.columnCount; ++i) {
+            const std::vector<uint8_t>& column = sealColumns[i].finish();
+            record.insert(record.end(), column.begin(), column.end());
+        }
+
+        // One write per block: a crash leaves either the whole block or a
+        // tail that open() recognises as torn.
+        if (std::fwrite(record.data(), 1, record.size(), file) != record.size() || std::fflush(file) != 0) {
+            discardPartialWrite();
+            return false;
+        }
+#ifndef _WIN32
+        if (config.syncOnSeal) fsync(fileno(file));
+#endif
+        index.push_back({header, fileBytes + sizeof(header)});
+        fileBytes += record.size();
+        sealedPoints += header.pointCount;
+        return true;
+    }
+
+    // Cut the file back to the last whole block, so that later blocks
+    // land where the index expects them and open() does not stop at a
+    // torn block mid-file. Closing first also drops anything still
+    // buffered. Caller holds storeMutex.
+    void discardPartialWrite() {
+        ++failedWrites;
+        std::fclose(file);
+        std::error_code ec;
+        std::filesystem::resize_file(path, fileBytes, ec);
+        file = ec ? nullptr : std::fopen(path.c_str(), "ab");
+    }
+
+    // The stored copy of `text`; only a label never appended before
+    // allocates. Caller holds storeMutex.
+    const std::string& intern(const std::string& text) {
+        auto it = dictionaryIds.find(text);
+        if (it == dictionaryIds.end()) {
+            it = dictionaryIds.emplace(text, DictionaryId()).first;
+            sealDictionary.reserve(dictionaryIds.size()); // no block can hold more
+        }
+        return it->first;
+    }
+
+    // Caller holds storeMutex.
+    bool sealEnvironment() {
+        if (pendingEnv.empty()) return true;
+        BlockHeader header = newHeader(SeriesKind::Environment, 5, pendingEnv.size());
+        for (size_t i = 0; i < header.columnCount; ++i) sealColumns[i].clear();
+        tsz::BitWriter& time = sealColumns[0];
+        tsz::BitWriter* channels = sealColumns + 1;
+        tsz::TimestampEncoder timeEncoder;
+        tsz::FloatEncoder channelEncoders[4];
+        for (const EnvPoint& point : pendingEnv) {
+            timeEncoder.encode(time, point.time);
+            header.minTime = std::min(header.minTime, point.time);
+            header.maxTime = std::max(header.maxTime, point.time);
+            for (int c = 0; c < 4; ++c) {
+                channelEncoders[c].encode(channels[c], point.values[c]);
+                header.aggregates[c].add(point.values[c]);
+            }
+        }
+        if (!writeBlock(header)) return false; // keep the points for the next attempt
+        rawBytes += pendingEnv.size() * kEnvRawBytes;
+        pendingEnv.clear();
+        return true;
+    }
+
+    static void writeDictionary(tsz::BitWriter& out, const std::vector<const std::string*>& entries) {
+        out.write(entries.size(), 32);
+        for (const std::string* entry : entries) {
+            out.write(entry->size(), 16);
+            for (unsigned char c : *entry) out.write(c, 8);
+        }
+    }
+
+    static std::vector<std::string> readDictionary(tsz::BitReader& in) {
+        std::vector<std::string> entries(static_cast<size_t>(in.read(32)));
+        for (auto& entry : entries) {
+            entry.resize(static_cast<size_t>(in.read(16)));
+            for (char& c : entry) c = static_cast<char>(in.read(8));
+        }
+        return entries;
+    }
+
+    // Caller holds storeMutex.
+    bool sealDetections() {
+        if (pendingDetections.empty()) return true;
+        BlockHeader header = newHeader(SeriesKind::Detection, 7, pendingDetections.size());
+
+        // Labels and activities share one per-block dictionary, numbered
+        // afresh for each block.
+        ++sealedDetectionBlocks;
+        std::vector<const std::string*>& dictionary = sealDictionary;
+        dictionary.clear();
+        auto idOf = [&](const std::string* s) {
+            auto it = dictionaryIds.find(*s);
+            DictionaryId& entry = it->second;
+            if (entry.block != sealedDetectionBlocks) {
+                entry.block = sealedDetectionBlocks;
+                entry.id = static_cast<uint32_t>(dictionary.size());
+                dictionary.push_back(&it->first);
+            }
+            return entry.id;
+        };
+        std::vector<uint32_t>& labelIds = sealLabelIds;
+        std::vector<uint32_t>& activityIds = sealActivityIds;
+        labelIds.clear();
+        activityIds.clear();
+        for (const auto& point : pendingDetections) {
+            labelIds.push_back(idOf(point.label));
+            activityIds.push_back(idOf(point.activity));
+        }
+        int idBits = tsz::bitsFor(dictionary.size());
+
+        for (size_t i = 0; i < header.columnCount; ++i) sealColumns[i].clear();
+        tsz::BitWriter& time = sealColumns[0];
+        tsz::BitWriter& kinds = sealColumns[1];
+        tsz::BitWriter& labels = sealColumns[2];
+        tsz::BitWriter& activities = sealColumns[3];
+        tsz::BitWriter& confidence = sealColumns[4];
+        tsz::BitWriter& size = sealColumns[5];
+        tsz::BitWriter& dict = sealColumns[6];
+        tsz::TimestampEncoder timeEncoder;
+        tsz::FloatEncoder confidenceEncoder, sizeEncoder;
+        for (size_t i = 0; i < pendingDetections.size(); ++i) {
+            const DetectionPoint& point = pendingDetections[i];
+            timeEncoder.encode(time, point.time);
+            kinds.writeBit(point.isMarine);
+            labels.write(labelIds[i], idBits);
+            activities.write(activityIds[i], idBits);
+            confidenceEncoder.encode(confidence, point.confidence);
+            sizeEncoder.encode(size, point.size);
+
+            header.minTime = std::min(header.minTime, point.time);
+            header.maxTime = std::max(header.maxTime, point.time);
+            header.aggregates[0].add(point.confidence);
+            header.aggregates[1].add(point.size);
+            ++(point.isMarine ? header.marineCount : header.wasteCount);
+        }
+        writeDictionary(dict, dictionary);
+
+        if (!writeBlock(header)) return false;
+        rawBytes += pendingDetections.size() * kDetectionRawBytes;
+        pendingDetections.clear();
+        return true;
+    }
+
+    // Seal each series whose oldest pending point is maxPendingSeconds
+    // older than `now`. A failed seal waits as long again before retrying,
+    // rather than rewriting the block on every append.
+    void sealStale(int64_t now) {
+        if (config.maxPendingSeconds <= 0) return;
+        if (!pendingEnv.empty() && now - pendingEnv.front().time >= config.maxPendingSeconds && now >= envRetryAt &&
+            !sealEnvironment()) {
+            envRetryAt = now + config.maxPendingSeconds;
+        }
+        if (!pendingDetections.empty() && now - pendingDetections.front().time >= config.maxPendingSeconds &&
+            now >= detectionRetryAt && !sealDetections()) {
+            detectionRetryAt = now + config.maxPendingSeconds;
+        }
+    }
+
+    // Read the payload of `block`, columns [0, upTo) only,
+    // into readBytes, with column i at [readOffsets[i], readOffsets[i + 1]).
+    // Caller holds storeMutex.
+    bool readColumns(const BlockInfo& block, size_t upTo) const {
+        std::vector<size_t>& offsets = readOffsets;
+        offsets.assign(1, 0);
+        for (size_t i = 0; i < upTo; ++i) offsets.push_back(offsets.back() + block.header.columnBytes[i]);
+        readBytes.resize(offsets.back());
+        if (!readFile && !(readFile = std::fopen(path.c_str(), "rb"))) return false;
+        return std::fseek(readFile, static_cast<long>(block.payloadOffset), SEEK_SET) == 0 &&
+               std::fread(readBytes.data(), 1, readBytes.size(), readFile) == readBytes.size();
+    }
+
+    // Caller holds storeMutex.
+    void closeReadFile() {
+        if (readFile) std::fclose(readFile);
+        readFile = nullptr;
+    }
+
+    // Decode an environment block. `channelMask` selects which of the four
+    // channels are decompressed; the time column always is.
+    template <typename Fn>
+    void decodeEnvironment(const BlockInfo& block, unsigned channelMask, Fn&& fn) const {
+        size_t lastColumn = 1;
+        for (int c = 0; c < 4; ++c) {
+            if (channelMask & (1u << c)) lastColumn = c + 2;
+        }
+        if (!readColumns(block, lastColumn)) return;
+        const std::vector<size_t>& offsets = readOffsets;
+        auto reader = [&](size_t column) {
+            size_t begin = column < offsets.size() ? offsets[column] : 0;
+            size_t end = column + 1 < offsets.size() ? offsets[column + 1] : begin;
+            return tsz::BitReader(readBytes.data() + begin, end - begin);
+        };
+
+        tsz::BitReader time = reader(0);
+        tsz::TimestampDecoder timeDecoder;
+        tsz::BitReader channels[4] = {reader(1), reader(2), reader(3), reader(4)};
+        tsz::FloatDecoder decoders[4];
+
+        EnvPoint point;
+        for (uint32_t i = 0; i < block.header.pointCount; ++i) {
+            point.time = timeDecoder.decode(time);
+            for (int c = 0; c < 4; ++c) {
+                point.values[c] = (channelMask & (1u << c)) ? decoders[c].decode(channels[c]) : 0.0f;
+            }
+            fn(point);
+        }
+    }
+
+    template <typename Fn>
+    void decodeDetections(const BlockInfo& block, Fn&& fn) const {
+        if (!readColumns(block, block.header.columnCount)) return;
+        const std::vector<size_t>& offsets = readOffsets;
+        auto reader = [&](size_t column) {
+            return tsz::BitReader(readBytes.data() + offsets[column], offsets[column + 1] - offsets[column]);
+        };
+
+        tsz::BitReader time = reader(0), kinds = reader(1), labels = reader(2), activities = reader(3),
+                       confidence = reader(4), size = reader(5), dict = reader(6);
+        std::vector<std::string> dictionary = readDictionary(dict);
+        int idBits = tsz::bitsFor(dictionary.size());
+        tsz::TimestampDecoder timeDecoder;
+        tsz::FloatDecoder confidenceDecoder, sizeDecoder;
+
+        DetectionPoint point;
+        for (uint32_t i = 0; i < block.header.pointCount; ++i) {
+            point.time = timeDecoder.decode(time);
+            point.isMarine = kinds.readBit();
+            size_t label = static_cast<size_t>(labels.read(idBits));
+            size_t activity = static_cast<size_t>(activities.read(idBits));
+            point.label = label < dictionary.size() ? &dictionary[label] : &kNoLabel;
+            point.activity = activity < dictionary.size() ? &dictionary[activity] : &kNoLabel;
+            point.confidence = confidenceDecoder.decode(confidence);
+            point.size = sizeDecoder.decode(size);
+            fn(point);
+        }
+    }
+
+    static EnvironmentalData toEnvironmentalData(const EnvPoint& point) {
+        EnvironmentalData data;
+        data.timestamp = static_cast<time_t>(point.time);
+        data.temperature = point.values[0];
+        data.turbidity = point.values[1];
+        data.pH = point.values[2];
+        data.salinity = point.values[3];
+        return data;
+    }
+
+    static DetectionResult toDetectionResult(const DetectionPoint& point) {
+        DetectionResult result;
+        result.label = *point.label;
+        result.activity = *point.activity;
+        result.confidence = point.confidence;
+        result.size = point.size;
+        result.timestamp = static_cast<time_t>(point.time);
+        return result;
+    }
+
+    // Walk sealed blocks of `kind` that intersect [from, to].
+    template <typename Fn>
+    void forEachBlock(SeriesKind kind, int64_t from, int64_t to, QueryCost* cost, Fn&& fn) const {
+        for (const BlockInfo& block : index) {
+            if (block.header.kind != static_cast<uint8_t>(kind)) continue;
+            if (block.header.maxTime < from || block.header.minTime > to) {
+                if (cost) ++cost->blocksSkipped;
+                continue;
+            }
+            fn(block, block.header.minTime >= from && block.header.maxTime <= to);
+        }
+    }
+
+public:
+    explicit TimeSeriesStore(const TimeSeriesConfig& cfg = TimeSeriesConfig()) : config(cfg) {
+        config.blockPoints = std::max<size_t>(1, config.blockPoints);
+    }
+
+    ~TimeSeriesStore() { close(); }
+
+    TimeSeriesStore(const TimeSeriesStore&) = delete;
+    TimeSeriesStore& operator=(const TimeSeriesStore&) = delete;
+
+    // Open or create the store, rebuilding the block index from block
+    // headers. A torn or corrupt tail left by a crash is truncated away.
+    bool open(const std::string& storePath) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        closeReadFile();
+        path = storePath;
+        index.clear();
+        fileBytes = sealedPoints = rawBytes = recoveredBytes = failedWrites = 0;
+        envRetryAt = detectionRetryAt = 0;
+
+        std::error_code ec;
+        uint64_t size = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+        uint64_t valid = 0;
+        if (size > 0) {
+            std::ifstream in(path, std::ios::binary);
+            while (valid + sizeof(BlockHeader) <= size) {
+                BlockHeader header;
+                in.seekg(static_cast<std::streamoff>(valid));
+                if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !validHeader(header)) break;
+                uint64_t end = valid + sizeof(header) + payloadSize(header);
+                if (end > size) break;
+
+                // Only the last block can be torn, so only it pays for a
+                // payload checksum here.
+                if (end + sizeof(BlockHeader) > size) {
+                    std::vector<uint8_t> payload(static_cast<size_t>(payloadSize(header)));
+                    if (!in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size())) ||
+                        Checksum64::of(payload.data(), payload.size()) != header.payloadChecksum) {
+                        break;
+                    }
+                }
+                index.push_back({header, valid + sizeof(header)});
+                sealedPoints += header.pointCount;
+                rawBytes += header.pointCount *
+                            (header.kind == static_cast<uint8_t>(SeriesKind::Environment) ? kEnvRawBytes
+                                                                                           : kDetectionRawBytes);
+                valid = end;
+            }
+            if (valid < size) {
+                recoveredBytes = size - valid;
+                std::filesystem::resize_file(path, valid, ec);
+                if (ec) return false;
+            }
+        }
+
+        // A block's worth up front, so appending and sealing do not grow
+        // these once running. The index still grows with the history, but
+        // only every few hundred blocks.
+        index.reserve(index.size() + 256);
+        pendingEnv.reserve(config.blockPoints);
+        pendingDetections.reserve(config.blockPoints);
+        sealLabelIds.reserve(config.blockPoints);
+        sealActivityIds.reserve(config.blockPoints);
+        size_t columnBytes = (config.blockPoints * kMaxBitsPerPoint + 7) / 8;
+        for (auto& column : sealColumns) column.reserve(columnBytes);
+        sealRecord.reserve(sizeof(BlockHeader) + 5 * columnBytes); // the dictionary may still grow it
+        readBytes.reserve(5 * columnBytes);
+        readOffsets.reserve(kMaxColumns + 1);
+
+        file = std::fopen(path.c_str(), "ab");
+        fileBytes = valid;
+        return file != nullptr;
+    }
+
+    // Seal any buffered points and close the file.
+    void close() {
+        flush();
+        std::lock_guard<std::mutex> lock(storeMutex);
+        closeReadFile();
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    bool isOpen() const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return file != nullptr;
+    }
+
+    void appendEnvironment(const EnvironmentalData& data) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (!file) return;
+        pendingEnv.push_back({static_cast<int64_t>(data.timestamp), {data.temperature, data.turbidity, data.pH,
+                                                                     data.salinity}});
+        // After a failed seal the points stay pending; retry a block later.
+        if (pendingEnv.size() % config.blockPoints == 0) sealEnvironment();
+        // Sensor samples arrive steadily, so they also age out detections
+        // during a quiet spell.
+        sealStale(static_cast<int64_t>(data.timestamp));
+    }
+
+    void appendDetection(const DetectionResult& detection, bool isMarine) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (!file) return;
+        pendingDetections.push_back({static_cast<int64_t>(detection.timestamp), isMarine, &intern(detection.label),
+                                     &intern(detection.activity), detection.confidence, detection.size});
+        if (pendingDetections.size() % config.blockPoints == 0) sealDetections();
+        sealStale(static_cast<int64_t>(detection.timestamp));
+    }
+
+    // Seal partially filled blocks, making everything appended so far durable.
+    bool flush() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        bool envOk = sealEnvironment();
+        bool detectionsOk = sealDetections();
+        return envOk && detectionsOk;
+    }
+
+    // Aggregate one channel over [from, to] (inclusive, seconds).
+    RangeAggregate aggregateEnvironment(time_t from, time_t to, EnvChannel channel, QueryCost* cost = nullptr) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        size_t c = static_cast<size_t>(channel);
+        RangeAggregate result;
+        forEachBlock(SeriesKind::Environment, from, to, cost, [&](const BlockInfo& block, bool contained) {
+            if (contained) {
+                result.merge(block.header.aggregates[c]);
+                if (cost) ++cost->blocksFromIndex;
+                return;
+            }
+            if (cost) ++cost->blocksDecoded;
+            decodeEnvironment(block, 1u << c, [&](const EnvPoint& point) {
+                if (point.time >= from && point.time <= to) result.add(point.values[c]);
+            });
+        });
+        for (const EnvPoint& point : pendingEnv) {
+            if (point.time >= from && point.time <= to) result.add(point.values[c]);
+        }
+        return result;
+    }
+
+    DetectionAggregate aggregateDetections(time_t from, time_t to, QueryCost* cost = nullptr) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        DetectionAggregate result;
+        auto addPoint = [&](const DetectionPoint& point) {
+            if (point.time < from || point.time > to) return;
+            ++(point.isMarine ? result.marine : result.waste);
+            result.confidence.add(point.confidence);
+            result.size.add(point.size);
+        };
+        forEachBlock(SeriesKind::Detection, from, to, cost, [&](const BlockInfo& block, bool contained) {
+            if (contained) {
+                result.marine += block.header.marineCount;
+                result.waste += block.header.wasteCount;
+                result.confidence.merge(block.header.aggregates[0]);
+                result.size.merge(block.header.aggregates[1]);
+                if (cost) ++cost->blocksFromIndex;
+                return;
+            }
+            if (cost) ++cost->blocksDecoded;
+            decodeDetections(block, addPoint);
+        });
+        for (const DetectionPoint& point : pendingDetections) addPoint(point);
+        return result;
+    }
+
+    void scanEnvironment(time_t from, time_t to, const std::function<void(const EnvironmentalData&)>& fn) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        auto visit = [&](const EnvPoint& point) {
+            if (point.time >= from && point.time <= to) fn(toEnvironmentalData(point));
+        };
+        forEachBlock(SeriesKind::Environment, from, to, nullptr,
+                     [&](const BlockInfo& block, bool) { decodeEnvironment(block, 0xF, visit); });
+        for (const EnvPoint& point : pendingEnv) visit(point);
+    }
+
+    void scanDetections(time_t from, time_t to,
+                        const std::function<void(const DetectionResult&, bool isMarine)>& fn) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        auto visit = [&](const DetectionPoint& point) {
+            if (point.time >= from && point.time <= to) fn(toDetectionResult(point), point.isMarine);
+        };
+        forEachBlock(SeriesKind::Detection, from, to, nullptr,
+                     [&](const BlockInfo& block, bool) { decodeDetections(block, visit); });
+        for (const DetectionPoint& point : pendingDetections) visit(point);
+    }
+
+    TimeSeriesStats getStats() const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        TimeSeriesStats stats;
+        stats.blocks = index.size();
+        stats.points = sealedPoints;
+        stats.pendingPoints = pendingEnv.size() + pendingDetections.size();
+        stats.fileBytes = fileBytes;
+        stats.rawBytes = rawBytes;
+        stats.recoveredBytes = recoveredBytes;
+        stats.failedWrites = failedWrites;
+        return stats;
+    }
+};
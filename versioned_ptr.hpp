@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Publishes immutable objects to lock-free readers. pin() never takes a
+// lock or waits for a writer: it is three atomic operations and returns a
+// handle that keeps the pinned version alive while writers publish
+// replacements. Writers serialise on an internal mutex and free a replaced
+// version once no pin can still refer to it. A reader that holds a pin
+// across calls can check version() against latestVersion() (one atomic
+// load) and re-pin only when something new was published.
+template <typename T>
+class VersionedPtr {
+private:
+    struct Node {
+        std::shared_ptr<const T> value;
+        uint64_t version = 0;
+        std::atomic<uint64_t> pins{0};
+    };
+
+    std::atomic<Node*> current{nullptr};
+    // Readers between loading `current` and counting their pin. A retired
+    // node nobody has pinned is only freed after this is seen at zero, so
+    // no reader can be about to pin it.
+    mutable std::atomic<uint64_t> acquiring{0};
+    std::atomic<uint64_t> latest{0};
+    std::mutex writerMutex;
+    std::vector<Node*> retired; // guarded by writerMutex
+
+    // Caller holds writerMutex.
+    void reclaim() {
+        if (retired.empty() || acquiring.load() != 0) return;
+        size_t kept = 0;
+        for (Node* node : retired) {
+            if (node->pins.load(std::memory_order_acquire) == 0) {
+                delete node;
+            } else {
+                retired[kept++] = node;
+            }
+        }
+        retired.resize(kept);
+    }
+
+public:
+    class Pin {
+    private:
+        friend class VersionedPtr;
+        Node* node = nullptr;
+
+        explicit Pin(Node* pinned) : node(pinned) {}
+
+    public:
+        Pin() = default;
+        Pin(Pin&& other) noexcept : node(std::exchange(other.node, nullptr)) {}
+        Pin& operator=(Pin&& other) noexcept {
+            if (this != &other) {
+                reset();
+                node = std::exchange(other.node, nullptr);
+            }
+            return *this;
+        }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        ~Pin() { reset(); }
+
+        void reset() {
+            if (node) node->pins.fetch_sub(1, std::memory_order_release);
+            node = nullptr;
+        }
+
+        const T* get() const { return node ? node->value.get() : nullptr; }
+        const T& operator*() const { return *node->value; }
+        const T* operator->() const { return node->value.get(); }
+        explicit operator bool() const { return node && node->value; }
+        uint64_t version() const { return node ? node->version : 0; }
+        // The pinned object as a shared_ptr, for holding beyond the pin.
+        std::shared_ptr<const T> share() const { return node ? node->value : nullptr; }
+    };
+
+    VersionedPtr() = default;
+    VersionedPtr(const VersionedPtr&) = delete;
+    VersionedPtr& operator=(const VersionedPtr&) = delete;
+
+    // No pins may outlive the VersionedPtr.
+    ~VersionedPtr() {
+        delete current.load();
+        for (Node* node : retired) delete node;
+    }
+
+    Pin pin() const {
+        acquiring.fetch_add(1);
+        Node* node = current.load();
+        if (node) node->pins.fetch_add(1, std::memory_order_relaxed);
+        acquiring.fetch_sub(1);
+        return Pin(node);
+    }
+
+    // Replace the current version. Readers already holding a pin finish on
+    // the old one.
+    void publish(std::shared_ptr<const T> value) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        Node* node = new Node;
+        node->value = std::move(value);
+        node->version = latest.load(std::memory_order_relaxed) + 1;
+        Node* old = current.exchange(node);
+        latest.store(node->version, std::memory_order_release);
+        if (old) retired.push_back(old);
+        reclaim();
+    }
+
+    uint64_t latestVersion() const { return latest.load(std::memory_order_acquire); }
+
+    // Replaced versions not yet freed because a pin may still use them.
+    size_t retiredCount() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        reclaim();
+        return retired.size();
+    }
+};
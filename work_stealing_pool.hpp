@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool where each worker owns a task deque. Workers push
+// and pop their own deque at the back (LIFO, cache-warm) and steal from the
+// front of a victim's deque when theirs runs dry, so uneven tasks balance
+// out without a central queue. Tasks may submit further tasks; wait()
+// returns once every task, nested ones included, has finished.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};   // submitted, not yet picked up
+    std::atomic<size_t> unfinished{0}; // submitted, not yet completed
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<bool> stopping{false};
+
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+
+    static int& currentIndex() {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    static const WorkStealingPool*& currentPool() {
+        static thread_local const WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    bool popLocal(size_t index, Task& task) {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, Task& task) {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(thief + offset) % queues.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void execute(Task& task) {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        task = nullptr;
+        executed.fetch_add(1, std::memory_order_relaxed);
+        if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            allDone.notify_all();
+        }
+    }
+
+    void workerLoop(size_t index) {
+        currentIndex() = static_cast<int>(index);
+        currentPool() = this;
+        Task task;
+        while (true) {
+            if (popLocal(index, task) || steal(index, task)) {
+                execute(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            workAvailable.wait(lock, [this]() {
+                return stopping.load() || queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping.load() && queued.load() == 0) return;
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned threadCount = 0) {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<WorkerQueue>());
+        for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t threadCount() const { return workers.size(); }
+
+    // Index of the calling worker in [0, threadCount()), or threadCount()
+    // when called from a thread outside this pool.
+    size_t currentWorker() const {
+        return currentPool() == this ? static_cast<size_t>(currentIndex()) : workers.size();
+    }
+
+    // From a worker, the task goes on that worker's own deque; from outside,
+    // deques are filled round-robin.
+    void submit(Task task) {
+        size_t index = currentWorker();
+        if (index == workers.size()) index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+        unfinished.fetch_add(1, std::memory_order_acq_rel);
+        {
+            WorkerQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(sleepMutex); // a worker between its predicate check and wait() holds this
+        workAvailable.notify_one();
+    }
+
+    // Block until all submitted tasks, including tasks they submitted, are done.
+    void wait() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        allDone.wait(lock, [this]() { return unfinished.load(std::memory_order_acquire) == 0; });
+    }
+
+    // Run fn(begin, end) over [0, count) in chunks of `grain` and wait.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+        grain = std::max<size_t>(grain, 1);
+        for (size_t begin = 0; begin < count; begin += grain) {
+            size_t end = std::min(count, begin + grain);
+            submit([&fn, begin, end]() { fn(begin, end); });
+        }
+        wait();
+    }
+
+    uint64_t executedCount() const { return executed.load(std::memory_order_relaxed); }
+    uint64_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+};